@@ -1,22 +1,135 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
-
-#define TOUCH_PIN 4        // Using Touch0 which is GPIO4
-#define TOUCH_THRESHOLD 40 // Adjust this value based on your needs
+#include "touch_filter.h"
+
+#define TOUCH_PIN 4               // Using Touch0 which is GPIO4
+#define TOUCH_THRESHOLD 8         // Drop below the adaptive baseline that counts as a touch
+#define TOUCH_RELEASE_THRESHOLD 5 // Drop below which the touch is released
+#define TOUCH_SAMPLE_INTERVAL 10  // Filter runs at 100 Hz
+#define READING_INTERVAL 100      // One reading every 100 ms
+#define BATCH_INTERVAL 1000       // Readings are posted together once a second, a touch change at once
+#define SERVER_MAX_AGE 5000       // The server's CLIENT_TTL: it ignores older readings, so they are not kept
+#define QUEUE_CAPACITY 64         // SERVER_MAX_AGE of readings plus touch changes, oldest dropped first
+#define BATCH_MAX_READINGS 50     // Readings per request, a backlog goes out in several
+#define FLUSH_MAX_REQUESTS 4      // Requests per loop() when catching up, so touch sampling keeps going
+#define LINE_MAX_LENGTH 28        // "ESP_XXXXXX,4294967295,1\n" plus terminator
+#define HTTP_TIMEOUT 2000         // Connect and response timeout, bounds the stall during an outage
+#define STATS_INTERVAL 10000      // Print request latency every 10 seconds
 
 const char *WIFI_SSID = "";
 const char *WIFI_PASSWORD = "";
-const char *serverUrl = "http://192.168.1.200/sensor"; // Your first ESP's IP
+const char *serverUrl = "http://192.168.1.200/sensor/batch"; // Your first ESP's IP
+
+TouchFilter touchFilter;
+
+// One connection, kept open between requests (HTTPClient reuse)
+WiFiClient wifiClient;
+HTTPClient http;
+
+// Computed once in setup()
+char clientId[13];
 
-// Generate a unique client ID using the ESP's MAC address
-String getUniqueClientId()
+struct Reading
 {
-    uint8_t mac[6];
-    WiFi.macAddress(mac);
-    char clientId[13];
-    snprintf(clientId, sizeof(clientId), "ESP_%02X%02X%02X", mac[3], mac[4], mac[5]);
-    return String(clientId);
+    unsigned long takenMs;
+    uint8_t touch;
+};
+
+// Ring of readings not yet accepted by the server
+Reading queue[QUEUE_CAPACITY];
+int queueHead = 0; // Oldest
+int queueCount = 0;
+uint32_t droppedReadings = 0;
+uint32_t expiredReadings = 0;
+
+// Reused for every request
+char body[BATCH_MAX_READINGS * LINE_MAX_LENGTH];
+
+struct RequestStats
+{
+    uint32_t requests;
+    uint32_t failures;
+    uint32_t totalUs;
+    uint32_t maxUs;
+};
+
+RequestStats stats = {0, 0, 0, 0};
+
+void addReading(unsigned long now, uint8_t touch)
+{
+    if (queueCount == QUEUE_CAPACITY)
+    {
+        queueHead = (queueHead + 1) % QUEUE_CAPACITY;
+        queueCount--;
+        droppedReadings++;
+    }
+    queue[(queueHead + queueCount) % QUEUE_CAPACITY] = {now, touch};
+    queueCount++;
+}
+
+// Readings the server would throw away are not worth sending after an outage
+void dropExpired(unsigned long now)
+{
+    while (queueCount > 0 && now - queue[queueHead].takenMs >= SERVER_MAX_AGE)
+    {
+        queueHead = (queueHead + 1) % QUEUE_CAPACITY;
+        queueCount--;
+        expiredReadings++;
+    }
+}
+
+// One "clientId,ageMs,touch" line per reading, oldest first (see sensor_batch.h)
+size_t buildBatch(int count, unsigned long now)
+{
+    size_t length = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const Reading &reading = queue[(queueHead + i) % QUEUE_CAPACITY];
+        length += snprintf(body + length, sizeof(body) - length, "%s,%lu,%u\n",
+                           clientId, now - reading.takenMs, reading.touch);
+    }
+    return length;
+}
+
+// Posts the oldest queued readings, true if the server took them
+bool postBatch()
+{
+    int count = queueCount < BATCH_MAX_READINGS ? queueCount : BATCH_MAX_READINGS;
+    size_t length = buildBatch(count, millis());
+
+    unsigned long startUs = micros();
+    http.begin(wifiClient, serverUrl);
+    http.addHeader("Content-Type", "text/plain");
+    int httpResponseCode = http.POST((uint8_t *)body, length);
+    http.end(); // Keeps the connection open unless the server asked to close it
+    uint32_t elapsedUs = micros() - startUs;
+
+    stats.requests++;
+    stats.totalUs += elapsedUs;
+    if (elapsedUs > stats.maxUs)
+        stats.maxUs = elapsedUs;
+
+    if (httpResponseCode != 200)
+    {
+        stats.failures++;
+        Serial.printf("Error %d: %s\n", httpResponseCode, http.errorToString(httpResponseCode).c_str());
+        return false;
+    }
+
+    queueHead = (queueHead + count) % QUEUE_CAPACITY;
+    queueCount -= count;
+    return true;
+}
+
+void printStats()
+{
+    if (stats.requests == 0)
+        return;
+    Serial.printf("[HTTP] %u requests, %u failed, latency avg %u us, max %u us, %d queued, %u dropped, %u expired\n",
+                  stats.requests, stats.failures, stats.totalUs / stats.requests, stats.maxUs,
+                  queueCount, droppedReadings, expiredReadings);
+    stats = {0, 0, 0, 0};
 }
 
 void setup()
@@ -24,6 +137,11 @@ void setup()
     Serial.begin(115200);
     Serial.println("\nESP32 Sensor Client Starting...");
 
+    // Unique client ID from the ESP's MAC address
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    snprintf(clientId, sizeof(clientId), "ESP_%02X%02X%02X", mac[3], mac[4], mac[5]);
+
     WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
 
     Serial.print("Connecting to WiFi");
@@ -37,50 +155,70 @@ void setup()
     Serial.print("IP Address: ");
     Serial.println(WiFi.localIP());
     Serial.print("Client ID: ");
-    Serial.println(getUniqueClientId());
+    Serial.println(clientId);
+
+    http.setReuse(true);
+    http.setConnectTimeout(HTTP_TIMEOUT);
+    http.setTimeout(HTTP_TIMEOUT);
+
+    TouchFilterConfig config;
+    config.touchThreshold = TOUCH_THRESHOLD;
+    config.releaseThreshold = TOUCH_RELEASE_THRESHOLD;
+    touchFilter.setConfig(config);
 }
 
 void loop()
 {
     static unsigned long lastUpdate = 0;
+    static unsigned long lastReading = 0;
+    static unsigned long lastTouchSample = 0;
+    static unsigned long lastStats = 0;
+    static bool touched = false;
     unsigned long currentMillis = millis();
+    bool touchChanged = false;
 
-    if (currentMillis - lastUpdate >= 100)
+    if (currentMillis - lastTouchSample >= TOUCH_SAMPLE_INTERVAL)
     {
-        if (WiFi.status() == WL_CONNECTED)
-        {
-            HTTPClient http;
-
-            // Read touch sensor
-            int touchValue = touchRead(TOUCH_PIN);
-            int sensorValue = (touchValue < TOUCH_THRESHOLD) ? 1 : 0;
-
-            // Send data to server
-            http.begin(serverUrl);
-            http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-
-            String clientId = getUniqueClientId();
-            String postData = "clientId=" + clientId + "&value=" + String(sensorValue);
+        touchFilter.update(touchRead(TOUCH_PIN));
+        lastTouchSample = currentMillis;
+        touchChanged = touchFilter.isTouched() != touched;
+        touched = touchFilter.isTouched();
+    }
 
-            int httpResponseCode = http.POST(postData);
+    // Debounced state from the adaptive touch filter; a change is a reading of
+    // its own, so a tap shorter than READING_INTERVAL is not missed
+    if (touchChanged || currentMillis - lastReading >= READING_INTERVAL)
+    {
+        addReading(currentMillis, touched ? 1 : 0);
+        lastReading = currentMillis;
+    }
 
-            if (httpResponseCode == 200)
-            {
-                Serial.printf("Touch: %d, Value: %d\n", touchValue, sensorValue);
-            }
-            else
+    // A touch change goes out right away instead of waiting up to BATCH_INTERVAL
+    if ((touchChanged || currentMillis - lastUpdate >= BATCH_INTERVAL) && queueCount > 0)
+    {
+        if (WiFi.status() == WL_CONNECTED)
+        {
+            // A backlog from an outage goes out in a few back-to-back requests
+            dropExpired(currentMillis);
+            for (int i = 0; i < FLUSH_MAX_REQUESTS && queueCount > 0; i++)
             {
-                Serial.printf("Error %d: %s\n", httpResponseCode, http.errorToString(httpResponseCode).c_str());
+                if (!postBatch())
+                    break;
             }
-
-            http.end();
         }
         else
         {
             Serial.println("WiFi Disconnected! Attempting to reconnect...");
+            wifiClient.stop();
             WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
         }
 
         lastUpdate = currentMillis;
     }
+
+    if (currentMillis - lastStats >= STATS_INTERVAL)
+    {
+        printStats();
+        lastStats = currentMillis;
+    }
 }
@@ -0,0 +1,390 @@
+// Host micro-benchmarks for the platform-independent modules, built by the
+// `native` environment against the fakes in native/:
+//
+//   pio run -e native -t exec            run everything
+//   .pio/build/native/program json       only benchmarks whose name contains "json"
+//
+// Each benchmark is timed in batches for ~50 ms, best of five, and reported in
+// ns per operation. A result above its limit fails the run (exit code 1), so
+// an accidental slowdown shows up before it reaches a pad. Limits are several
+// times what a laptop measures, to stay quiet on slower machines; tighten one
+// when a change is meant to speed that path up.
+
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "config.h"
+#include "client_config.h"
+#include "ClientIdentity.h"
+#include "sensor_manager.h"
+#include "serial_bridge.h"
+#include "serial_frame.h"
+#include "espnow_manager.h"
+#include "espnow_message.h"
+#include "frame_scheduler.h"
+#include "link_monitor.h"
+#include "loop_scheduler.h"
+#include "traffic_capture.h"
+#include "telemetry_log.h"
+#include "time_sync.h"
+#include "trace_recorder.h"
+#include "web_handlers.h"
+
+#define BENCH_CLIENTS 16        // A full room of pads
+#define BENCH_BATCH_MS 50       // Time per measured batch
+#define BENCH_ROUNDS 5          // Batches per benchmark, the best one counts
+
+struct Benchmark
+{
+    const char *name;
+    double maxNsPerOp;
+    std::function<void()> run;
+};
+
+static volatile uint32_t sink; // Keeps results alive past the optimiser
+static uint32_t badResponses = 0; // A benchmark that measured an error path is worthless
+
+static void checkResponse(const AsyncWebServerRequest &request)
+{
+    if (request.responseCode() != 200)
+        badResponses++;
+    sink += request.responseBody().length();
+}
+
+static double measure(const std::function<void()> &run)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Size the batch so one takes about BENCH_BATCH_MS
+    uint64_t iterations = 1;
+    for (;;)
+    {
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; i++)
+            run();
+        double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (elapsedMs >= BENCH_BATCH_MS / 4 || iterations >= (1ULL << 30))
+        {
+            iterations = (uint64_t)(iterations * BENCH_BATCH_MS / (elapsedMs > 0 ? elapsedMs : 1)) + 1;
+            break;
+        }
+        iterations *= 4;
+    }
+
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; i++)
+            run();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+        if (round == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+// ========================= FIXTURE =========================
+
+static ClientConfig clientConfig;
+static ClientIdentity clientIdentity(&clientConfig);
+static SensorManager sensorManager;
+static SerialBridge serialBridge;
+static LinkMonitor linkMonitor;
+static TrafficCapture trafficCapture;
+static TelemetryLog telemetryLog;
+static TimeSync timeSync;
+static AsyncWebServer server(80);
+static WebHandlers webHandlers(&server, &sensorManager, &clientIdentity, &linkMonitor, &trafficCapture, &telemetryLog, &timeSync);
+
+static const uint8_t receiverMacs[][6] = {{0x24, 0x6F, 0x28, 0x00, 0x00, 0x01}};
+static EspNowManager espNowManager(receiverMacs, 1, false);
+
+static LoopScheduler scheduler;
+
+static FrameScheduler frameScheduler;
+
+static struct_touch_frame touchFrames[BENCH_CLIENTS];
+static struct_telemetry_frame telemetryFrames[BENCH_CLIENTS];
+static uint32_t frameSequence = 0;
+
+static void fillFrames(int client)
+{
+    struct_touch_frame &touch = touchFrames[client];
+    memset(&touch, 0, sizeof(touch));
+    touch.header.type = ESPNOW_TYPE_TOUCH;
+    touch.header.clientId = (uint8_t)client;
+    touch.touchValue = client & 1;
+    touch.gestureCount = (uint8_t)client;
+    touch.touchMask = (uint16_t)(client & 0x3);
+    touch.touchChannels = 2;
+    touch.syncErrorUs = 0xFFFF;
+
+    struct_telemetry_frame &telemetry = telemetryFrames[client];
+    memset(&telemetry, 0, sizeof(telemetry));
+    telemetry.header.type = ESPNOW_TYPE_TELEMETRY;
+    telemetry.header.clientId = (uint8_t)client;
+    telemetry.header.flags = ESPNOW_FLAG_TOUCH_RAW;
+    telemetry.batteryPercent = 40.0f + client;
+    telemetry.touchChannels = 2;
+    telemetry.touchRaw[0] = (uint16_t)(900 + client);
+    telemetry.touchRaw[1] = (uint16_t)(1100 - client);
+}
+
+// Same steps as storeTouchFrame() and storeTelemetryFrame() in main.cpp
+static void storeTouchFrame(const struct_touch_frame &frame)
+{
+    String clientId(frame.header.clientId);
+    if (!sensorManager.acceptSequence(clientId, frame.header.boot, frame.header.sequence))
+        return;
+
+    String key = "espnow-" + clientId;
+    sensorManager.updateTouch(key, clientId, frame.touchValue);
+    sensorManager.updateGesture(key, frame.gesture, frame.gestureCount, frame.gestureAgeMs);
+    sensorManager.updateTouchChannels(key, frame.touchMask, frame.touchChannels);
+    sensorManager.updateTouchTime(key, 0, frame.syncErrorUs);
+}
+
+static void storeTelemetryFrame(const struct_telemetry_frame &frame)
+{
+    String clientId(frame.header.clientId);
+    if (!sensorManager.acceptSequence(clientId, frame.header.boot, frame.header.sequence))
+        return;
+
+    String key = "espnow-" + clientId;
+    sensorManager.updateBattery(key, clientId, frame.batteryPercent);
+    sensorManager.updateTouchRaw(key, frame.touchRaw, (frame.header.flags & ESPNOW_FLAG_TOUCH_RAW) ? frame.touchChannels : 0);
+}
+
+static void setupFixture()
+{
+    clientIdentity.begin();
+    sensorManager.begin(&clientIdentity);
+    serialBridge.begin(&Serial, &sensorManager, SERIAL_BRIDGE_INTERVAL, BENCH_CLIENTS);
+    webHandlers.setupRoutes();
+    espNowManager.init(1);
+    frameScheduler.begin(&espNowManager, []() { return ++frameSequence; }, nullptr);
+
+    // The job set of main.cpp, with empty jobs to time the scheduler alone
+    scheduler.begin(SCHEDULER_LOOP_BUDGET_US, SCHEDULER_LATE_MS);
+    scheduler.addPeriodic("touch", []() { sink++; }, TOUCH_SAMPLE_INTERVAL, 0, 2000);
+    scheduler.addPeriodic("heartbeat", []() { sink++; }, ESPNOW_TOUCH_HEARTBEAT, 1, 3000);
+    scheduler.addPeriodic("telemetry", []() { sink++; }, ESPNOW_TELEMETRY_INTERVAL, 2, 3000, 100);
+    scheduler.addPeriodic("snapshot", []() { sink++; }, SENSOR_SNAPSHOT_INTERVAL, 2, 2000, 3);
+    scheduler.addPeriodic("stats", []() { sink++; }, CLIENT_STATS_INTERVAL, 3, 0);
+    scheduler.addPeriodic("display", []() { sink++; }, 500, 3, 30000, 250);
+
+    for (int client = 0; client < BENCH_CLIENTS; client++)
+    {
+        fillFrames(client);
+        touchFrames[client].header.sequence = ++frameSequence;
+        storeTouchFrame(touchFrames[client]);
+        telemetryFrames[client].header.sequence = ++frameSequence;
+        storeTelemetryFrame(telemetryFrames[client]);
+    }
+    sensorManager.publishSnapshot();
+}
+
+// Stops any recording and leaves TRACE_BUFFER_EVENTS of scope events, anchors included
+static void fillTraceRing()
+{
+    TraceRecorder::start();
+    for (int i = 0; i < TRACE_BUFFER_EVENTS; i++)
+    {
+        NativeHal::advanceMicros(1);
+        TRACE_SCOPE("bench");
+    }
+    TraceRecorder::stop();
+}
+
+// ========================= BENCHMARKS =========================
+
+static std::vector<Benchmark> benchmarks()
+{
+    std::vector<Benchmark> list;
+
+    list.push_back({"json_sensor_data_16", 250000, []()
+                    { sink += sensorManager.getSensorDataJSON().length(); }});
+
+    list.push_back({"web_get_sensor_data_16", 250000, []()
+                    {
+                        // Stay under the heavy endpoint rate limit. Every client goes stale
+                        // on the virtual clock, store_update_touch refreshes them all.
+                        NativeHal::advanceMillis(1000 / WEB_HEAVY_RATE);
+                        AsyncWebServerRequest request(HTTP_GET, "/sensorData");
+                        server.handle(&request);
+                        checkResponse(request);
+                    }});
+
+    list.push_back({"store_update_touch", 4000, []()
+                    {
+                        static int client = 0;
+                        struct_touch_frame &frame = touchFrames[client];
+                        frame.header.sequence = ++frameSequence;
+                        storeTouchFrame(frame);
+                        client = (client + 1) % BENCH_CLIENTS;
+                    }});
+
+    list.push_back({"store_update_telemetry", 4000, []()
+                    {
+                        static int client = 0;
+                        struct_telemetry_frame &frame = telemetryFrames[client];
+                        frame.header.sequence = ++frameSequence;
+                        storeTelemetryFrame(frame);
+                        client = (client + 1) % BENCH_CLIENTS;
+                    }});
+
+    list.push_back({"store_publish_snapshot_16", 20000, []()
+                    { sensorManager.publishSnapshot(); }});
+
+    list.push_back({"store_iterate_16", 1000, []()
+                    {
+                        uint32_t touched = 0;
+                        for (const auto &entry : sensorManager.getAllSensorData())
+                            touched += entry.second.touchValue;
+                        sink += touched;
+                    }});
+
+    list.push_back({"store_evict_steady", 300, []()
+                    { sensorManager.evictStaleClients(CLIENT_TTL); }});
+
+    list.push_back({"serial_build_frame_16", 8000, []()
+                    { sink += serialBridge.buildFrame(millis()); }});
+
+    list.push_back({"frame_encode_decode_max", 15000, []()
+                    {
+                        static uint8_t payload[SERIAL_FRAME_MAX_PAYLOAD];
+                        static uint8_t encoded[SERIAL_FRAME_MAX_ENCODED];
+                        static uint8_t decoded[SERIAL_FRAME_MAX_ENCODED];
+                        size_t body = SERIAL_FRAME_MAX_PAYLOAD - SERIAL_FRAME_CRC_SIZE;
+                        for (size_t i = 0; i < body; i++)
+                            payload[i] = (uint8_t)(i * 7 + sink);
+                        SerialFrame::putU16(payload + body, SerialFrame::crc16(payload, body));
+                        size_t encodedLength = SerialFrame::cobsEncode(payload, sizeof(payload), encoded);
+                        size_t decodedLength = SerialFrame::cobsDecode(encoded, encodedLength - 1, decoded);
+                        sink += SerialFrame::crc16(decoded, decodedLength);
+                    }});
+
+    list.push_back({"espnow_send_frame", 1000, []()
+                    {
+                        struct_touch_frame &frame = touchFrames[0];
+                        frame.header.sequence = ++frameSequence;
+                        sink += espNowManager.send((const uint8_t *)&frame, sizeof(frame));
+                        NativeHal::completeEspNowSends();
+                    }});
+
+    // A touch frame behind a busy radio: queued, then handed over once a slot frees up
+    list.push_back({"frame_queue_touch", 2000, []()
+                    {
+                        for (int i = 0; i < ESPNOW_TOUCH_MAX_IN_FLIGHT; i++)
+                            espNowManager.send((const uint8_t *)&touchFrames[1], sizeof(touchFrames[1]));
+                        frameScheduler.queueTouch(touchFrames[0]);
+                        NativeHal::completeEspNowSends();
+                        frameScheduler.handle();
+                        NativeHal::completeEspNowSends();
+                    }});
+
+    // A trace point while no trace runs, what every instrumented path pays
+    list.push_back({"trace_scope_idle", 20, []()
+                    {
+                        TRACE_SCOPE("bench");
+                        sink++;
+                    }});
+
+    list.push_back({"trace_scope_recording", 500, []()
+                    {
+                        if (!TraceRecorder::isActive())
+                            TraceRecorder::start();
+                        NativeHal::advanceMicros(1);
+                        TRACE_SCOPE("bench");
+                        sink++;
+                    }});
+
+    // A full ring of its own, so the result does not depend on which benchmarks ran
+    // before; exported through the chunked download
+    list.push_back({"trace_export_full", 1500000, []()
+                    {
+                        static bool filled = false;
+                        if (!filled)
+                        {
+                            fillTraceRing();
+                            filled = true;
+                        }
+                        NativeHal::advanceMillis(1000 / WEB_HEAVY_RATE); // Under the heavy endpoint rate limit
+                        AsyncWebServerRequest request(HTTP_GET, "/trace/download");
+                        server.handle(&request);
+                        checkResponse(request);
+                        sink += request.responseBody().length();
+                    }});
+
+    // One loop() iteration 1 ms after the last, most find nothing due
+    list.push_back({"scheduler_run_1ms", 1000, []()
+                    {
+                        NativeHal::advanceMillis(1);
+                        scheduler.run();
+                    }});
+
+    // These add clients of their own to the store, so they run last
+    list.push_back({"web_post_sensor_1", 20000, []()
+                    {
+                        AsyncWebServerRequest request(HTTP_POST, "/sensor");
+                        request.addParam("clientId", "7").addParam("touch", "1").addParam("batteryPercent", "80");
+                        server.handle(&request);
+                        sensorManager.processPostedReadings();
+                        checkResponse(request);
+                    }});
+
+    // Same number of readings as 200 single posts
+    list.push_back({"web_sensor_batch_8x25", 150000, []()
+                    {
+                        static String body;
+                        if (body.isEmpty())
+                        {
+                            for (int age = 2400; age >= 0; age -= 100)
+                            {
+                                for (int client = 0; client < 8; client++)
+                                    body += "ESP_" + String(client) + "," + String(age) + "," + String(age / 100 % 2) + ",80.5\n";
+                            }
+                        }
+                        AsyncWebServerRequest request(HTTP_POST, "/sensor/batch");
+                        request.setBody(body);
+                        server.handle(&request);
+                        sensorManager.processPostedReadings();
+                        checkResponse(request);
+                    }});
+
+    return list;
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+
+    setupFixture();
+
+    printf("%-28s %14s %14s\n", "benchmark", "ns/op", "limit");
+    int failures = 0;
+    for (const Benchmark &benchmark : benchmarks())
+    {
+        if (filter != nullptr && strstr(benchmark.name, filter) == nullptr)
+            continue;
+        double ns = measure(benchmark.run);
+        bool failed = ns > benchmark.maxNsPerOp;
+        printf("%-28s %14.1f %14.0f%s\n", benchmark.name, ns, benchmark.maxNsPerOp, failed ? "  REGRESSION" : "");
+        failures += failed ? 1 : 0;
+    }
+
+    if (badResponses > 0)
+    {
+        printf("%u request(s) did not get 200\n", badResponses);
+        failures++;
+    }
+    if (failures > 0)
+    {
+        printf("%d benchmark(s) over their limit\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -9,14 +9,24 @@ class ClientIdentity
 private:
     ClientConfig *config;
     int clientId;
+    int savedId; // As in NVS, clientId differs while a preview is on
 
 public:
-    ClientIdentity(ClientConfig *cfg) : config(cfg), clientId(0) {}
+    ClientIdentity(ClientConfig *cfg) : config(cfg), clientId(0), savedId(0) {}
 
     void begin()
     {
         config->begin();
         clientId = config->getClientId();
+        savedId = clientId;
+    }
+
+    // Skips the NVS read when the ID is already known (kept in RTC memory)
+    void begin(int knownId)
+    {
+        config->begin();
+        clientId = constrain(knownId, 0, 15);
+        savedId = clientId;
     }
 
     int get() const
@@ -24,16 +34,35 @@ public:
         return clientId;
     }
 
+    int getSaved() const
+    {
+        return savedId;
+    }
+
     void set(int id)
     {
         id = constrain(id, 0, 15);
         config->setClientId(id);
         clientId = id;
+        savedId = id;
+    }
+
+    // Changes the ID in RAM only, e.g. while a button scrolls through IDs; save() writes it to NVS
+    void preview(int id)
+    {
+        clientId = constrain(id, 0, 15);
+    }
+
+    void save()
+    {
+        config->setClientId(clientId);
+        savedId = clientId;
     }
 
     void refresh()
     {
         clientId = config->getClientId();
+        savedId = clientId;
     }
 };
 
@@ -0,0 +1,41 @@
+#ifndef BATTERY_MONITOR_H
+#define BATTERY_MONITOR_H
+
+#include <Arduino.h>
+#include <esp_adc_cal.h>
+
+#define BATTERY_LUT_SHIFT 4                           // One table entry per 16 raw counts
+#define BATTERY_LUT_SIZE ((4096 >> BATTERY_LUT_SHIFT) + 1)
+
+// Battery voltage from the ADC running continuously into a DMA buffer.
+// Raw counts are converted with an eFuse-calibrated lookup table and
+// integer math only; floats appear only at the reporting boundary.
+class BatteryMonitor
+{
+private:
+    uint16_t lut[BATTERY_LUT_SIZE]; // ADC pin millivolts for raw = i << BATTERY_LUT_SHIFT
+    bool dmaRunning;
+    uint8_t batteryPin;
+    uint8_t adcChannel;
+    uint32_t blockSum;
+    uint32_t blockCount;
+    uint32_t filteredRawQ4; // Block averages smoothed by an IIR filter, Q4
+    bool primed;
+    volatile uint32_t batteryMillivolts;
+
+    void buildLut(esp_adc_cal_value_t &source);
+    bool startDma();
+    void addBlock(uint32_t averageRaw);
+    uint32_t rawToPinMillivolts(uint32_t rawQ4) const;
+
+public:
+    BatteryMonitor();
+
+    void begin(uint8_t pin);
+    void poll(); // Drain the DMA buffer, call often (never blocks)
+
+    uint32_t getMillivolts() const { return batteryMillivolts; }
+    uint16_t getPercentTenths() const; // 0..1000
+};
+
+#endif // BATTERY_MONITOR_H
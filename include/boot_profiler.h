@@ -0,0 +1,20 @@
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include <Arduino.h>
+
+#define BOOT_PROFILER_MAX_STAGES 16
+
+// Records how long each step of the boot sequence takes (including steps that
+// finish later in the background) so the timeline can be inspected over the API.
+class BootProfiler
+{
+public:
+    static int begin(const char *stage);
+    static void end(int index);
+    static void milestone(const char *name);
+    static void printReport();
+    static String getJSON();
+};
+
+#endif // BOOT_PROFILER_H
@@ -0,0 +1,73 @@
+#ifndef BUTTON_INPUT_H
+#define BUTTON_INPUT_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#define BUTTON_MAX 2
+
+enum ButtonEventType : uint8_t
+{
+    BUTTON_PRESS,
+    BUTTON_REPEAT, // Still held, every BUTTON_REPEAT_MS after BUTTON_LONG_PRESS_MS
+    BUTTON_RELEASE,
+};
+
+struct ButtonEvent
+{
+    uint8_t button; // Index into the pins given to begin()
+    ButtonEventType type;
+    uint32_t timeMs;
+};
+
+// Active-low push buttons read on GPIO interrupts instead of polling. An edge
+// disables the pin's interrupt and starts a one-shot esp_timer; when it fires
+// the settled level is read and, if it changed, a press or release goes into
+// the event queue before the interrupt is armed again. So contact bounce costs
+// one interrupt per press, and loop() only looks at a queue.
+//
+// The timer callbacks run on the esp_timer task. Light sleep switches the
+// pins to level wake-up, which the first interrupt after waking undoes.
+class ButtonInput
+{
+private:
+    struct Button
+    {
+        ButtonInput *owner;
+        uint8_t index;
+        uint8_t pin;
+        esp_timer_handle_t debounceTimer;
+        esp_timer_handle_t repeatTimer;
+        volatile bool pressed; // Debounced state, esp_timer task only writes it
+    };
+
+    Button buttons[BUTTON_MAX];
+    uint8_t buttonCount;
+    QueueHandle_t events;
+    uint32_t debounceUs;
+    uint32_t longPressUs;
+    uint32_t repeatUs;
+
+    volatile uint32_t edges;       // Interrupts taken
+    volatile uint32_t bounces;     // Debounce ended on the level it started from
+    volatile uint32_t droppedEvents;
+
+    static void IRAM_ATTR onEdge(void *arg);
+    static void onDebounced(void *arg);
+    static void onRepeat(void *arg);
+    void post(Button &button, ButtonEventType type);
+    void arm(Button &button);
+
+public:
+    ButtonInput();
+
+    bool begin(const uint8_t *pins, uint8_t count, uint32_t debounceMs, uint32_t longPressMs, uint32_t repeatMs, uint8_t queueLength);
+
+    // Next event, false when there is none. Does not block.
+    bool poll(ButtonEvent &event);
+    bool isPressed(uint8_t button) const;
+
+    void printStats() const;
+};
+
+#endif // BUTTON_INPUT_H
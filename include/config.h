@@ -14,17 +14,161 @@ extern const IPAddress SUBNET;
 extern const IPAddress DNS_SERVER;
 
 // Hardware pin definitions
-#define RGB_LED_PIN 48
+#if CONFIG_IDF_TARGET_ESP32S3
+#define RGB_LED_PIN 48 // On-board RGB LED of the S3 DevKits
+#else
+#define RGB_LED_PIN 16 // Free on the nodemcu-32s, not a strapping or flash pin
+#endif
 #define NUM_PIXELS 1
+#define TOUCH_PIN 13
+#define BATTERY_PIN 34
+
+// Status LED strip (see LEDController)
+#define LED_BRIGHTNESS 128          // 0-255, applied to every pixel
+#define LED_RMT_CHANNEL 0
+#define LED_FRAME_INTERVAL 20       // 50 frames per second at most, only sent when a pixel changes
+#define LED_STATUS_PIXEL 0          // Pixel showing connection/touch status
+#define LED_PAD_PIXEL_OFFSET 1      // Pixel of pad 0, pads follow one per pixel up to NUM_PIXELS
+#define LED_BLINK_PERIOD 500
+#define LED_PULSE_PERIOD 2000
+#define LED_PAD_IDLE_COLOR 0x00FF00    // Pad seen recently, not touched (pulsing)
+#define LED_PAD_TOUCHED_COLOR 0x0000FF // Pad touched
+
+// Touch sensing
+#define TOUCH_SENSE_CAPACITIVE 0   // 0 = digital touch module output on TOUCH_PIN, 1 = ESP32 touch channel (opt-in, bare electrode)
+#define TOUCH_THRESHOLD 8          // Default delta from baseline (raw counts) to register a touch
+#define TOUCH_RELEASE_THRESHOLD 5  // Default delta below which a touch is released
+#define TOUCH_MAX_THRESHOLD 1000000 // Largest threshold POST /touchConfig accepts, raw counts
+#define TOUCH_SAMPLE_INTERVAL 10   // 10ms, filter runs at 100 Hz
+#define TOUCH_PINS TOUCH_PIN       // Comma separated pins scanned together, e.g. TOUCH_PIN, 12, 14, 27; the first wakes from deep sleep
+#define TOUCH_SEND_RAW 0           // 1 = add every channel's raw reading to the ESP-NOW telemetry frames
+#define TOUCH_FSM_SLEEP_CYCLES 150     // ESP32: ~1 ms between hardware scans (150 kHz RTC clock)
+#define TOUCH_FSM_MEAS_CYCLES 0x1000   // ESP32: same charge time as touchRead(), so thresholds carry over
+#define GESTURE_LONG_PRESS_MS 600     // Default hold time for a long press
+#define GESTURE_DOUBLE_TAP_GAP_MS 300 // Default max gap between the taps of a double tap
+#define GESTURE_HOLD_REPEAT_MS 200    // Default repeat interval while held after a long press
+
+// Battery measurement (integer math, see BatteryMonitor)
+#define BATTERY_DIVIDER_R1 100000         // Ohms, adjust as per your voltage divider
+#define BATTERY_DIVIDER_R2 10000          // Ohms, adjust as per your voltage divider
+#define BATTERY_CALIBRATION_PERMILLE 1000 // 1000 = no correction
+#define BATTERY_EMPTY_MV 3200
+#define BATTERY_FULL_MV 4200
+
+// Binary serial bridge (see serial_frame.h and tools/serial_frame_decoder.py)
+#define SERIAL_BRIDGE_ENABLED 0
+#define SERIAL_BRIDGE_BAUD 921600
+#define SERIAL_BRIDGE_INTERVAL 10 // 10ms, 100 frames per second
+#define SERIAL_BRIDGE_MIN_SLOTS 0 // Pad frames with empty slots up to this count
+
+// ESP-NOW traffic capture (see TrafficCapture and tools/capture_replay.py)
+#define CAPTURE_AUTOSTART 0            // 0 = start from the web UI, 1 = SPIFFS at boot, 2 = serial at boot
+#define CAPTURE_REPLAY_INPUT 0         // 1 = accept frames replayed by the host over Serial (debug builds only)
+#define CAPTURE_FILE_PATH "/capture.bin"
+#define CAPTURE_MAX_FILE_BYTES 262144  // Stop a SPIFFS capture at 256 KB
+#define CAPTURE_RING_BYTES 8192        // Records queued between the WiFi task and loop()
+#define CAPTURE_FLUSH_INTERVAL 1000    // Flush the capture file every second
+
+// Telemetry history in SPIFFS (see TelemetryLog)
+#define TELEMETRY_ENABLED 1
+#define TELEMETRY_SEGMENT_BYTES 16384      // Size of one segment file
+#define TELEMETRY_MAX_SEGMENTS 16          // 256 KB of history, the oldest segment is dropped first
+#define TELEMETRY_BUFFER_BYTES 512         // Records held in RAM between flushes
+#define TELEMETRY_FLUSH_INTERVAL 60000     // Write the buffer once a minute to limit flash wear
+#define TELEMETRY_FLUSH_RETRY_INTERVAL 10000 // After a failed write (flash full), try again at most this often
+#define TELEMETRY_BATTERY_INTERVAL 60000   // Consider logging the battery once a minute
+#define TELEMETRY_BATTERY_MIN_CHANGE 2     // ...when it moved by at least 0.2 %
+#define TELEMETRY_QUERY_LIMIT 500          // Default and maximum readings per /telemetry request
 
 // Server configuration
 #define WEB_SERVER_PORT 80
 #define OTA_PASSWORD "admin"
 #define OTA_HOSTNAME "ESP32-Sensor-Monitor"
 
+// Batched HTTP readings, POST /sensor/batch (see SensorBatch)
+#define SENSOR_BATCH_MAX_BODY 8192    // Larger bodies are refused with 413
+#define SENSOR_BATCH_MAX_CLIENTS 8     // Distinct clients per batch, further ones are dropped
+#define SENSOR_BATCH_MAX_READINGS 16   // Touch changes kept per batch, repeats are folded; all fit HTTP_READING_QUEUE_LENGTH
+
+// Web server task isolation (see SensorManager::publishSnapshot and RateLimiter)
+#define SENSOR_SNAPSHOT_INTERVAL 100    // Publish the store for the web server every 100 ms
+#define SENSOR_SNAPSHOT_MAX_CLIENTS 16  // Clients in the snapshot, further ones are left out of /sensorData
+#define HTTP_READING_QUEUE_LENGTH 16    // HTTP readings waiting for loop(), more get 503
+#define HTTP_CONFIG_QUEUE_LENGTH 2      // Touch config changes waiting for loop(), more get 503
+#define WEB_HEAVY_RATE 10               // Heavy endpoints: requests per second on average...
+#define WEB_HEAVY_BURST 5               // ...and back to back, beyond that 429
+
+// Client ID buttons (see ButtonInput)
+#define BUTTON_DEBOUNCE_MS 20        // Level must hold this long after an edge
+#define BUTTON_LONG_PRESS_MS 500     // Held this long, the ID starts scrolling...
+#define BUTTON_REPEAT_MS 100         // ...one step every 100 ms
+#define BUTTON_EVENT_QUEUE_LENGTH 8
+
+// On-device trace of loop(), radio, display, ADC and web work (see TraceRecorder)
+#define TRACE_ENABLED 1           // 0 = trace points compile to nothing
+#define TRACE_AUTOSTART 0         // 1 = record from boot, else POST /trace action=start
+#define TRACE_BUFFER_EVENTS 1024  // 16 bytes each, the oldest are overwritten
+
+// Loop scheduler (see LoopScheduler)
+#define SCHEDULER_LOOP_BUDGET_US 5000   // Past this, lower priority jobs wait for the next loop()
+#define SCHEDULER_LATE_MS 2             // A job starting later than this counts as late
+#define SCHEDULER_STATS_INTERVAL 30000  // Print per-job timing every 30 seconds
+
+// ESP-NOW configuration
+#define ESPNOW_DEFAULT_CHANNEL 1 // Used until an AP channel is known
+#define ESPNOW_BROADCAST 0       // 1 = broadcast to every receiver/relay in range, 0 = unicast to each listed receiver
+#define ESPNOW_RX_QUEUE_LENGTH 16
+
+// Typed ESP-NOW frames and their send priorities (see FrameScheduler)
+#define ESPNOW_TOUCH_HEARTBEAT 500       // Touch frame at least every 500 ms, changes and gestures go at once
+#define ESPNOW_TELEMETRY_INTERVAL 2000   // Battery (and raw readings with TOUCH_SEND_RAW)
+#define ESPNOW_TOUCH_QUEUE_LENGTH 4      // Touch frames waiting for the radio, the oldest is dropped first
+#define ESPNOW_TOUCH_MAX_IN_FLIGHT 2     // Touch frames go to the driver while fewer copies than this are unconfirmed
+#define ESPNOW_TELEMETRY_MAX_DEFER 1000  // Telemetry waits for an idle radio at most this long
+
+// ESP-NOW pairing and channel discovery (see EspNowPairing)
+#define PAIRING_ENABLED 1           // 0 = always send to receiverMacAddresses on ESPNOW_DEFAULT_CHANNEL
+#define PAIRING_RECEIVER 0          // 1 = this node is the receiver and answers pads looking for one
+#define PAIRING_ASSIGN_IDS 1        // Receiver hands out free client IDs, pads adopt them
+#define PAIRING_MAX_CHANNEL 13      // Channels 1..13 are swept while the station is not connected
+#define PAIRING_DWELL_MS 50         // Wait for an answer on each channel
+#define PAIRING_RETRY_INTERVAL 5000 // Pause between sweeps that found nothing
+#define PAIRING_LOST_FAILURES 10    // Unacknowledged frames in a row before the receiver is looked for again
+
+// ESP-NOW link quality and PHY rate (see LinkMonitor)
+#define ESPNOW_RATE_ADAPTIVE 1       // 1 = step the rate on delivery ratio and RSSI, 0 = fixed rate
+#define ESPNOW_ALLOW_LONG_RANGE 0    // 1 = allow the LR 250K/500K rates, every node must enable it too
+#define ESPNOW_FIXED_RATE_INDEX 2    // Starting rate: 0 LR 250K, 1 LR 500K, 2 1M, 3 6M, 4 12M, 5 24M, 6 54M
+#define LINK_EVALUATION_INTERVAL 5000 // Re-evaluate the rate every 5 seconds
+#define LINK_MIN_SAMPLES 10          // Sends needed in a window before the rate is changed
+#define LINK_STEP_DOWN_PERCENT 80    // Delivery below this drops to a more robust rate
+#define LINK_STEP_UP_PERCENT 98      // Delivery at or above this allows a faster rate (if the peers' RSSI allows it)
+#define LINK_BLIND_STEP_UP_HOLDOFF 60000 // RSSI unknown (pure sender): climb on delivery alone, not within 60 s of a step down
+
+// Shared timebase across pads (see TimeSync)
+#define TIME_SYNC_ENABLED 1
+#define TIME_SYNC_MASTER 0             // 1 = broadcast the time beacons (the receiver), 0 = follow them
+#define TIME_SYNC_BEACON_INTERVAL 1000 // One beacon per second
+#define TIME_SYNC_MASTER_TIMEOUT 5000  // Unlock, and accept another master, after this long without beacons
+#define TIME_SYNC_WINDOW 8             // Beacons in the offset/drift fit
+#define TIME_SYNC_MIN_SAMPLES 3        // Beacons needed before frames are stamped as synced
+#define TIME_SYNC_OUTLIER_US 2000      // Beacons this far off the fit are dropped...
+#define TIME_SYNC_OUTLIER_RESET 3      // ...unless this many come in a row, then the fit restarts
+
+// Power management (battery operation)
+// POWER_SAVE_MODE 1 runs ESP-NOW only (no station, web server or OTA), light
+// sleeps between samples and deep sleeps after DEEP_SLEEP_TIMEOUT of inactivity.
+#define POWER_SAVE_MODE 0
+#define DISPLAY_IDLE_TIMEOUT 15000 // Blank the OLED after 15 s without activity
+#define DEEP_SLEEP_TIMEOUT 120000  // Deep sleep after 2 min without activity
+#define LIGHT_SLEEP_MIN_MS 5       // Shorter idle gaps are not worth a sleep
+
 // Timing constants
-#define RECONNECT_INTERVAL 10000   // 10 seconds
+#define RECONNECT_INTERVAL 10000   // 10 seconds (upper bound of reconnect backoff)
 #define SENSOR_UPDATE_INTERVAL 200 // 200ms
-#define CONNECTION_TIMEOUT 20      // 20 attempts (10 seconds)
+#define CLIENT_TTL 5000            // Forget a client after 5 seconds without data
+#define CLIENT_STATS_INTERVAL 10000 // Print per-client link statistics every 10 seconds
+#define CONNECT_ATTEMPT_TIMEOUT 5000 // Give up on a single connect attempt after 5 seconds
+#define RECONNECT_BACKOFF_MIN 250    // First retry delay, doubled per failed attempt
 
 #endif // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef ESPNOW_MANAGER_H
+#define ESPNOW_MANAGER_H
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include "link_monitor.h"
+
+#define ESPNOW_MAX_RECEIVERS 6
+
+class EspNowManager
+{
+public:
+    typedef void (*ReceiveHandler)(const uint8_t *mac, const uint8_t *data, int len);
+
+private:
+    uint8_t peerAddresses[ESPNOW_MAX_RECEIVERS][6];
+    uint8_t peerCount;
+    bool broadcast;
+    uint8_t channel; // Channel ESP-NOW traffic is pinned to
+    bool initialized;
+    uint32_t channelChanges;
+    static volatile uint8_t pendingSends;
+    static ReceiveHandler receiveHandler;
+    static LinkMonitor *linkMonitor;
+    static volatile bool beaconInFlight;
+    static volatile int64_t beaconSentUs;
+    static volatile uint16_t consecutiveFailures; // Unicast sends not acknowledged in a row
+
+    static void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status);
+    static void onDataReceived(const uint8_t *mac_addr, const uint8_t *data, int len);
+    bool addPeer(const uint8_t *address);
+    bool updatePeerChannels();
+    bool ensurePeer(const uint8_t *address);
+    void pinRadioChannel();
+
+public:
+    // With useBroadcast every frame goes out once to FF:FF:FF:FF:FF:FF and any
+    // receiver or relay on the channel picks it up; otherwise each listed
+    // receiver gets its own acknowledged unicast copy.
+    EspNowManager(const uint8_t (*receiverMacs)[6], uint8_t receiverCount, bool useBroadcast);
+
+    bool init(uint8_t initialChannel);
+    void handle(bool wifiConnected, bool wifiConnecting);
+    bool send(const uint8_t *data, size_t len);
+    // Broadcasts a time beacon whatever the send mode; call only with no send pending,
+    // so the next broadcast send callback is known to be the beacon's
+    bool sendBeacon(const uint8_t *data, size_t len);
+    // One frame to one address (FF:FF:FF:FF:FF:FF for a broadcast), registering
+    // the peer on our channel if needed; for handshakes, not sensor frames
+    bool sendTo(const uint8_t *address, const uint8_t *data, size_t len);
+    bool sendBroadcast(const uint8_t *data, size_t len);
+    void setReceiveHandler(ReceiveHandler handler);
+    // Replaces the listed receivers with this one (unicast mode; broadcast frames reach it anyway)
+    bool setReceiver(const uint8_t *address);
+    // Moves our traffic to another channel; the AP's channel still wins while the station is connected
+    void setChannel(uint8_t newChannel);
+    void setLinkMonitor(LinkMonitor *monitor);
+
+    bool isSendPending() const { return pendingSends > 0; }
+    uint8_t getPendingSends() const { return pendingSends; } // Copies handed to the driver, not yet confirmed
+    // esp_timer time the last beacon left the radio, 0 if it has not (yet)
+    int64_t getBeaconSentUs() const { return beaconInFlight ? 0 : beaconSentUs; }
+    uint8_t getChannel() const { return channel; }
+    uint32_t getChannelChanges() const { return channelChanges; }
+    uint16_t getConsecutiveFailures() const { return consecutiveFailures; }
+};
+
+#endif // ESPNOW_MANAGER_H
@@ -0,0 +1,90 @@
+#ifndef ESPNOW_MESSAGE_H
+#define ESPNOW_MESSAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ESPNOW_MAX_TOUCH_CHANNELS 14 // ESP32-S3 has 14 touch channels, the ESP32 10
+#define ESPNOW_FLAG_TOUCH_RAW 0x01   // Telemetry: touchRaw holds touchChannels values
+#define ESPNOW_FLAG_TIME_SYNCED 0x02 // Touch: touchChangedUs is on the shared timebase (see TimeSync)
+#define ESPNOW_BEACON_MAGIC 0x434E5953 // "SYNC"
+#define ESPNOW_PAIR_MAGIC 0x52494150   // "PAIR"
+
+// ========================= ESP-NOW DATA STRUCTURE =========================
+// Shared by senders and receivers, must match on both sides exactly.
+//
+// Touch and telemetry frames start with their type. The control frames (time
+// beacons, pairing) start with their magic instead, whose first byte is never
+// a frame type, and are told apart by length.
+#define ESPNOW_TYPE_TOUCH 0x01
+#define ESPNOW_TYPE_TELEMETRY 0x02
+
+typedef struct espnow_header
+{
+    uint8_t type; // ESPNOW_TYPE_*
+    uint8_t clientId;
+    uint8_t flags; // ESPNOW_FLAG_*
+    uint8_t boot;      // Random per power-on, a new value means the sequence started over
+    uint32_t sequence; // Per-sender across both types, stamped when the frame goes to the radio
+} espnow_header;
+
+// Latency critical: sent on every touch change and gesture, else every ESPNOW_TOUCH_HEARTBEAT
+typedef struct struct_touch_frame
+{
+    espnow_header header;
+    uint32_t touchChangedUs; // Last touchMask change, low 32 bits of the shared timebase in us
+    uint16_t touchMask;      // Bit n set: touch channel n touched (touchValue is set if any is)
+    uint16_t gestureAgeMs;   // Time from the gesture to this frame, for precise timestamps at the receiver
+    uint16_t syncErrorUs;    // Sender's average sync error, 0xFFFF if not synced
+    uint8_t touchValue;
+    uint8_t gesture;       // Latest GestureEvent, GESTURE_NONE until the first one
+    uint8_t gestureCount;  // Bumped per gesture, so a resent frame does not repeat the event
+    uint8_t touchChannels; // Channels scanned on the sender
+    uint8_t reserved[2];
+} struct_touch_frame;
+
+// Slow changing state, every ESPNOW_TELEMETRY_INTERVAL; it waits for a quiet radio
+typedef struct struct_telemetry_frame
+{
+    espnow_header header;
+    float batteryPercent;
+    uint8_t touchChannels;
+    uint8_t reserved;
+    uint16_t touchRaw[ESPNOW_MAX_TOUCH_CHANNELS]; // Only sent with ESPNOW_FLAG_TOUCH_RAW, and only touchChannels of them
+} struct_telemetry_frame;
+
+// Telemetry frames are variable length: the raw values are cut to what was sent
+#define ESPNOW_TELEMETRY_MIN_SIZE offsetof(struct_telemetry_frame, touchRaw)
+#define ESPNOW_MAX_FRAME_SIZE sizeof(struct_telemetry_frame)
+
+inline size_t espNowTelemetrySize(const struct_telemetry_frame &frame)
+{
+    return ESPNOW_TELEMETRY_MIN_SIZE + ((frame.header.flags & ESPNOW_FLAG_TOUCH_RAW) ? frame.touchChannels * sizeof(uint16_t) : 0);
+}
+
+// Broadcast by the time master every TIME_SYNC_BEACON_INTERVAL
+typedef struct struct_time_beacon
+{
+    uint32_t magic;        // ESPNOW_BEACON_MAGIC
+    uint32_t sequence;
+    uint64_t previousTxUs; // Master clock when beacon sequence - 1 left the radio, 0 if unknown
+} struct_time_beacon;
+
+enum PairMessageType : uint8_t
+{
+    PAIR_PROBE = 1,  // Pad, broadcast on each channel it tries
+    PAIR_ACCEPT = 2, // Receiver, unicast back to the pad
+};
+
+// Pairing handshake (see EspNowPairing), shorter than a time beacon
+typedef struct struct_pair_message
+{
+    uint32_t magic; // ESPNOW_PAIR_MAGIC
+    uint8_t type;   // PairMessageType
+    uint8_t channel; // Accept: the receiver's channel
+    int8_t clientId; // Probe: the pad's current ID; accept: the ID to use, -1 to keep it
+    uint8_t reserved;
+    uint32_t nonce; // Picked by the pad per search, echoed by the accept
+} struct_pair_message;
+
+#endif // ESPNOW_MESSAGE_H
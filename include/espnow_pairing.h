@@ -0,0 +1,88 @@
+#ifndef ESPNOW_PAIRING_H
+#define ESPNOW_PAIRING_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "ClientIdentity.h"
+#include "espnow_manager.h"
+#include "espnow_message.h"
+
+#define PAIRING_MAX_IDS 16     // Client IDs 0..15
+#define PAIRING_MAX_PENDING 4  // Probes waiting for an answer on the receiver
+
+// Finds the receiver instead of a MAC address compiled in, and the channel it
+// is on. A pad without a stored receiver broadcasts a probe on each channel in
+// turn (only its own while the station is connected, as the AP decides then)
+// and stays PAIRING_DWELL_MS for an answer. The receiver answers with its
+// channel and, with PAIRING_ASSIGN_IDS, the client ID the pad should use: the
+// one it asked for if that is free, else the one it had, else the lowest free.
+// The pad stores the receiver in NVS and sends to it from then on; when
+// PAIRING_LOST_FAILURES frames in a row go unacknowledged (a receiver swap)
+// it searches again. An ID changed on the pad afterwards (buttons, web page)
+// is announced to the receiver with a unicast probe, so two pads never keep
+// the same ID without it knowing.
+class EspNowPairing
+{
+private:
+    struct PendingProbe
+    {
+        uint8_t mac[6];
+        int8_t clientId;
+        uint32_t nonce;
+    };
+
+    EspNowManager *espNow;
+    ClientIdentity *clientIdentity;
+    Preferences preferences;
+    bool receiver;
+    bool assignIds;
+    portMUX_TYPE mux;
+
+    // Pad
+    bool paired;
+    bool searching;
+    uint8_t receiverMac[6];
+    uint8_t receiverChannel;
+    uint8_t homeChannel;  // Where to go back to after a sweep that found nothing
+    uint8_t scanChannel;  // 0 between sweeps
+    uint8_t lastScanChannel;
+    uint32_t nonce;
+    unsigned long searchStartMs;
+    unsigned long lastHopMs;
+    unsigned long nextSweepMs;
+    uint32_t sweeps; // Since the search started
+    int8_t announcedId; // Last ID the receiver confirmed, kept in NVS; -1 none yet
+    bool announcing;
+    unsigned long lastAnnounceMs;
+
+    // Pad, written on the WiFi task under mux
+    bool acceptPending;
+    uint8_t acceptMac[6];
+    struct_pair_message accept;
+
+    // Receiver
+    uint8_t assignedMacs[PAIRING_MAX_IDS][6]; // All zero: ID free
+    PendingProbe probes[PAIRING_MAX_PENDING]; // Written on the WiFi task under mux
+    uint8_t probeCount;
+
+    void startSearch(uint8_t currentChannel);
+    void sweep(bool wifiConnected, bool wifiConnecting);
+    void announceId();
+    void applyAccept(const uint8_t *mac, const struct_pair_message &message, bool wifiConnected);
+    void answerProbes();
+    int8_t assignId(const uint8_t *mac, int8_t requested);
+
+public:
+    EspNowPairing();
+
+    void begin(EspNowManager *espNowManager, ClientIdentity *identity, bool isReceiver, bool assignClientIds);
+    void handle(bool wifiConnected, bool wifiConnecting);
+
+    // Called on the WiFi task for every pairing frame
+    void onMessage(const uint8_t *mac, const struct_pair_message &message);
+
+    // Hopping channels and waiting for an answer, the radio has to stay on
+    bool isSweeping() const { return scanChannel != 0; }
+};
+
+#endif // ESPNOW_PAIRING_H
@@ -0,0 +1,66 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "espnow_manager.h"
+#include "espnow_message.h"
+#include "traffic_capture.h"
+
+// Decides when touch and telemetry frames go to the radio. Touch frames go
+// at once unless ESPNOW_TOUCH_MAX_IN_FLIGHT copies are still unconfirmed by
+// the driver, then they wait in a short FIFO and go first as soon as a slot
+// frees up. Telemetry waits for an idle radio (or ESPNOW_TELEMETRY_MAX_DEFER
+// with no touch frame waiting); a newer telemetry frame replaces one still
+// waiting. So a touch never queues behind telemetry inside the driver, and
+// its latency does not grow with the telemetry load.
+//
+// Sequence numbers are stamped when a frame goes to the radio, so a replaced
+// telemetry frame does not show up as a loss at the receiver.
+class FrameScheduler
+{
+public:
+    typedef uint32_t (*SequenceSource)();
+
+private:
+    EspNowManager *espNow;
+    SequenceSource nextSequence;
+    TrafficCapture *capture;
+
+    struct_touch_frame touchQueue[ESPNOW_TOUCH_QUEUE_LENGTH];
+    uint32_t touchQueuedUs[ESPNOW_TOUCH_QUEUE_LENGTH];
+    uint8_t touchHead;
+    uint8_t touchCount;
+
+    struct_telemetry_frame telemetry;
+    bool telemetryWaiting;
+    unsigned long telemetryQueuedMs;
+
+    // Since the last resetStats()
+    uint32_t touchSent;
+    uint32_t touchWaited;  // Sent after waiting for the radio
+    uint32_t touchDropped; // Pushed out of a full queue
+    uint32_t touchWaitMaxUs;
+    uint64_t touchWaitTotalUs;
+    uint32_t telemetrySent;
+    uint32_t telemetryReplaced;
+    uint32_t sendErrors;
+
+    bool transmit(espnow_header &header, size_t length);
+
+public:
+    FrameScheduler();
+
+    void begin(EspNowManager *espNowManager, SequenceSource sequenceSource, TrafficCapture *trafficCapture);
+
+    void queueTouch(const struct_touch_frame &frame);
+    void queueTelemetry(const struct_telemetry_frame &frame);
+    void handle(); // Call every loop(): hands waiting frames to the radio as it frees up
+
+    bool hasWaitingFrames() const { return touchCount > 0 || telemetryWaiting; }
+
+    void printStats() const;
+    void resetStats();
+};
+
+#endif // FRAME_SCHEDULER_H
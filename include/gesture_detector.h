@@ -0,0 +1,145 @@
+#ifndef GESTURE_DETECTOR_H
+#define GESTURE_DETECTOR_H
+
+#include <stdint.h>
+
+// Turns the debounced touch state into tap / double tap / long press /
+// hold-repeat events. Fed with every touch sample (TOUCH_SAMPLE_INTERVAL),
+// so timings resolve to the sample rate instead of the send interval.
+// No Arduino dependencies, like TouchFilter.
+
+enum GestureEvent : uint8_t
+{
+    GESTURE_NONE = 0,
+    GESTURE_TAP = 1,
+    GESTURE_DOUBLE_TAP = 2,
+    GESTURE_LONG_PRESS = 3,
+    GESTURE_HOLD_REPEAT = 4
+};
+
+struct GestureConfig
+{
+    uint16_t longPressMs = 600;   // Held this long: long press instead of a tap
+    uint16_t doubleTapGapMs = 300; // Max release-to-press gap for a double tap, 0 = report taps at once
+    uint16_t holdRepeatMs = 200;  // Repeat interval after a long press, 0 = no repeats
+};
+
+inline const char *gestureName(uint8_t event)
+{
+    switch (event)
+    {
+    case GESTURE_TAP:
+        return "tap";
+    case GESTURE_DOUBLE_TAP:
+        return "double";
+    case GESTURE_LONG_PRESS:
+        return "long";
+    case GESTURE_HOLD_REPEAT:
+        return "hold";
+    default:
+        return "none";
+    }
+}
+
+class GestureDetector
+{
+private:
+    enum State : uint8_t
+    {
+        IDLE,
+        PRESSED,        // First press, not yet long
+        WAIT_SECOND,    // Released after a short press, a second press makes a double tap
+        SECOND_PRESSED, // Second press of a possible double tap
+        HELD            // Long press reported, repeating while held
+    };
+
+    GestureConfig config;
+    State state = IDLE;
+    uint32_t pressedAt = 0;
+    uint32_t releasedAt = 0;
+    uint32_t nextRepeatAt = 0;
+
+public:
+    void setConfig(const GestureConfig &cfg) { config = cfg; }
+    const GestureConfig &getConfig() const { return config; }
+    void reset() { state = IDLE; }
+
+    // At most one event per call; a pending tap is reported once the double tap window closes
+    GestureEvent update(bool touched, uint32_t nowMs)
+    {
+        switch (state)
+        {
+        case IDLE:
+            if (touched)
+            {
+                state = PRESSED;
+                pressedAt = nowMs;
+            }
+            return GESTURE_NONE;
+
+        case PRESSED:
+            if (!touched)
+            {
+                if (config.doubleTapGapMs == 0)
+                {
+                    state = IDLE;
+                    return GESTURE_TAP;
+                }
+                state = WAIT_SECOND;
+                releasedAt = nowMs;
+                return GESTURE_NONE;
+            }
+            if (nowMs - pressedAt >= config.longPressMs)
+            {
+                state = HELD;
+                nextRepeatAt = nowMs + config.holdRepeatMs;
+                return GESTURE_LONG_PRESS;
+            }
+            return GESTURE_NONE;
+
+        case WAIT_SECOND:
+            if (touched)
+            {
+                state = SECOND_PRESSED;
+                pressedAt = nowMs;
+                return GESTURE_NONE;
+            }
+            if (nowMs - releasedAt > config.doubleTapGapMs)
+            {
+                state = IDLE;
+                return GESTURE_TAP;
+            }
+            return GESTURE_NONE;
+
+        case SECOND_PRESSED:
+            if (!touched)
+            {
+                state = IDLE;
+                return GESTURE_DOUBLE_TAP;
+            }
+            if (nowMs - pressedAt >= config.longPressMs)
+            {
+                // Tap followed by a long press: report the tap, the long press follows next sample
+                state = PRESSED;
+                return GESTURE_TAP;
+            }
+            return GESTURE_NONE;
+
+        case HELD:
+            if (!touched)
+            {
+                state = IDLE;
+                return GESTURE_NONE;
+            }
+            if (config.holdRepeatMs > 0 && (int32_t)(nowMs - nextRepeatAt) >= 0)
+            {
+                nextRepeatAt += config.holdRepeatMs;
+                return GESTURE_HOLD_REPEAT;
+            }
+            return GESTURE_NONE;
+        }
+        return GESTURE_NONE;
+    }
+};
+
+#endif // GESTURE_DETECTOR_H
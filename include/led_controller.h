@@ -1,25 +1,73 @@
 #ifndef LED_CONTROLLER_H
 #define LED_CONTROLLER_H
 
-#include <Adafruit_NeoPixel.h>
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include "config.h"
 
+// WS2812 strip driven by the RMT peripheral. Setters only change the wanted
+// effect per pixel; handle() renders at most one frame per LED_FRAME_INTERVAL
+// and transmits it only when it differs from what the strip already shows.
+// The RMT sends in the background, so nothing blocks or masks interrupts.
 class LEDController
 {
+public:
+    enum Effect
+    {
+        EFFECT_SOLID,
+        EFFECT_BLINK,
+        EFFECT_PULSE
+    };
+
 private:
-    Adafruit_NeoPixel pixel;
-    int currentRed;
-    int currentGreen;
-    int currentBlue;
+    struct PixelState
+    {
+        uint32_t color; // 0xRRGGBB
+        Effect effect;
+        uint16_t periodMs;
+        unsigned long startedMs; // Phase reference, reset only when the effect changes
+    };
+
+    PixelState pixels[NUM_PIXELS];
+    uint8_t frame[NUM_PIXELS * 3];    // Last rendered frame, GRB
+    uint8_t txBuffer[NUM_PIXELS * 3]; // Owned by the RMT while a transmission runs
+    rmt_channel_t channel;
+    uint8_t brightness;
+    bool ready;
+    bool frameValid;
+    unsigned long lastFrameMs;
+    uint32_t framesSent;
+    uint32_t framesSkipped;
+
+    static void IRAM_ATTR translateToRmt(const void *src, rmt_item32_t *dest, size_t srcSize,
+                                         size_t wantedNum, size_t *translatedSize, size_t *itemNum);
+    uint32_t renderPixel(const PixelState &pixel, unsigned long now) const;
 
 public:
     LEDController();
-    void init();
+    bool init(); // False when the RMT driver cannot drive RGB_LED_PIN
+    void handle();
+
+    void setPixel(uint8_t index, uint32_t color, Effect effect = EFFECT_SOLID, uint16_t periodMs = 0);
     void setColor(int red, int green, int blue);
+    void setBrightness(uint8_t value) { brightness = value; }
+
+    // Status pixel (LED_STATUS_PIXEL)
     void setConnectingIndicator();
     void setConnectedIndicator();
     void setDisconnectedIndicator();
     void setSensorIndicator(int sensorValue);
+
+    // One pixel per pad from LED_PAD_PIXEL_OFFSET on, if the strip is long enough
+    void setPadState(int padId, bool present, bool touched);
+
     void getCurrentColor(int &red, int &green, int &blue);
+    uint32_t getFramesSent() const { return framesSent; }
 };
 
-#endif // LED_CONTROLLER_H
\ No newline at end of file
+static inline uint32_t ledColor(uint8_t red, uint8_t green, uint8_t blue)
+{
+    return ((uint32_t)red << 16) | ((uint32_t)green << 8) | blue;
+}
+
+#endif // LED_CONTROLLER_H
@@ -0,0 +1,58 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+
+#define LINK_MONITOR_MAX_PEERS 16
+
+struct PeerLinkStats
+{
+    uint8_t mac[6];
+    uint32_t sent;
+    uint32_t delivered;
+    uint32_t failed;       // Not acknowledged after the driver's own retries
+    int8_t lastRssi;
+    int32_t rssiAvgQ4;     // Smoothed RSSI, dBm in Q4
+    uint32_t rssiSamples;
+    unsigned long lastHeardMs;
+};
+
+// Per-peer ESP-NOW link quality (delivery ratio from send callbacks, RSSI
+// sniffed from received action frames) and the PHY rate policy built on it.
+class LinkMonitor
+{
+private:
+    PeerLinkStats peers[LINK_MONITOR_MAX_PEERS];
+    uint8_t peerCount;
+    portMUX_TYPE mux;
+
+    bool adaptive;
+    uint8_t lowestRateIndex;
+    uint8_t rateIndex;
+    uint32_t rateChanges;
+    uint32_t windowSent;
+    uint32_t windowDelivered;
+    unsigned long lastEvaluationMs;
+    unsigned long lastStepDownMs; // 0 before the first one
+
+    static LinkMonitor *instance;
+    static void onPromiscuousPacket(void *buffer, wifi_promiscuous_pkt_type_t type);
+
+    PeerLinkStats *findOrAddPeer(const uint8_t *mac);
+    int8_t getWorstRecentRssi(bool &known);
+    bool applyRate(uint8_t index);
+
+public:
+    LinkMonitor();
+
+    void begin(bool adaptiveRate, bool allowLongRange);
+    void recordSend(const uint8_t *mac, bool delivered);
+    void recordRssi(const uint8_t *mac, int8_t rssi);
+    void handle(); // Re-evaluates the rate policy every LINK_EVALUATION_INTERVAL
+
+    const char *getRateName() const;
+    String getJSON();
+};
+
+#endif // LINK_MONITOR_H
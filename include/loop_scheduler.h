@@ -0,0 +1,89 @@
+#ifndef LOOP_SCHEDULER_H
+#define LOOP_SCHEDULER_H
+
+#include <Arduino.h>
+
+#define SCHEDULER_MAX_JOBS 16
+#define SCHEDULER_WHEEL_SLOTS 64 // 1 ms per slot, longer delays wait for the due time on a later pass
+
+// Cooperative scheduler for the jobs loop() runs on timers. Jobs hang in a
+// hashed timer wheel by due time, so run() only looks at the slots that
+// elapsed since the last call. Due jobs start in priority order (0 first);
+// once an iteration has used its time budget the lower priority ones wait for
+// the next iteration instead of piling up behind each other. Per job it
+// records late starts and runs over the job's own budget, and it keeps the
+// share of time no job was running.
+class LoopScheduler
+{
+public:
+    typedef void (*JobFunction)();
+
+private:
+    struct Job
+    {
+        const char *name;
+        JobFunction function;
+        unsigned long periodMs; // 0 for a one-shot job
+        unsigned long dueMs;
+        uint32_t budgetUs;
+        uint8_t priority;
+        bool active;
+        bool scheduled; // In the wheel
+        bool ready;     // Due, waiting in the ready list
+        bool wakeup;    // Counts for getNextDeadline()
+        int8_t next;    // Next job in the same wheel slot or the ready list, -1 at the end
+
+        uint32_t runs;
+        uint32_t lateStarts;
+        uint32_t overruns;
+        uint32_t skipped; // Periods dropped because the job fell a whole period behind
+        uint32_t maxLateMs;
+        uint32_t maxRunUs;
+        uint64_t totalRunUs;
+    };
+
+    Job jobs[SCHEDULER_MAX_JOBS];
+    int8_t wheel[SCHEDULER_WHEEL_SLOTS]; // First job per slot, -1 if none
+    int8_t readyHead;
+    unsigned long lastTickMs;
+    uint32_t loopBudgetUs;
+    uint32_t lateToleranceMs;
+
+    // Idle accounting since the last resetStats()
+    unsigned long windowStartUs;
+    uint64_t busyUs;
+    uint32_t maxIterationUs;
+    uint32_t deferredRuns; // Jobs pushed to a later iteration by the loop budget
+
+    int addJob(const char *name, JobFunction function, unsigned long periodMs, unsigned long delayMs, uint8_t priority, uint32_t budgetUs);
+    void insert(int id);
+    void unlink(int id);
+    void makeReady(int id);
+    void collectDue(unsigned long now);
+    void runJob(int id);
+
+public:
+    LoopScheduler();
+
+    void begin(uint32_t loopBudgetUs, uint32_t lateToleranceMs);
+
+    // First run after phaseMs, then every periodMs; the phase spreads jobs of
+    // the same period over different iterations. Returns the job ID, -1 if full.
+    int addPeriodic(const char *name, JobFunction function, unsigned long periodMs, uint8_t priority, uint32_t budgetUs, unsigned long phaseMs = 0);
+    int addOneShot(const char *name, JobFunction function, unsigned long delayMs, uint8_t priority, uint32_t budgetUs);
+    void cancel(int id);
+    // Next run one period (or delayMs for a one-shot) from now, e.g. after the work was done out of turn
+    void restart(int id, unsigned long delayMs = 0);
+    // Jobs that do not need to wake the CPU (e.g. a blanked display) are left out of getNextDeadline()
+    void setWakeup(int id, bool wakeup);
+
+    void run(); // Call every loop()
+    unsigned long getNextDeadline() const;
+
+    float getIdlePercent() const;
+    void resetStats();
+    void printStats() const;
+    String getJSON() const;
+};
+
+#endif // LOOP_SCHEDULER_H
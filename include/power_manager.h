@@ -0,0 +1,47 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+
+class PowerManager
+{
+private:
+    bool enabled;
+    uint8_t touchPin;
+    uint8_t buttonPinA;
+    uint8_t buttonPinB;
+    esp_sleep_wakeup_cause_t wakeCause;
+    bool rtcStateValid;
+    unsigned long lastActivityMs;
+    unsigned long lightSleepMs; // Time spent in light sleep since this wake-up
+    uint32_t lightSleepCount;
+
+    uint32_t touchWakeThreshold;
+
+    void enableWakeSources(bool deepSleep);
+
+public:
+    PowerManager();
+
+    void begin(bool powerSaveEnabled, uint8_t touch, uint8_t buttonA, uint8_t buttonB);
+    bool isEnabled() const { return enabled; }
+
+    // State retained in RTC memory across deep sleep
+    bool restoreClientId(int &clientId) const;
+    void saveClientId(int clientId);
+    uint32_t nextSequence();
+    uint8_t getBootId() const; // Changes whenever the sequence restarts
+
+    bool wokeFromDeepSleep() const { return rtcStateValid; }
+    bool wokeByTouch() const;
+
+    void notifyActivity();
+    bool isIdleFor(unsigned long timeoutMs) const;
+    void sleepUntil(unsigned long deadlineMs);
+    void enterDeepSleep(uint32_t touchThreshold);
+
+    void printStats();
+};
+
+#endif // POWER_MANAGER_H
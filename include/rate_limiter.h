@@ -0,0 +1,40 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <stdint.h>
+
+// Token bucket: allows `burst` requests back to back, refilled at
+// `ratePerSecond`. Not thread safe, use it from one task.
+class RateLimiter
+{
+private:
+    uint32_t ratePerSecond;
+    uint32_t burstMilli;
+    uint32_t tokensMilli; // 1000 per request
+    unsigned long lastRefillMs = 0;
+    uint32_t rejected = 0;
+
+public:
+    RateLimiter(uint32_t ratePerSecond, uint32_t burst)
+        : ratePerSecond(ratePerSecond), burstMilli(burst * 1000), tokensMilli(burst * 1000) {}
+
+    bool allow(unsigned long nowMs)
+    {
+        unsigned long elapsed = nowMs - lastRefillMs;
+        lastRefillMs = nowMs;
+        uint64_t refilled = tokensMilli + (uint64_t)elapsed * ratePerSecond;
+        tokensMilli = refilled > burstMilli ? burstMilli : (uint32_t)refilled;
+
+        if (tokensMilli < 1000)
+        {
+            rejected++;
+            return false;
+        }
+        tokensMilli -= 1000;
+        return true;
+    }
+
+    uint32_t getRejected() const { return rejected; }
+};
+
+#endif // RATE_LIMITER_H
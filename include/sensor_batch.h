@@ -0,0 +1,62 @@
+#ifndef SENSOR_BATCH_H
+#define SENSOR_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+#define SENSOR_BATCH_MAX_LINE 64 // Longer lines are skipped
+
+// Body of POST /sensor/batch, one reading per line, oldest or newest first:
+//
+//   <clientId>,<ageMs>,<touch>[,<batteryPercent>]\n
+//
+// ageMs is how long before the request was sent the reading was taken, so
+// the sender needs no synchronised clock. Readings of several clients may be
+// mixed. The body is parsed as it streams in into SENSOR_BATCH_MAX_READINGS
+// slots. When they run out, each client's readings are sorted by age and
+// runs of the same touch value are folded into their newest reading: a tap
+// between two batches survives as its press and release, so memory use does
+// not depend on the body size. The state is plain data, allocated per
+// request and released with free() by the server.
+struct SensorBatchReading
+{
+    uint32_t ageMs;
+    int32_t touchValue;
+    float batteryPercent;
+    uint8_t client; // Index for getClientId()
+};
+
+class SensorBatch
+{
+private:
+    char line[SENSOR_BATCH_MAX_LINE];
+    uint8_t lineLength;
+    bool lineTooLong;
+    char clientIds[SENSOR_BATCH_MAX_CLIENTS][32];
+    uint8_t clientCount;
+    SensorBatchReading readings[SENSOR_BATCH_MAX_READINGS];
+    uint8_t readingCount;
+    uint32_t accepted;
+    uint32_t rejected;
+    uint32_t dropped;
+
+    void parseLine();
+    void compact();
+
+public:
+    SensorBatch();
+
+    void feed(const uint8_t *data, size_t length); // Any chunking, lines may span chunks
+    void finish();                                 // Parses a last line without a newline, then sorts oldest first
+
+    // After finish(): oldest first, the last reading before each touch change and each client's newest
+    uint8_t getReadingCount() const { return readingCount; }
+    const SensorBatchReading &getReading(uint8_t index) const { return readings[index]; }
+    const char *getClientId(uint8_t client) const { return clientIds[client]; }
+    uint32_t getAccepted() const { return accepted; }
+    uint32_t getRejected() const { return rejected; }
+    uint32_t getDropped() const { return dropped; } // Touch changes lost to a full batch, the oldest go first
+};
+
+#endif // SENSOR_BATCH_H
@@ -2,26 +2,176 @@
 #define SENSOR_MANAGER_H
 
 #include <map>
+#include <list>
 #include <string>
 #include <Arduino.h>
 #include "ClientIdentity.h"
+#include "touch_filter.h"
+#include "gesture_detector.h"
+#include "battery_monitor.h"
+#include "sequence_window.h"
+#include "espnow_message.h"
+#include "seqlock.h"
+#include "config.h"
 
 struct SensorData
 {
     String clientId;
     int touchValue;
     float batteryPercent;
+    unsigned long lastSeenMs;
+    std::list<String>::iterator agePosition; // Entry in SensorManager's last-seen order
+    uint8_t gesture;
+    uint8_t gestureCount;
+    unsigned long gestureAtMs;
+    uint32_t missedGestures; // Gestures skipped by gestureCount, i.e. frames lost in between
+    uint16_t touchMask;
+    uint8_t touchChannels;
+    uint8_t rawCount; // Raw readings received with the last frame, 0 if the sender does not send them
+    uint16_t touchRaw[ESPNOW_MAX_TOUCH_CHANNELS];
+    uint64_t touchChangedUs; // Last touch change on the shared timebase, 0 if the pad or we are not synced
+    uint16_t syncErrorUs;    // As reported by the pad, 0xFFFF if it is not synced
+};
+
+// Delivery statistics for a client sending sequenced (ESP-NOW) frames
+struct LinkStats
+{
+    SequenceWindow window;
+    uint8_t boot = 0;       // Sender's boot ID of the last frame
+    uint32_t received = 0;
+    uint32_t lost = 0;      // Sequence gaps not (yet) filled by late frames
+    uint32_t reordered = 0;
+    uint32_t duplicates = 0;
+    uint32_t jitterQ4 = 0;  // Smoothed inter-arrival variation, ms in Q4
+    unsigned long lastArrivalMs = 0;
+    unsigned long lastIntervalMs = 0;
+};
+
+// Plain-data copy of the store and the local pad, published by loop() so the
+// web server task renders its JSON without touching live state
+struct ClientSnapshot
+{
+    char key[48];
+    char clientId[32];
+    int32_t touchValue;
+    float batteryPercent;
+    uint32_t lastSeenMs;
+    uint32_t gestureAtMs;
+    uint32_t missedGestures;
+    uint8_t gesture;
+    uint8_t gestureCount;
+    uint16_t touchMask;
+    uint8_t touchChannels;
+    uint8_t rawCount;
+    uint16_t syncErrorUs;
+    uint16_t touchRaw[ESPNOW_MAX_TOUCH_CHANNELS];
+    uint64_t touchChangedUs;
+    bool hasLinkStats;
+    uint32_t received;
+    uint32_t lost;
+    uint32_t reordered;
+    uint32_t duplicates;
+    uint32_t jitterQ4;
+};
+
+struct TouchChannelSnapshot
+{
+    uint8_t pin;
+    bool touched;
+    uint32_t raw;
+    int32_t filtered;
+    int32_t baseline;
+    int32_t delta;
+};
+
+struct SensorSnapshot
+{
+    uint16_t touchMask;
+    uint8_t touchChannels;
+    uint8_t gesture;
+    float batteryPercent;
+    TouchChannelSnapshot channels[ESPNOW_MAX_TOUCH_CHANNELS];
+    TouchFilterConfig touchConfig;
+    GestureConfig gestureConfig;
+    uint8_t clientCount;
+    uint16_t omittedClients; // Beyond SENSOR_SNAPSHOT_MAX_CLIENTS
+    ClientSnapshot clients[SENSOR_SNAPSHOT_MAX_CLIENTS];
+};
+
+// Reading posted over HTTP, queued for loop() which owns the store
+struct PostedReading
+{
+    char senderIP[48];
+    char clientId[32];
+    int32_t touchValue;
+    float batteryPercent;
+    uint32_t ageMs;
+};
+
+// Touch and gesture settings changed over HTTP, applied by loop() like a reading
+struct PostedConfig
+{
+    TouchFilterConfig touch;
+    GestureConfig gestures;
 };
 
 class SensorManager
 {
 private:
     std::map<String, SensorData> sensorDataMap;
+    std::map<String, LinkStats> linkStats;  // Keyed by client ID
+    std::list<String> ageOrder;             // Store keys, least recently seen first
+    uint32_t duplicateFrames = 0;
+    uint32_t staleFrames = 0;
     ClientIdentity *clientIdentity = nullptr;
+    // Local touch channels, scanned together by the touch FSM; channel 0 is TOUCH_PIN
+    uint8_t touchChannelCount = 0;
+    uint8_t touchPins[ESPNOW_MAX_TOUCH_CHANNELS];
+    TouchFilter touchFilters[ESPNOW_MAX_TOUCH_CHANNELS];
+    uint32_t lastTouchRaw[ESPNOW_MAX_TOUCH_CHANNELS] = {0};
+    uint16_t touchMask = 0;
+    int64_t touchChangedUs = 0; // esp_timer time of the last touchMask change
+    void beginTouchChannels();
+    GestureDetector gestureDetector;
+    uint8_t localGesture = GESTURE_NONE;
+    uint8_t localGestureCount = 0;
+    unsigned long localGestureAtMs = 0;
+    bool gesturePending = false;
+    BatteryMonitor batteryMonitor;
+    Seqlock<SensorSnapshot> snapshot;
+    SensorSnapshot nextSnapshot; // Built here, then published in one copy
+    QueueHandle_t postedReadings = nullptr;
+    QueueHandle_t postedConfigs = nullptr;
+
+    bool readSnapshot(SensorSnapshot &out) const;
+    SensorData &refreshClient(const String &senderIP, const String &clientId);
+    std::list<String>::iterator ageOrderSlot(unsigned long now, unsigned long lastSeenMs);
 
 public:
     void begin(ClientIdentity *identity); // Initialize sensor pins
-    void updateSensorData(const String &senderIP, const String &clientId, int touchValue, float batteryPercent);
+    // ageMs: the reading was taken that long ago; an older reading than the stored one is ignored
+    void updateSensorData(const String &senderIP, const String &clientId, int touchValue, float batteryPercent, unsigned long ageMs = 0);
+    bool acceptSequence(const String &clientId, uint8_t boot, uint32_t sequence); // False for duplicates and replays
+    void updateGesture(const String &senderIP, uint8_t gesture, uint8_t gestureCount, uint16_t gestureAgeMs);
+    // ESP-NOW touch and telemetry frames each carry half of a reading; the other half stays as it was
+    void updateTouch(const String &senderIP, const String &clientId, int touchValue);
+    void updateBattery(const String &senderIP, const String &clientId, float batteryPercent);
+    void updateTouchChannels(const String &senderIP, uint16_t mask, uint8_t channels);
+    void updateTouchRaw(const String &senderIP, const uint16_t *raw, uint8_t rawCount);
+    void updateTouchTime(const String &senderIP, uint64_t touchChangedUs, uint16_t syncErrorUs);
+    // Any task: queues a reading for processPostedReadings(), false if the queue is full
+    bool postReading(const String &senderIP, const String &clientId, int touchValue, float batteryPercent, unsigned long ageMs = 0);
+    // Any task: queues new settings for processPostedReadings(), false if the queue is full
+    bool postConfig(const TouchFilterConfig &touch, const GestureConfig &gestures);
+    bool readPublishedConfig(TouchFilterConfig &touch, GestureConfig &gestures) const; // As of the last snapshot
+    void processPostedReadings();
+    void publishSnapshot(); // loop(), every SENSOR_SNAPSHOT_INTERVAL
+    uint32_t getDuplicateFrames() const { return duplicateFrames; }
+    uint32_t getStaleFrames() const { return staleFrames; }
+    void evictStaleClients(unsigned long ttlMs); // Cheap to call every loop
+    void printClientStats() const;
+    // The JSON getters render the last published snapshot and are safe from any task;
+    // everything else belongs to loop()
     String getSensorDataJSON() const;
     const std::map<String, SensorData> &getAllSensorData() const;
     void clearSensorData();
@@ -29,7 +179,23 @@ public:
     String getFormattedSensorData() const;
     String getFormattedSensorData(int minSensors) const;
     // Add for client mode:
-    int getLocalTouchValue() const;
+    void sampleTouch(); // Call every TOUCH_SAMPLE_INTERVAL, also runs the gesture detector
+    bool takeGesture(); // True once per new local gesture
+    uint8_t getLocalGesture() const { return localGesture; }
+    uint8_t getLocalGestureCount() const { return localGestureCount; }
+    unsigned long getLocalGestureAtMs() const { return localGestureAtMs; }
+    GestureConfig getGestureConfig() const;
+    void setGestureConfig(const GestureConfig &config);
+    int getLocalTouchValue() const; // 1 if any channel is touched
+    uint16_t getLocalTouchMask() const { return touchMask; }
+    int64_t getLocalTouchChangedUs() const { return touchChangedUs; }
+    uint8_t getTouchChannelCount() const { return touchChannelCount; }
+    uint32_t getLocalTouchRaw(uint8_t channel) const { return channel < touchChannelCount ? lastTouchRaw[channel] : 0; }
+    void pollBattery(); // Drains the continuous ADC buffer, never blocks
+    uint32_t getTouchWakeThreshold() const;
+    TouchFilterConfig getTouchConfig() const;
+    void setTouchConfig(const TouchFilterConfig &config);
+    String getTouchStateJSON() const;
     float getLocalBatteryVoltage() const;
     float getLocalBatteryPercent() const;
     String getLocalSensorDataJSON() const;
@@ -0,0 +1,53 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <string.h>
+#include <type_traits>
+
+// Single-writer sequence lock around a plain-data value. The writer never
+// waits; readers copy the value and retry if a write overlapped the copy, so
+// they never see half of one update and half of the next. The writer must not
+// be preempted mid-publish by a reader on the same core that spins, so a
+// failed read returns false after a few attempts instead of looping forever.
+template <typename T>
+class Seqlock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock holds plain data only");
+
+private:
+    std::atomic<uint32_t> sequence{0}; // Odd while a write is in progress
+    T value{};
+
+public:
+    // Writer side, one task only. Build the new value elsewhere and publish
+    // it in one copy, so the window readers have to retry is short.
+    void publish(const T &next)
+    {
+        uint32_t start = sequence.load(std::memory_order_relaxed);
+        sequence.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy((void *)&value, &next, sizeof(T));
+        sequence.store(start + 2, std::memory_order_release);
+    }
+
+    // Any task. False if every attempt overlapped a write.
+    bool read(T &out, uint8_t attempts = 4) const
+    {
+        for (uint8_t i = 0; i < attempts; i++)
+        {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1)
+                continue;
+            memcpy(&out, (const void *)&value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+                return true;
+        }
+        return false;
+    }
+
+    uint32_t getVersion() const { return sequence.load(std::memory_order_acquire) >> 1; }
+};
+
+#endif // SEQLOCK_H
@@ -0,0 +1,69 @@
+#ifndef SEQUENCE_WINDOW_H
+#define SEQUENCE_WINDOW_H
+
+#include <stdint.h>
+
+#define SEQUENCE_WINDOW_SIZE 64      // Out-of-order tolerance, one bit per sequence
+#define SEQUENCE_RESTART_GAP 1024    // Far older than the window: assume the sender restarted
+
+// Sliding-window duplicate/replay filter for one sender's frame sequence numbers.
+class SequenceWindow
+{
+private:
+    uint32_t highest = 0;
+    uint64_t seen = 0; // Bit n set: (highest - n) was accepted
+    bool initialized = false;
+
+public:
+    enum Result
+    {
+        ACCEPTED,
+        DUPLICATE,
+        TOO_OLD,
+        RESTARTED
+    };
+
+    Result check(uint32_t sequence)
+    {
+        if (!initialized)
+        {
+            initialized = true;
+            highest = sequence;
+            seen = 1;
+            return ACCEPTED;
+        }
+
+        if (sequence > highest)
+        {
+            uint32_t shift = sequence - highest;
+            seen = shift >= SEQUENCE_WINDOW_SIZE ? 0 : seen << shift;
+            seen |= 1;
+            highest = sequence;
+            return ACCEPTED;
+        }
+
+        uint32_t age = highest - sequence;
+        if (age >= SEQUENCE_RESTART_GAP)
+        {
+            // Counter went back a long way: reboot without RTC state, start over
+            highest = sequence;
+            seen = 1;
+            return RESTARTED;
+        }
+        if (age >= SEQUENCE_WINDOW_SIZE)
+            return TOO_OLD;
+
+        uint64_t bit = 1ULL << age;
+        if (seen & bit)
+            return DUPLICATE;
+        seen |= bit;
+        return ACCEPTED;
+    }
+
+    // Next sequence starts a new window, e.g. the sender rebooted
+    void reset() { initialized = false; }
+
+    uint32_t getHighest() const { return highest; }
+};
+
+#endif // SEQUENCE_WINDOW_H
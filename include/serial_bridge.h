@@ -0,0 +1,33 @@
+#ifndef SERIAL_BRIDGE_H
+#define SERIAL_BRIDGE_H
+
+#include <Arduino.h>
+#include "sensor_manager.h"
+#include "serial_frame.h"
+
+// Streams the sensor store to the host as COBS-framed binary (see serial_frame.h).
+// Frames are built in fixed buffers, nothing is allocated per frame.
+class SerialBridge
+{
+private:
+    HardwareSerial *output;
+    SensorManager *sensorManager;
+    unsigned long intervalMs;
+    unsigned long lastFrameMs;
+    int minSlots;
+    uint16_t sequence;
+    uint32_t droppedFrames;
+    uint8_t payload[SERIAL_FRAME_MAX_PAYLOAD];
+    uint8_t encoded[SERIAL_FRAME_MAX_ENCODED];
+
+public:
+    SerialBridge();
+
+    void begin(HardwareSerial *port, SensorManager *sensors, unsigned long frameIntervalMs, int minimumSlots);
+    void setInterval(unsigned long frameIntervalMs) { intervalMs = frameIntervalMs; }
+    void handle();
+    size_t buildFrame(uint32_t timestampMs);
+    uint32_t getDroppedFrames() const { return droppedFrames; }
+};
+
+#endif // SERIAL_BRIDGE_H
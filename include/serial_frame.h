@@ -0,0 +1,122 @@
+#ifndef SERIAL_FRAME_H
+#define SERIAL_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary serial frame for the host bridge (decoded by tools/serial_frame_decoder.py).
+//
+// Payload, little endian:
+//   u8  version
+//   u8  slot count
+//   u16 frame sequence
+//   u32 timestamp (ms since boot)
+//   slot count x { u8 clientId, u8 flags, u16 battery percent * 10 }
+//   u16 CRC-16/CCITT-FALSE over everything above
+//
+// The payload is COBS encoded and terminated by a 0x00 byte, so the host can
+// resynchronise on any delimiter and drop anything (e.g. log text) that fails CRC.
+
+#define SERIAL_FRAME_VERSION 1
+#define SERIAL_FRAME_MAX_SLOTS 16
+#define SERIAL_FRAME_HEADER_SIZE 8
+#define SERIAL_FRAME_SLOT_SIZE 4
+#define SERIAL_FRAME_CRC_SIZE 2
+#define SERIAL_FRAME_MAX_PAYLOAD (SERIAL_FRAME_HEADER_SIZE + SERIAL_FRAME_MAX_SLOTS * SERIAL_FRAME_SLOT_SIZE + SERIAL_FRAME_CRC_SIZE)
+// COBS adds one byte per 254 plus the leading code byte, then the delimiter
+#define SERIAL_FRAME_MAX_ENCODED (SERIAL_FRAME_MAX_PAYLOAD + SERIAL_FRAME_MAX_PAYLOAD / 254 + 2)
+
+#define SERIAL_SLOT_FLAG_TOUCH 0x01
+#define SERIAL_SLOT_FLAG_PRESENT 0x02
+
+// First payload byte of non-bridge frames sharing the stream (never a valid version)
+#define SERIAL_FRAME_TAG_CAPTURE 0xC1 // Device -> host, TrafficCapture record
+#define SERIAL_FRAME_TAG_INJECT 0xC2  // Host -> device, record to replay
+
+namespace SerialFrame
+{
+    inline uint16_t crc16(const uint8_t *data, size_t length)
+    {
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 0; i < length; i++)
+        {
+            crc ^= (uint16_t)data[i] << 8;
+            for (uint8_t bit = 0; bit < 8; bit++)
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+        return crc;
+    }
+
+    inline void putU16(uint8_t *out, uint16_t value)
+    {
+        out[0] = (uint8_t)value;
+        out[1] = (uint8_t)(value >> 8);
+    }
+
+    inline void putU32(uint8_t *out, uint32_t value)
+    {
+        putU16(out, (uint16_t)value);
+        putU16(out + 2, (uint16_t)(value >> 16));
+    }
+
+    // Encodes `length` bytes and appends the 0x00 delimiter, returns bytes written
+    inline size_t cobsEncode(const uint8_t *in, size_t length, uint8_t *out)
+    {
+        size_t codeIndex = 0;
+        size_t writeIndex = 1;
+        uint8_t code = 1;
+
+        for (size_t i = 0; i < length; i++)
+        {
+            if (in[i] == 0)
+            {
+                out[codeIndex] = code;
+                codeIndex = writeIndex++;
+                code = 1;
+                continue;
+            }
+            out[writeIndex++] = in[i];
+            if (++code == 0xFF)
+            {
+                out[codeIndex] = code;
+                codeIndex = writeIndex++;
+                code = 1;
+            }
+        }
+        out[codeIndex] = code;
+        out[writeIndex++] = 0;
+        return writeIndex;
+    }
+
+    inline uint16_t getU16(const uint8_t *in)
+    {
+        return (uint16_t)(in[0] | (in[1] << 8));
+    }
+
+    inline uint32_t getU32(const uint8_t *in)
+    {
+        return getU16(in) | ((uint32_t)getU16(in + 2) << 16);
+    }
+
+    // Decodes one frame without its 0x00 delimiter, returns decoded length or 0 if malformed
+    inline size_t cobsDecode(const uint8_t *in, size_t length, uint8_t *out)
+    {
+        size_t readIndex = 0;
+        size_t writeIndex = 0;
+
+        while (readIndex < length)
+        {
+            uint8_t code = in[readIndex];
+            if (code == 0 || readIndex + code > length)
+                return 0;
+            readIndex++;
+            for (uint8_t i = 1; i < code; i++)
+                out[writeIndex++] = in[readIndex++];
+            if (code < 0xFF && readIndex < length)
+                out[writeIndex++] = 0;
+        }
+        return writeIndex;
+    }
+}
+
+#endif // SERIAL_FRAME_H
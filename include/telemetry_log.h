@@ -0,0 +1,96 @@
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+
+// Append-only history of the local touch and battery readings in SPIFFS.
+//
+// The log is a ring of segment files /tlog_NNNNN.bin. Each starts with
+//   "TLOG", u8 version, three reserved bytes, u64 base time (log clock ms)
+// followed by records:
+//   varint((time - previous time) << 2 | type)
+//   type TELEMETRY_RECORD_BATTERY is followed by zigzag varint(tenths - previous tenths)
+// Deltas restart from the base time and 0 % in every segment, so each segment
+// decodes on its own and the oldest one can simply be deleted.
+//
+// Times are on a log clock: milliseconds of logged uptime, continued across
+// reboots from the last record, so time spent powered off is not counted.
+// Records are buffered in RAM and written every TELEMETRY_FLUSH_INTERVAL.
+
+#define TELEMETRY_FILE_PREFIX "/tlog_"
+#define TELEMETRY_FILE_VERSION 1
+#define TELEMETRY_HEADER_SIZE 16
+#define TELEMETRY_MAX_RECORD_SIZE 13 // Two varints: 10 bytes for the time delta, 3 for the battery delta
+
+#define TELEMETRY_RECORD_RELEASED 0
+#define TELEMETRY_RECORD_TOUCHED 1
+#define TELEMETRY_RECORD_BATTERY 2
+#define TELEMETRY_RECORD_BOOT 3
+
+struct TelemetrySegment
+{
+    uint32_t number;
+    uint64_t firstMs;
+    uint64_t lastMs;
+    uint32_t bytes;
+};
+
+class TelemetryLog
+{
+private:
+    TelemetrySegment segments[TELEMETRY_MAX_SEGMENTS];
+    uint8_t segmentCount;
+    volatile bool ready;
+
+    // File access is serialised between loop() (flush) and the web task (queries)
+    SemaphoreHandle_t fileMutex;
+    portMUX_TYPE bufferMux;
+
+    uint8_t buffer[TELEMETRY_BUFFER_BYTES];
+    size_t bufferLength;
+
+    // Encoder state at the end of the buffer
+    uint64_t lastMs;
+    int32_t lastBatteryTenths;
+
+    // Set when the buffered records start a segment not created yet
+    bool rotatePending;
+    uint64_t pendingBaseMs;
+
+    int64_t clockOffsetMs;
+    unsigned long lastFlushMs;
+    unsigned long lastFailedFlushMs;
+    bool flushFailing; // SPIFFS full or failing: only retried every TELEMETRY_FLUSH_RETRY_INTERVAL
+    unsigned long lastBatteryLogMs;
+    int lastTouched;
+    int32_t loggedBatteryTenths;
+    uint32_t droppedRecords;
+
+    static String segmentPath(uint32_t number);
+    bool scanSegment(TelemetrySegment &segment, int32_t &endBatteryTenths);
+    bool createSegment(uint32_t number, uint64_t baseMs);
+    void append(uint8_t type, int32_t batteryTenths);
+    bool flush();
+
+public:
+    TelemetryLog();
+
+    // Recovers the segment index; needs SPIFFS mounted
+    bool begin();
+    bool isReady() const { return ready; }
+
+    // Called with every touch sample: logs edges, and the battery at most every TELEMETRY_BATTERY_INTERVAL
+    void update(bool touched, uint16_t batteryTenths);
+    void handle();
+
+    uint64_t now() const { return (uint64_t)(clockOffsetMs + (int64_t)millis()); }
+
+    // Readings in [fromMs, toMs], at most `limit` of them; safe from the web task
+    String query(uint64_t fromMs, uint64_t toMs, uint32_t limit);
+    String getIndexJSON();
+};
+
+#endif // TELEMETRY_LOG_H
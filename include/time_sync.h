@@ -0,0 +1,108 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "config.h"
+#include "espnow_manager.h"
+#include "espnow_message.h"
+
+// Shared microsecond timebase across pads, so the receiver can order touches
+// on different pads and line up their histories.
+//
+// The master (the receiver) broadcasts a beacon every TIME_SYNC_BEACON_INTERVAL.
+// Its clock is read in the send callback, once the beacon has left the
+// radio, and carried by the next beacon (previousTxUs). Followers timestamp
+// every beacon on arrival and pair that with the master time the next one
+// brings, so queueing before transmission does not end up in the offset.
+// A least-squares fit over the last TIME_SYNC_WINDOW pairs gives offset and
+// drift; the error of each new beacon against the fit's prediction is the
+// reported sync error.
+//
+// Not compensated: air time and the receive path latency (tens of us, the
+// same for every follower, so ordering between pads is unaffected).
+
+struct TimeSyncSample
+{
+    int64_t localUs;  // Our esp_timer when the beacon arrived
+    int64_t masterUs; // Master's esp_timer when it left
+};
+
+// The fit as of the last handle(), for getJSON() on the web server task
+struct TimeSyncStatus
+{
+    bool locked;
+    uint8_t sampleCount;
+    int64_t fitLocalUs;
+    double fitOffsetUs;
+    double fitDrift;
+    int32_t lastErrorUs;
+    uint32_t avgErrorQ4;
+    uint32_t maxErrorUs;
+    uint32_t rejectedBeacons;
+    uint32_t resets;
+};
+
+class TimeSync
+{
+private:
+    EspNowManager *espNow;
+    bool master;
+    portMUX_TYPE mux;
+
+    // Master
+    uint32_t beaconSequence;
+    uint32_t beaconsSent;
+    unsigned long lastBeaconMs;
+
+    // Follower, written on the WiFi task under mux
+    uint8_t masterMac[6];
+    bool hasMaster;
+    bool masterChanged;
+    uint32_t lastRxSequence;
+    int64_t lastRxUs;
+    volatile unsigned long lastBeaconHeardMs;
+    uint32_t beaconsReceived;
+    TimeSyncSample pendingSample;
+    bool samplePending;
+
+    // Fit, loop() only
+    TimeSyncSample samples[TIME_SYNC_WINDOW];
+    uint8_t sampleCount;
+    uint8_t nextSample;
+    int64_t fitLocalUs;
+    double fitOffsetUs; // Master minus local at fitLocalUs
+    double fitDrift;    // Change of the offset per local us
+    bool locked;
+    uint8_t outlierRun;
+    int32_t lastErrorUs;
+    uint32_t avgErrorQ4; // Smoothed absolute error, us in Q4
+    uint32_t maxErrorUs;
+    uint32_t rejectedBeacons;
+    uint32_t resets;
+    TimeSyncStatus published; // Under mux
+
+    void sendBeacon(unsigned long now);
+    void addSample(const TimeSyncSample &sample);
+    void fit();
+    void reset();
+    void publish();
+
+public:
+    TimeSync();
+
+    void begin(EspNowManager *espNowManager, bool isMaster);
+    void handle(); // Sends beacons (master) or folds received ones into the fit (follower)
+
+    // Called on the WiFi task for every beacon frame
+    void onBeacon(const uint8_t *mac, const struct_time_beacon &beacon, int64_t rxUs);
+
+    bool isMaster() const { return master; }
+    bool isSynced() const { return master || locked; }
+    int64_t toSyncedUs(int64_t localUs) const;
+    int64_t nowUs() const { return toSyncedUs(esp_timer_get_time()); }
+    uint16_t getSyncErrorUs() const; // 0xFFFF while not synced
+    String getJSON(); // Any task
+};
+
+#endif // TIME_SYNC_H
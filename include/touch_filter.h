@@ -0,0 +1,99 @@
+#ifndef TOUCH_FILTER_H
+#define TOUCH_FILTER_H
+
+#include <stdint.h>
+
+// Capacitive touch processing: integer IIR low-pass, adaptive baseline,
+// hysteresis and debounce. Values are kept in Q8 fixed point. No Arduino
+// dependencies, so recorded touchRead() traces can be replayed on the host.
+
+struct TouchFilterConfig
+{
+    uint8_t filterShift = 2;        // Low-pass weight of a new sample: 1/2^filterShift
+    uint8_t baselineShift = 7;      // Baseline drift tracking weight: 1/2^baselineShift
+    uint8_t recoverShift = 3;       // Faster baseline weight when the signal moves away from touch
+    uint32_t touchThreshold = 8;    // Delta from baseline (raw counts) that starts a touch
+    uint32_t releaseThreshold = 5;  // Delta below which a touch is released
+    uint8_t debounceSamples = 3;    // Consecutive samples needed to change state
+    bool touchDecreases = true;     // ESP32 readings drop when touched, S2/S3 readings rise
+};
+
+class TouchFilter
+{
+private:
+    TouchFilterConfig config;
+    int32_t filteredQ8 = 0;
+    int32_t baselineQ8 = 0;
+    bool primed = false;
+    bool touched = false;
+    uint8_t pendingSamples = 0;
+
+    int32_t getDeltaQ8() const
+    {
+        return config.touchDecreases ? baselineQ8 - filteredQ8 : filteredQ8 - baselineQ8;
+    }
+
+public:
+    void setConfig(const TouchFilterConfig &cfg)
+    {
+        config = cfg;
+        pendingSamples = 0;
+    }
+
+    const TouchFilterConfig &getConfig() const { return config; }
+
+    void reset()
+    {
+        primed = false;
+        touched = false;
+        pendingSamples = 0;
+    }
+
+    // Feeds one raw reading, returns the debounced touch state
+    bool update(uint32_t raw)
+    {
+        int32_t sampleQ8 = (int32_t)(raw << 8);
+        if (!primed)
+        {
+            filteredQ8 = sampleQ8;
+            baselineQ8 = sampleQ8;
+            primed = true;
+            return touched;
+        }
+
+        filteredQ8 += (sampleQ8 - filteredQ8) >> config.filterShift;
+
+        int32_t deltaQ8 = getDeltaQ8();
+        int32_t thresholdQ8 = (int32_t)((touched ? config.releaseThreshold : config.touchThreshold) << 8);
+        bool candidate = deltaQ8 > thresholdQ8;
+
+        if (candidate != touched)
+        {
+            if (++pendingSamples >= config.debounceSamples)
+            {
+                touched = candidate;
+                pendingSamples = 0;
+            }
+        }
+        else
+        {
+            pendingSamples = 0;
+        }
+
+        // Follow slow drift (humidity, temperature) only while untouched
+        if (!touched && !candidate)
+        {
+            uint8_t shift = deltaQ8 < 0 ? config.recoverShift : config.baselineShift;
+            baselineQ8 += (filteredQ8 - baselineQ8) >> shift;
+        }
+
+        return touched;
+    }
+
+    bool isTouched() const { return touched; }
+    int32_t getFiltered() const { return filteredQ8 >> 8; }
+    int32_t getBaseline() const { return baselineQ8 >> 8; }
+    int32_t getDelta() const { return getDeltaQ8() >> 8; }
+};
+
+#endif // TOUCH_FILTER_H
@@ -0,0 +1,119 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <Arduino.h>
+#include <freertos/task.h>
+#include "config.h"
+
+#define TRACE_MAX_CORES 2
+#define TRACE_MAX_NAMED_TASKS 4
+#define TRACE_ANCHOR_CYCLES 0x40000000UL // ~4.5 s at 240 MHz, a quarter of the counter's wrap
+
+#define TRACE_BEGIN 1
+#define TRACE_END 2
+#define TRACE_ANCHOR 3
+#define TRACE_ANCHOR_CONTINUED 4 // Same counter run as the core's previous anchor, good for events before it
+
+// Begin/end events for chrome://tracing and ui.perfetto.dev, to see what a
+// slow loop() was busy with: the display, an ADC burst, a web handler, WiFi.
+// Events go into a fixed ring of TRACE_BUFFER_EVENTS in RAM, the oldest are
+// overwritten, and GET /trace/download streams it out as JSON once stopped.
+//
+// Timestamps are CPU cycle counts, a single register read. The counter is per
+// core, wraps every ~18 s and stops in light sleep, so each core writes an
+// anchor (cycle count, esp_timer time, CPU MHz) before its first event after
+// start() or resync(), and again once the last one is TRACE_ANCHOR_CYCLES old
+// or half the ring back. The export converts from the anchor before each
+// event, or for the oldest events from the core's first anchor in the ring
+// when no resync came between; anything else is skipped.
+//
+// Only the name pointer is stored: names must be string literals.
+class TraceRecorder
+{
+private:
+    static volatile bool active;
+
+public:
+    static void start();
+    static void stop();
+    static bool isActive() { return active; }
+
+    // After light sleep or a CPU frequency change the cycle counter no longer lines up
+    static void resync();
+
+    static void record(uint8_t type, const char *name);
+
+    // Threads show up under this name instead of a number in the trace
+    static void nameTask(const char *name);
+
+    static String getStatusJSON();
+};
+
+// The stopped ring as chrome://tracing JSON, produced a few entries at a time
+// for a chunked response: a full ring is ~70 KB of text, too much to build in
+// one String. Reads the ring in place; once recording starts again the
+// remaining events are left out.
+class TraceExport
+{
+private:
+    struct CoreAnchor
+    {
+        bool valid;
+        uint64_t timeNs;
+        uint32_t cycles;
+        uint16_t mhz;
+    };
+    CoreAnchor anchors[TRACE_MAX_CORES];
+    CoreAnchor oldest[TRACE_MAX_CORES]; // Valid when events before it may use it
+
+    // Threads are numbered in order of appearance, depth drops an end whose begin was overwritten
+    TaskHandle_t tasks[TRACE_MAX_NAMED_TASKS * 4];
+    uint16_t depth[TRACE_MAX_NAMED_TASKS * 4];
+    uint8_t taskCount;
+
+    uint32_t first;
+    uint32_t total;
+    uint32_t position; // Next event, then next thread name
+    uint8_t stage;
+    bool firstEntry;
+    uint32_t skipped;
+
+    char entry[192]; // Entry being handed out, may take several reads
+    size_t entryLength;
+    size_t entrySent;
+
+    bool nextEntry(); // False once the closing entry was produced
+
+public:
+    TraceExport();
+    size_t read(uint8_t *buffer, size_t maxLength); // 0 once everything was read
+};
+
+// Begin event now, end event when it goes out of scope
+class TraceScope
+{
+private:
+    const char *name;
+
+public:
+    TraceScope(const char *scopeName) : name(scopeName)
+    {
+        if (TraceRecorder::isActive())
+            TraceRecorder::record(TRACE_BEGIN, name);
+    }
+    ~TraceScope()
+    {
+        if (TraceRecorder::isActive())
+            TraceRecorder::record(TRACE_END, name);
+    }
+};
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif // TRACE_RECORDER_H
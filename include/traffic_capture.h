@@ -0,0 +1,99 @@
+#ifndef TRAFFIC_CAPTURE_H
+#define TRAFFIC_CAPTURE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <esp_now.h>
+#include <freertos/ringbuf.h>
+#include "serial_frame.h"
+
+// Capture of ESP-NOW traffic for offline replay (tools/capture_replay.py).
+//
+// Record, little endian:
+//   u8  kind (CAPTURE_KIND_RX / CAPTURE_KIND_TX)
+//   u32 timestamp (us since the capture started)
+//   u8  mac[6] (sender for RX, all zero for a send to every peer)
+//   u8  payload length
+//   payload
+//
+// SPIFFS captures start with "ENCP", u8 version, three reserved bytes and
+// u32 millis() at start, followed by records back to back. Serial captures
+// send each record as a SerialFrame: SERIAL_FRAME_TAG_CAPTURE, record, CRC-16,
+// COBS encoded. The host replays records to the device the same way with
+// SERIAL_FRAME_TAG_INJECT.
+
+#define CAPTURE_FILE_MAGIC "ENCP"
+#define CAPTURE_FILE_VERSION 1
+#define CAPTURE_FILE_HEADER_SIZE 12
+#define CAPTURE_RECORD_HEADER_SIZE 12
+#define CAPTURE_RECORD_MAX_SIZE (CAPTURE_RECORD_HEADER_SIZE + ESP_NOW_MAX_DATA_LEN)
+#define CAPTURE_SERIAL_MAX_PAYLOAD (1 + CAPTURE_RECORD_MAX_SIZE + SERIAL_FRAME_CRC_SIZE)
+#define CAPTURE_SERIAL_MAX_ENCODED (CAPTURE_SERIAL_MAX_PAYLOAD + CAPTURE_SERIAL_MAX_PAYLOAD / 254 + 2)
+
+#define CAPTURE_KIND_RX 1
+#define CAPTURE_KIND_TX 2
+
+class TrafficCapture
+{
+public:
+    enum Sink
+    {
+        SINK_NONE,
+        SINK_SPIFFS,
+        SINK_SERIAL
+    };
+
+    typedef void (*InjectHandler)(const uint8_t *mac, const uint8_t *data, int len);
+
+private:
+    HardwareSerial *serialPort;
+    RingbufHandle_t ring;
+    Sink sink;
+    File file;
+    uint32_t startMicros;
+    unsigned long lastFlushMs;
+    volatile bool active;
+
+    // Start/stop come from the web server task, applied in handle()
+    volatile Sink requestedSink;
+    volatile bool stopRequested;
+
+    uint32_t records;
+    uint32_t bytesWritten;
+    volatile uint32_t droppedRecords;
+
+    InjectHandler injectHandler;
+    uint8_t inputBuffer[CAPTURE_SERIAL_MAX_ENCODED];
+    size_t inputLength;
+    uint32_t injectedFrames;
+    uint32_t rejectedFrames;
+
+    uint8_t encoded[CAPTURE_SERIAL_MAX_ENCODED];
+
+    bool startCapture(Sink target);
+    void stopCapture();
+    void drainRing();
+    void writeRecord(const uint8_t *record, size_t length);
+    void pollInjection();
+    void handleInjectedFrame(const uint8_t *frame, size_t length);
+
+public:
+    TrafficCapture();
+
+    bool begin(HardwareSerial *port);
+    void handle();
+
+    // Safe from the WiFi task; a full ring buffer drops the record and counts it
+    void record(uint8_t kind, const uint8_t *mac, const uint8_t *data, int len);
+
+    void requestStart(Sink target) { requestedSink = target; }
+    void requestStop() { stopRequested = true; }
+    bool isActive() const { return active; }
+
+    // Frames arriving as SERIAL_FRAME_TAG_INJECT are passed here, nullptr disables input
+    void setInjectHandler(InjectHandler handler) { injectHandler = handler; }
+
+    String getStatusJSON();
+};
+
+#endif // TRAFFIC_CAPTURE_H
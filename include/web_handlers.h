@@ -5,6 +5,11 @@
 #include <AsyncTCP.h>          // Required for ESPAsyncWebServer
 #include <SPIFFS.h>
 #include "sensor_manager.h"
+#include "link_monitor.h"
+#include "traffic_capture.h"
+#include "telemetry_log.h"
+#include "time_sync.h"
+#include "rate_limiter.h"
 
 class ClientIdentity; // Forward declaration
 
@@ -14,23 +19,45 @@ private:
     AsyncWebServer *server; // Changed from WebServer
     SensorManager *sensorManager;
     ClientIdentity *clientIdentity;
+    LinkMonitor *linkMonitor;
+    TrafficCapture *trafficCapture;
+    TelemetryLog *telemetryLog;
+    TimeSync *timeSync;
+    RateLimiter heavyRequests; // Shared by the endpoints that iterate the store or read SPIFFS
 
     // Helper methods
     String getContentType(String filename);
     bool sendFile(String path, AsyncWebServerRequest *request);
     bool isValidFileExtension(String filename);
     void sendJsonResponse(AsyncWebServerRequest *request, bool success, String message = "", String data = "");
+    bool admitHeavyRequest(AsyncWebServerRequest *request); // Sends 429 and returns false over the rate
+    void sendSnapshotJson(AsyncWebServerRequest *request, const String &json);
 
 public:
-    WebHandlers(AsyncWebServer *webServer, SensorManager *sensorMgr, ClientIdentity *clientIdentity);
+    WebHandlers(AsyncWebServer *webServer, SensorManager *sensorMgr, ClientIdentity *clientIdentity, LinkMonitor *linkMonitor, TrafficCapture *trafficCapture, TelemetryLog *telemetryLog, TimeSync *timeSync);
     void setupRoutes();
 
     // Route handlers
     void handleRoot(AsyncWebServerRequest *request);
     void handleStaticFile(AsyncWebServerRequest *request);
     void handleSensorData(AsyncWebServerRequest *request);
+    void handleSensorBatch(AsyncWebServerRequest *request);
+    void handleSensorBatchBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
     void handleGetSensorData(AsyncWebServerRequest *request);
     void handleGetLocalSensorData(AsyncWebServerRequest *request);
+    void handleGetBootStats(AsyncWebServerRequest *request);
+    void handleGetLinkStats(AsyncWebServerRequest *request);
+    void handleGetTimeSync(AsyncWebServerRequest *request);
+    void handleGetCapture(AsyncWebServerRequest *request);
+    void handleSetCapture(AsyncWebServerRequest *request);
+    void handleDownloadCapture(AsyncWebServerRequest *request);
+    void handleGetTrace(AsyncWebServerRequest *request);
+    void handleSetTrace(AsyncWebServerRequest *request);
+    void handleDownloadTrace(AsyncWebServerRequest *request);
+    void handleGetTelemetry(AsyncWebServerRequest *request);
+    void handleGetTelemetryIndex(AsyncWebServerRequest *request);
+    void handleGetTouchConfig(AsyncWebServerRequest *request);
+    void handleSetTouchConfig(AsyncWebServerRequest *request);
     void handleSensorDataPage(AsyncWebServerRequest *request);
     void handleSetClientId(AsyncWebServerRequest *request);
     void handleUpload(AsyncWebServerRequest *request);
@@ -3,14 +3,55 @@
 
 #include <WiFi.h>
 #include <ArduinoOTA.h>
+#include <Preferences.h>
 
 class WiFiManager
 {
 private:
-    unsigned long lastReconnectAttempt;
+    enum State
+    {
+        STATE_IDLE,
+        STATE_CONNECTING,
+        STATE_CONNECTED,
+        STATE_BACKOFF
+    };
+
+    State state;
+    Preferences preferences;
+
+    // Set from the WiFi event task, consumed in handleConnection()
+    volatile bool gotIpEvent;
+    volatile bool disconnectedEvent;
+    volatile uint8_t lastDisconnectReason;
+
+    // Last known AP, used to skip the channel scan on reconnect
+    uint8_t cachedBssid[6];
+    int32_t cachedChannel;
+    bool hasCachedAp;
+    bool fastConnectInProgress;
+
+    unsigned long attemptStartedAt;
+    unsigned long outageStartedAt;
+    unsigned long backoffUntil;
+    uint8_t failedAttempts;
+    bool otaReady;
+    bool everConnected;
+
+    // Timing statistics
+    unsigned long firstConnectMs;
+    unsigned long lastConnectMs;
+    unsigned long lastOutageMs;
+    uint32_t reconnectCount;
 
     void setupOTA();
     void printWiFiStatus();
+    void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+    void startConnect(unsigned long now);
+    void onConnected(unsigned long now);
+    void scheduleBackoff(unsigned long now);
+    void loadCachedAp();
+    void saveCachedAp();
+    void clearCachedAp();
 
 public:
     WiFiManager();
@@ -18,7 +59,16 @@ public:
     bool init();
     void handleConnection();
     bool isConnected();
+    bool isConnecting() const { return state == STATE_CONNECTING; }
     void printConnectionInfo();
+
+    // Channel of the last known AP, 0 if none has been cached yet
+    int32_t getCachedChannel() const { return hasCachedAp ? cachedChannel : 0; }
+
+    unsigned long getFirstConnectMs() const { return firstConnectMs; }
+    unsigned long getLastConnectMs() const { return lastConnectMs; }
+    unsigned long getLastOutageMs() const { return lastOutageMs; }
+    uint32_t getReconnectCount() const { return reconnectCount; }
 };
 
-#endif // WIFI_MANAGER_H
\ No newline at end of file
+#endif // WIFI_MANAGER_H
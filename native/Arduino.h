@@ -0,0 +1,84 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Thin host HAL for the `native` PlatformIO environment: just enough of the
+// Arduino-ESP32 core and ESP-IDF for the platform-independent modules to
+// build and run on a PC (see bench/). Time is virtual and only moves when
+// the caller advances it, pins and touch channels read what was set.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "WString.h"
+#include "HardwareSerial.h"
+#include "IPAddress.h"
+
+#define CONFIG_IDF_TARGET_ESP32 1
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define BIT(n) (1UL << (n))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::max;
+using std::min;
+
+typedef enum
+{
+    ADC_0db,
+    ADC_2_5db,
+    ADC_6db,
+    ADC_11db
+} adc_attenuation_t;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+uint32_t esp_random();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+uint16_t analogRead(uint8_t pin);
+void analogSetPinAttenuation(uint8_t pin, adc_attenuation_t attenuation);
+int8_t digitalPinToAnalogChannel(uint8_t pin);
+int8_t digitalPinToTouchChannel(uint8_t pin);
+
+class EspClass
+{
+public:
+    void restart();
+    uint32_t getFreeHeap();
+    uint32_t getCycleCount(); // Virtual clock at 240 MHz
+    uint32_t getCpuFreqMHz() { return 240; }
+};
+extern EspClass ESP;
+
+// Controls for the fakes, not part of the Arduino API
+namespace NativeHal
+{
+    void advanceMicros(uint64_t us);
+    inline void advanceMillis(uint32_t ms) { advanceMicros((uint64_t)ms * 1000); }
+    uint64_t nowMicros();
+    void setDigital(uint8_t pin, int value);
+    void setAnalog(uint8_t pin, uint16_t value);
+    void setTouchRaw(uint8_t channel, uint32_t value);
+    uint32_t getTouchRaw(uint8_t channel);
+    uint32_t getRestartCount();
+}
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,17 @@
+#ifndef NATIVE_ASYNC_TCP_H
+#define NATIVE_ASYNC_TCP_H
+
+#include "IPAddress.h"
+
+class AsyncClient
+{
+private:
+    IPAddress remote;
+
+public:
+    AsyncClient() : remote(192, 168, 1, 50) {}
+    IPAddress remoteIP() const { return remote; }
+    void setRemoteIP(const IPAddress &address) { remote = address; }
+};
+
+#endif // NATIVE_ASYNC_TCP_H
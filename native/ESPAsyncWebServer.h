@@ -0,0 +1,234 @@
+#ifndef NATIVE_ESP_ASYNC_WEB_SERVER_H
+#define NATIVE_ESP_ASYNC_WEB_SERVER_H
+
+#include <functional>
+#include <vector>
+#include "Arduino.h"
+#include "AsyncTCP.h"
+#include "FS.h"
+
+// Mock of the ESPAsyncWebServer surface the handlers use. Requests are built
+// by the caller, dispatched with the library's matching rules, and the
+// response is recorded on the request instead of being sent.
+
+typedef enum
+{
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_ANY = 0b01111111
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter
+{
+private:
+    String paramName;
+    String paramValue;
+    bool post;
+
+public:
+    AsyncWebParameter(const String &name, const String &value, bool isPost)
+        : paramName(name), paramValue(value), post(isPost) {}
+    const String &name() const { return paramName; }
+    const String &value() const { return paramValue; }
+    bool isPost() const { return post; }
+};
+
+typedef std::function<size_t(uint8_t *buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+
+#define NATIVE_WEB_CHUNK_SIZE 1024 // Room the filler gets per call, about what a TCP window leaves
+
+// Only chunked responses: the filler is drained when the request sends it
+class AsyncWebServerResponse
+{
+private:
+    int code;
+    String type;
+    AwsResponseFiller filler;
+
+public:
+    AsyncWebServerResponse(int status, const String &contentType, AwsResponseFiller fill)
+        : code(status), type(contentType), filler(fill) {}
+    void addHeader(const String &name, const String &value)
+    {
+        (void)name;
+        (void)value;
+    }
+    int status() const { return code; }
+    const String &contentType() const { return type; }
+    size_t fill(uint8_t *buffer, size_t maxLen, size_t index) { return filler(buffer, maxLen, index); }
+};
+
+class AsyncWebServerRequest
+{
+private:
+    WebRequestMethod requestMethod;
+    String requestUrl;
+    std::vector<AsyncWebParameter> params;
+    AsyncClient remote;
+
+    std::vector<uint8_t> requestBody;
+
+    int code;
+    String type;
+    String body;
+    size_t chunks;
+
+public:
+    void *_tempObject; // Handler scratch space, free()d with the request like in the library
+
+    AsyncWebServerRequest(WebRequestMethod method, const String &url)
+        : requestMethod(method), requestUrl(url), code(0), chunks(0), _tempObject(nullptr) {}
+    ~AsyncWebServerRequest() { free(_tempObject); }
+    AsyncWebServerRequest(const AsyncWebServerRequest &) = delete;
+    AsyncWebServerRequest &operator=(const AsyncWebServerRequest &) = delete;
+
+    WebRequestMethod method() const { return requestMethod; }
+    const String &url() const { return requestUrl; }
+    size_t contentLength() const { return requestBody.size(); }
+    AsyncClient *client() { return &remote; }
+
+    bool hasParam(const String &name, bool post = false) const { return getParam(name, post) != nullptr; }
+    const AsyncWebParameter *getParam(const String &name, bool post = false) const
+    {
+        for (const AsyncWebParameter &param : params)
+        {
+            if (param.isPost() == post && param.name() == name)
+                return &param;
+        }
+        return nullptr;
+    }
+
+    void send(int status, const String &contentType = String(), const String &content = String())
+    {
+        code = status;
+        type = contentType;
+        body = content;
+    }
+    AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller callback)
+    {
+        return new AsyncWebServerResponse(200, contentType, callback);
+    }
+    void send(AsyncWebServerResponse *response)
+    {
+        code = response->status();
+        type = response->contentType();
+        body = String();
+        chunks = 0;
+        uint8_t buffer[NATIVE_WEB_CHUNK_SIZE];
+        size_t index = 0;
+        size_t length;
+        while ((length = response->fill(buffer, sizeof(buffer), index)) > 0)
+        {
+            body.concat((const char *)buffer, length);
+            index += length;
+            chunks++;
+        }
+        delete response;
+    }
+    void send(FS &fs, const String &path, const String &contentType = String(), bool download = false)
+    {
+        (void)download;
+        File file = fs.open(path, "r");
+        if (!file)
+        {
+            send(404);
+            return;
+        }
+        String content;
+        content.reserve(file.size());
+        int byte;
+        while ((byte = file.read()) >= 0)
+            content += (char)byte;
+        send(200, contentType, content);
+    }
+
+    // Test side
+    AsyncWebServerRequest &addParam(const String &name, const String &value, bool post = false)
+    {
+        params.emplace_back(name, value, post);
+        return *this;
+    }
+    AsyncWebServerRequest &setBody(const uint8_t *data, size_t length)
+    {
+        requestBody.assign(data, data + length);
+        return *this;
+    }
+    AsyncWebServerRequest &setBody(const String &text) { return setBody((const uint8_t *)text.c_str(), text.length()); }
+    std::vector<uint8_t> &bodyBytes() { return requestBody; }
+    int responseCode() const { return code; }
+    const String &responseType() const { return type; }
+    const String &responseBody() const { return body; }
+    size_t responseChunks() const { return chunks; } // 0 unless the response was chunked
+};
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)> ArBodyHandlerFunction;
+
+#define NATIVE_WEB_SEGMENT_SIZE 1436 // Body chunks are handed over per TCP segment
+
+class AsyncWebServer
+{
+private:
+    struct Route
+    {
+        String uri;
+        WebRequestMethodComposite methods;
+        ArRequestHandlerFunction handler;
+        ArUploadHandlerFunction upload;
+        ArBodyHandlerFunction body;
+    };
+    std::vector<Route> routes;
+    ArRequestHandlerFunction notFound;
+
+public:
+    explicit AsyncWebServer(uint16_t port) { (void)port; }
+
+    void begin() {}
+    void on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest)
+    {
+        routes.push_back({String(uri), method, onRequest, nullptr, nullptr});
+    }
+    void on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload)
+    {
+        routes.push_back({String(uri), method, onRequest, onUpload, nullptr});
+    }
+    void on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody)
+    {
+        routes.push_back({String(uri), method, onRequest, onUpload, onBody});
+    }
+    void onNotFound(ArRequestHandlerFunction fn) { notFound = fn; }
+
+    // First route in registration order whose URI equals the path or is a
+    // "/"-separated prefix of it, as AsyncCallbackWebHandler::canHandle() does
+    void handle(AsyncWebServerRequest *request)
+    {
+        for (const Route &route : routes)
+        {
+            if (!(route.methods & request->method()))
+                continue;
+            if (route.uri != request->url() && !request->url().startsWith(route.uri + "/"))
+                continue;
+            if (route.body)
+            {
+                std::vector<uint8_t> &body = request->bodyBytes();
+                for (size_t index = 0; index < body.size(); index += NATIVE_WEB_SEGMENT_SIZE)
+                {
+                    size_t len = std::min(body.size() - index, (size_t)NATIVE_WEB_SEGMENT_SIZE);
+                    route.body(request, body.data() + index, len, index, body.size());
+                }
+            }
+            route.handler(request);
+            return;
+        }
+        if (notFound)
+            notFound(request);
+        else
+            request->send(404);
+    }
+};
+
+#endif // NATIVE_ESP_ASYNC_WEB_SERVER_H
@@ -0,0 +1,75 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WString.h"
+
+namespace fs
+{
+    // In-memory flat filesystem; a File keeps its entry alive after a remove()
+    struct NativeFileData
+    {
+        std::string path;
+        std::vector<uint8_t> bytes;
+    };
+
+    class File
+    {
+    private:
+        std::shared_ptr<NativeFileData> data;
+        std::vector<std::shared_ptr<NativeFileData>> listing; // Directory handles only
+        size_t offset;
+        size_t nextEntry;
+        bool writable;
+        bool directory;
+        String baseName;
+
+    public:
+        File();
+        File(std::shared_ptr<NativeFileData> file, bool canWrite, bool append);
+        File(std::vector<std::shared_ptr<NativeFileData>> entries);
+
+        explicit operator bool() const { return data != nullptr || directory; }
+        size_t write(uint8_t byte) { return write(&byte, 1); }
+        size_t write(const uint8_t *buffer, size_t length);
+        int read();
+        int read(uint8_t *buffer, size_t length);
+        int available() const { return data ? (int)(data->bytes.size() - offset) : 0; }
+        bool seek(size_t offset);
+        size_t position() const { return offset; }
+        size_t size() const { return data ? data->bytes.size() : 0; }
+        void flush() {}
+        void close();
+        const char *name() const { return baseName.c_str(); }
+        const char *path() const { return data ? data->path.c_str() : "/"; }
+        bool isDirectory() const { return directory; }
+        File openNextFile();
+    };
+
+    class FS
+    {
+    private:
+        std::map<std::string, std::shared_ptr<NativeFileData>> files;
+
+    public:
+        File open(const String &path, const char *mode = "r");
+        File open(const char *path, const char *mode = "r") { return open(String(path), mode); }
+        bool exists(const String &path) const { return files.count(path.c_str()) > 0; }
+        bool remove(const String &path) { return files.erase(path.c_str()) > 0; }
+        bool rename(const String &from, const String &to);
+        size_t usedBytes() const;
+
+        // Host side
+        void clear() { files.clear(); }
+    };
+}
+
+using fs::File;
+using fs::FS;
+
+#endif // NATIVE_FS_H
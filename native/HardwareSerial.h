@@ -0,0 +1,66 @@
+#ifndef NATIVE_HARDWARE_SERIAL_H
+#define NATIVE_HARDWARE_SERIAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <deque>
+#include "WString.h"
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t byte) = 0;
+    virtual size_t write(const uint8_t *data, size_t length);
+    size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+
+    size_t print(const char *text) { return write(text); }
+    size_t print(const String &text) { return write((const uint8_t *)text.c_str(), text.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return print(String(value)); }
+    size_t print(unsigned int value) { return print(String(value)); }
+    size_t print(long value) { return print(String(value)); }
+    size_t print(unsigned long value) { return print(String(value)); }
+    size_t print(double value, int decimalPlaces = 2) { return print(String(value, decimalPlaces)); }
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); }
+    size_t println(double value, int decimalPlaces) { return print(value, decimalPlaces) + println(); }
+    size_t println() { return write("\r\n"); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// UART with a TX sink and an RX queue the host side fills. Output is
+// counted and dropped unless echo is on, so log lines do not skew benchmarks.
+class HardwareSerial : public Print
+{
+private:
+    std::deque<uint8_t> rx;
+    size_t txBytes;
+    int txSpace;
+    bool echo;
+
+public:
+    HardwareSerial();
+
+    void begin(unsigned long baud) { (void)baud; }
+    void setTxBufferSize(size_t size) { (void)size; }
+    void flush() {}
+
+    using Print::write;
+    size_t write(uint8_t byte) override;
+    size_t write(const uint8_t *data, size_t length) override;
+    int availableForWrite() { return txSpace; }
+    int available() { return (int)rx.size(); }
+    int read();
+
+    // Host side
+    void setEcho(bool enabled) { echo = enabled; }
+    void setTxSpace(int bytes) { txSpace = bytes; }
+    void inject(const uint8_t *data, size_t length) { rx.insert(rx.end(), data, data + length); }
+    size_t getTxBytes() const { return txBytes; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // NATIVE_HARDWARE_SERIAL_H
@@ -0,0 +1,93 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include <map>
+#include <string>
+#include "Arduino.h"
+
+// NVS stand-in: one process-wide store, namespaces kept apart by key prefix
+class Preferences
+{
+private:
+    std::string prefix;
+
+    static std::map<std::string, std::string> &store()
+    {
+        static std::map<std::string, std::string> values;
+        return values;
+    }
+    const std::string *find(const char *key) const
+    {
+        auto it = store().find(prefix + key);
+        return it != store().end() ? &it->second : nullptr;
+    }
+    size_t put(const char *key, const void *value, size_t length)
+    {
+        store()[prefix + key] = std::string((const char *)value, length);
+        return length;
+    }
+
+public:
+    bool begin(const char *name, bool readOnly = false)
+    {
+        (void)readOnly;
+        prefix = std::string(name) + "/";
+        return true;
+    }
+    void end() {}
+    bool clear()
+    {
+        auto &values = store();
+        for (auto it = values.begin(); it != values.end();)
+            it = it->first.compare(0, prefix.size(), prefix) == 0 ? values.erase(it) : std::next(it);
+        return true;
+    }
+    bool remove(const char *key) { return store().erase(prefix + key) > 0; }
+    bool isKey(const char *key) const { return find(key) != nullptr; }
+
+    size_t putInt(const char *key, int32_t value) { return put(key, &value, sizeof(value)); }
+    size_t putUInt(const char *key, uint32_t value) { return put(key, &value, sizeof(value)); }
+    size_t putChar(const char *key, int8_t value) { return put(key, &value, sizeof(value)); }
+    size_t putUChar(const char *key, uint8_t value) { return put(key, &value, sizeof(value)); }
+    size_t putBool(const char *key, bool value) { return put(key, &value, sizeof(value)); }
+    size_t putBytes(const char *key, const void *value, size_t length) { return put(key, value, length); }
+    size_t putString(const char *key, const String &value) { return put(key, value.c_str(), value.length()); }
+
+    int32_t getInt(const char *key, int32_t defaultValue = 0) const { return get(key, defaultValue); }
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0) const { return get(key, defaultValue); }
+    int8_t getChar(const char *key, int8_t defaultValue = 0) const { return get(key, defaultValue); }
+    uint8_t getUChar(const char *key, uint8_t defaultValue = 0) const { return get(key, defaultValue); }
+    bool getBool(const char *key, bool defaultValue = false) const { return get(key, defaultValue); }
+    size_t getBytesLength(const char *key) const
+    {
+        const std::string *value = find(key);
+        return value ? value->size() : 0;
+    }
+    size_t getBytes(const char *key, void *buffer, size_t maxLength) const
+    {
+        const std::string *value = find(key);
+        if (value == nullptr || value->size() > maxLength)
+            return 0;
+        memcpy(buffer, value->data(), value->size());
+        return value->size();
+    }
+    String getString(const char *key, const String &defaultValue = String()) const
+    {
+        const std::string *value = find(key);
+        return value ? String(value->c_str()) : defaultValue;
+    }
+
+private:
+    template <typename T>
+    T get(const char *key, T defaultValue) const
+    {
+        const std::string *value = find(key);
+        if (value == nullptr || value->size() != sizeof(T))
+            return defaultValue;
+        T out;
+        memcpy(&out, value->data(), sizeof(T));
+        return out;
+    }
+};
+
+#endif // NATIVE_PREFERENCES_H
@@ -0,0 +1,19 @@
+#ifndef NATIVE_SPIFFS_H
+#define NATIVE_SPIFFS_H
+
+#include "FS.h"
+
+class SPIFFSFS : public fs::FS
+{
+public:
+    bool begin(bool formatOnFail = false)
+    {
+        (void)formatOnFail;
+        return true;
+    }
+    size_t totalBytes() const { return 1441792; }
+};
+
+extern SPIFFSFS SPIFFS;
+
+#endif // NATIVE_SPIFFS_H
@@ -0,0 +1,36 @@
+#ifndef NATIVE_UPDATE_H
+#define NATIVE_UPDATE_H
+
+#include "Arduino.h"
+#include "FS.h"
+
+// Accepts any image and discards it
+class UpdateClass
+{
+private:
+    size_t expected = 0;
+    size_t written = 0;
+
+public:
+    bool begin(size_t size)
+    {
+        expected = size;
+        written = 0;
+        return true;
+    }
+    size_t writeStream(File &file)
+    {
+        uint8_t chunk[256];
+        int got;
+        while ((got = file.read(chunk, sizeof(chunk))) > 0)
+            written += got;
+        return written;
+    }
+    bool end(bool evenIfRemaining = false) { return evenIfRemaining || written == expected; }
+    void abort() { written = 0; }
+    const char *errorString() const { return "No Error"; }
+};
+
+extern UpdateClass Update;
+
+#endif // NATIVE_UPDATE_H
@@ -0,0 +1,347 @@
+#include "WString.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void String::init()
+{
+    buffer = nullptr;
+    capacity = 0;
+    len = 0;
+}
+
+bool String::grow(size_t size)
+{
+    char *resized = (char *)realloc(buffer, size + 1);
+    if (resized == nullptr)
+        return false;
+    if (buffer == nullptr)
+        resized[0] = '\0';
+    buffer = resized;
+    capacity = size;
+    return true;
+}
+
+bool String::reserve(size_t size)
+{
+    if (buffer != nullptr && capacity >= size)
+        return true;
+    return grow(size);
+}
+
+String &String::copy(const char *cstr, size_t length)
+{
+    if (!reserve(length))
+        return *this;
+    len = length;
+    memmove(buffer, cstr, length);
+    buffer[len] = '\0';
+    return *this;
+}
+
+String::String(const char *cstr)
+{
+    init();
+    if (cstr != nullptr)
+        copy(cstr, strlen(cstr));
+}
+
+String::String(const String &other)
+{
+    init();
+    copy(other.c_str(), other.len);
+}
+
+String::String(String &&other) noexcept
+{
+    buffer = other.buffer;
+    capacity = other.capacity;
+    len = other.len;
+    other.init();
+}
+
+String::String(char c)
+{
+    init();
+    copy(&c, 1);
+}
+
+static void formatInteger(String &out, unsigned long long magnitude, bool negative, unsigned char base)
+{
+    char digits[66];
+    char *p = digits + sizeof(digits) - 1;
+    *p = '\0';
+    if (base < 2 || base > 36)
+        base = 10;
+    do
+    {
+        unsigned digit = (unsigned)(magnitude % base);
+        *--p = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        magnitude /= base;
+    } while (magnitude != 0);
+    if (negative)
+        *--p = '-';
+    out = p;
+}
+
+String::String(unsigned char value, unsigned char base)
+{
+    init();
+    formatInteger(*this, value, false, base);
+}
+
+String::String(int value, unsigned char base)
+{
+    init();
+    bool negative = value < 0 && base == 10;
+    formatInteger(*this, negative ? -(long long)value : (unsigned int)value, negative, base);
+}
+
+String::String(unsigned int value, unsigned char base)
+{
+    init();
+    formatInteger(*this, value, false, base);
+}
+
+String::String(long value, unsigned char base)
+{
+    init();
+    bool negative = value < 0 && base == 10;
+    formatInteger(*this, negative ? -(long long)value : (unsigned long)value, negative, base);
+}
+
+String::String(unsigned long value, unsigned char base)
+{
+    init();
+    formatInteger(*this, value, false, base);
+}
+
+String::String(long long value, unsigned char base)
+{
+    init();
+    bool negative = value < 0 && base == 10;
+    formatInteger(*this, negative ? 0ULL - (unsigned long long)value : (unsigned long long)value, negative, base);
+}
+
+String::String(unsigned long long value, unsigned char base)
+{
+    init();
+    formatInteger(*this, value, false, base);
+}
+
+String::String(float value, unsigned int decimalPlaces)
+{
+    init();
+    char text[48];
+    snprintf(text, sizeof(text), "%.*f", (int)decimalPlaces, (double)value);
+    *this = text;
+}
+
+String::String(double value, unsigned int decimalPlaces)
+{
+    init();
+    char text[48];
+    snprintf(text, sizeof(text), "%.*f", (int)decimalPlaces, value);
+    *this = text;
+}
+
+String::~String()
+{
+    free(buffer);
+}
+
+String &String::operator=(const String &other)
+{
+    if (this != &other)
+        copy(other.c_str(), other.len);
+    return *this;
+}
+
+String &String::operator=(String &&other) noexcept
+{
+    if (this != &other)
+    {
+        free(buffer);
+        buffer = other.buffer;
+        capacity = other.capacity;
+        len = other.len;
+        other.init();
+    }
+    return *this;
+}
+
+String &String::operator=(const char *cstr)
+{
+    return cstr != nullptr ? copy(cstr, strlen(cstr)) : copy("", 0);
+}
+
+bool String::concat(const char *cstr, size_t length)
+{
+    if (length == 0)
+        return true;
+    // The source may be our own buffer, which the realloc can move
+    if (cstr >= c_str() && cstr < c_str() + len)
+    {
+        size_t offset = cstr - buffer;
+        if (!reserve(len + length))
+            return false;
+        cstr = buffer + offset;
+    }
+    else if (!reserve(len + length))
+    {
+        return false;
+    }
+    memmove(buffer + len, cstr, length);
+    len += length;
+    buffer[len] = '\0';
+    return true;
+}
+
+bool String::concat(const String &other)
+{
+    return concat(other.c_str(), other.len);
+}
+
+bool String::concat(const char *cstr)
+{
+    return cstr != nullptr && concat(cstr, strlen(cstr));
+}
+
+bool String::concat(char c)
+{
+    return concat(&c, 1);
+}
+
+int String::compareTo(const String &other) const
+{
+    return strcmp(c_str(), other.c_str());
+}
+
+bool String::equals(const String &other) const
+{
+    return len == other.len && memcmp(c_str(), other.c_str(), len) == 0;
+}
+
+bool String::equals(const char *cstr) const
+{
+    return strcmp(c_str(), cstr != nullptr ? cstr : "") == 0;
+}
+
+bool String::startsWith(const String &prefix) const
+{
+    return prefix.len <= len && memcmp(c_str(), prefix.c_str(), prefix.len) == 0;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+    return suffix.len <= len && memcmp(c_str() + len - suffix.len, suffix.c_str(), suffix.len) == 0;
+}
+
+int String::indexOf(char c, size_t from) const
+{
+    if (from >= len)
+        return -1;
+    const char *found = strchr(c_str() + from, c);
+    return found != nullptr ? (int)(found - buffer) : -1;
+}
+
+int String::indexOf(const String &needle, size_t from) const
+{
+    if (from > len)
+        return -1;
+    const char *found = strstr(c_str() + from, needle.c_str());
+    return found != nullptr ? (int)(found - c_str()) : -1;
+}
+
+String String::substring(size_t from, size_t to) const
+{
+    if (from > to)
+    {
+        size_t swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from >= len)
+        return String();
+    if (to > len)
+        to = len;
+    String out;
+    out.copy(c_str() + from, to - from);
+    return out;
+}
+
+void String::remove(size_t index)
+{
+    remove(index, (size_t)-1);
+}
+
+void String::remove(size_t index, size_t count)
+{
+    if (index >= len)
+        return;
+    if (count > len - index)
+        count = len - index;
+    memmove(buffer + index, buffer + index + count, len - index - count + 1);
+    len -= count;
+}
+
+long String::toInt() const
+{
+    return atol(c_str());
+}
+
+float String::toFloat() const
+{
+    return (float)atof(c_str());
+}
+
+double String::toDouble() const
+{
+    return atof(c_str());
+}
+
+String operator+(const String &lhs, const String &rhs)
+{
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+String operator+(const String &lhs, const char *rhs)
+{
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+String operator+(const char *lhs, const String &rhs)
+{
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+String operator+(const String &lhs, char rhs)
+{
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+String operator+(String &&lhs, const String &rhs)
+{
+    lhs.concat(rhs);
+    return static_cast<String &&>(lhs);
+}
+
+String operator+(String &&lhs, const char *rhs)
+{
+    lhs.concat(rhs);
+    return static_cast<String &&>(lhs);
+}
+
+String operator+(String &&lhs, char rhs)
+{
+    lhs.concat(rhs);
+    return static_cast<String &&>(lhs);
+}
@@ -0,0 +1,93 @@
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host stand-in for the Arduino core String. Allocation follows the core:
+// every concat reserves exactly the new length (realloc, no geometric
+// growth), and `a + b + c` appends to one temporary like StringSumHelper,
+// so JSON built by concatenation costs about what it does on the device.
+class String
+{
+private:
+    char *buffer;
+    size_t capacity; // Excluding the terminator
+    size_t len;
+
+    void init();
+    bool grow(size_t size);
+    String &copy(const char *cstr, size_t length);
+
+public:
+    String(const char *cstr = "");
+    String(const String &other);
+    String(String &&other) noexcept;
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+    ~String();
+
+    String &operator=(const String &other);
+    String &operator=(String &&other) noexcept;
+    String &operator=(const char *cstr);
+
+    bool reserve(size_t size);
+    size_t length() const { return len; }
+    bool isEmpty() const { return len == 0; }
+    const char *c_str() const { return buffer ? buffer : ""; }
+
+    bool concat(const String &other);
+    bool concat(const char *cstr);
+    bool concat(const char *cstr, size_t length);
+    bool concat(char c);
+    template <typename T>
+    bool concat(T value) { return concat(String(value)); }
+
+    String &operator+=(const String &other) { concat(other); return *this; }
+    String &operator+=(const char *cstr) { concat(cstr); return *this; }
+    String &operator+=(char c) { concat(c); return *this; }
+    template <typename T>
+    String &operator+=(T value) { concat(String(value)); return *this; }
+
+    int compareTo(const String &other) const;
+    bool equals(const String &other) const;
+    bool equals(const char *cstr) const;
+    bool operator==(const String &other) const { return equals(other); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &other) const { return !equals(other); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &other) const { return compareTo(other) < 0; }
+
+    bool startsWith(const String &prefix) const;
+    bool endsWith(const String &suffix) const;
+    char charAt(size_t index) const { return index < len ? buffer[index] : 0; }
+    char operator[](size_t index) const { return charAt(index); }
+    int indexOf(char c, size_t from = 0) const;
+    int indexOf(const String &needle, size_t from = 0) const;
+    String substring(size_t from) const { return substring(from, len); }
+    String substring(size_t from, size_t to) const;
+    void remove(size_t index);
+    void remove(size_t index, size_t count);
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+String operator+(String &&lhs, const String &rhs);
+String operator+(String &&lhs, const char *rhs);
+String operator+(String &&lhs, char rhs);
+
+#endif // NATIVE_WSTRING_H
@@ -0,0 +1,40 @@
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include "Arduino.h"
+#include "esp_wifi.h"
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA,
+    WIFI_AP,
+    WIFI_AP_STA
+} wifi_mode_t;
+
+class WiFiClass
+{
+private:
+    wifi_mode_t currentMode = WIFI_OFF;
+    int32_t currentChannel = 1;
+    IPAddress ip;
+
+public:
+    bool mode(wifi_mode_t mode)
+    {
+        currentMode = mode;
+        return true;
+    }
+    wifi_mode_t getMode() const { return currentMode; }
+    int32_t channel() const { return currentChannel; }
+    IPAddress localIP() const { return ip; }
+    String macAddress() const { return "24:6F:28:00:00:01"; }
+
+    // Host side
+    void setChannel(int32_t channel) { currentChannel = channel; }
+    void setLocalIP(const IPAddress &address) { ip = address; }
+};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFI_H
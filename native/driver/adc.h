@@ -0,0 +1,108 @@
+#ifndef NATIVE_DRIVER_ADC_H
+#define NATIVE_DRIVER_ADC_H
+
+#include <stdint.h>
+#include "../esp_err.h"
+
+// The continuous (DMA) driver is reported unavailable, so BatteryMonitor
+// falls back to analogRead(), which the HAL serves from NativeHal::setAnalog()
+
+typedef enum
+{
+    ADC_UNIT_1 = 1,
+    ADC_UNIT_2 = 2
+} adc_unit_t;
+
+typedef enum
+{
+    ADC_ATTEN_DB_0 = 0,
+    ADC_ATTEN_DB_2_5,
+    ADC_ATTEN_DB_6,
+    ADC_ATTEN_DB_11
+} adc_atten_t;
+
+typedef enum
+{
+    ADC_WIDTH_BIT_9 = 0,
+    ADC_WIDTH_BIT_10,
+    ADC_WIDTH_BIT_11,
+    ADC_WIDTH_BIT_12
+} adc_bits_width_t;
+
+typedef enum
+{
+    ADC_CONV_SINGLE_UNIT_1 = 1,
+    ADC_CONV_SINGLE_UNIT_2 = 2
+} adc_digi_convert_mode_t;
+
+typedef enum
+{
+    ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    ADC_DIGI_OUTPUT_FORMAT_TYPE2
+} adc_digi_output_format_t;
+
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+#define SOC_ADC_DIGI_RESULT_BYTES 2
+
+typedef struct
+{
+    uint32_t max_store_buf_size;
+    uint32_t conv_num_each_intr;
+    uint32_t adc1_chan_mask;
+    uint32_t adc2_chan_mask;
+} adc_digi_init_config_t;
+
+typedef struct
+{
+    uint8_t atten;
+    uint8_t channel;
+    uint8_t unit;
+    uint8_t bit_width;
+} adc_digi_pattern_config_t;
+
+typedef struct
+{
+    bool conv_limit_en;
+    uint32_t conv_limit_num;
+    uint32_t pattern_num;
+    adc_digi_pattern_config_t *adc_pattern;
+    uint32_t sample_freq_hz;
+    adc_digi_convert_mode_t conv_mode;
+    adc_digi_output_format_t format;
+} adc_digi_configuration_t;
+
+typedef struct
+{
+    union
+    {
+        struct
+        {
+            uint16_t data : 12;
+            uint16_t channel : 4;
+        } type1;
+        uint16_t val;
+    };
+} adc_digi_output_data_t;
+
+inline esp_err_t adc_digi_initialize(const adc_digi_init_config_t *config)
+{
+    (void)config;
+    return ESP_ERR_NOT_FOUND;
+}
+inline esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config)
+{
+    (void)config;
+    return ESP_ERR_NOT_FOUND;
+}
+inline esp_err_t adc_digi_start() { return ESP_ERR_INVALID_STATE; }
+inline esp_err_t adc_digi_deinitialize() { return ESP_OK; }
+inline esp_err_t adc_digi_read_bytes(uint8_t *buffer, uint32_t maxLength, uint32_t *outLength, uint32_t timeoutMs)
+{
+    (void)buffer;
+    (void)maxLength;
+    (void)timeoutMs;
+    *outLength = 0;
+    return ESP_ERR_TIMEOUT;
+}
+
+#endif // NATIVE_DRIVER_ADC_H
@@ -0,0 +1,100 @@
+#ifndef NATIVE_DRIVER_TOUCH_PAD_H
+#define NATIVE_DRIVER_TOUCH_PAD_H
+
+#include <stdint.h>
+#include "../Arduino.h"
+
+// ESP32 flavour of the touch driver; raw readings come from NativeHal::setTouchRaw().
+// Like the real driver, touch_pad_read() fails before touch_pad_init() and
+// touch_pad_read_raw_data() only has data once touch_pad_filter_start() ran:
+// on the ESP32 the raw value is filled in by the filter's timer callback
+
+typedef enum
+{
+    TOUCH_PAD_NUM0 = 0,
+    TOUCH_PAD_MAX = 10
+} touch_pad_t;
+
+typedef enum
+{
+    TOUCH_FSM_MODE_TIMER = 0,
+    TOUCH_FSM_MODE_SW
+} touch_fsm_mode_t;
+
+typedef enum
+{
+    TOUCH_HVOLT_2V7 = 3
+} touch_high_volt_t;
+
+typedef enum
+{
+    TOUCH_LVOLT_0V5 = 0
+} touch_low_volt_t;
+
+typedef enum
+{
+    TOUCH_HVOLT_ATTEN_1V = 3
+} touch_volt_atten_t;
+
+inline bool touchPadInitialized = false;
+inline bool touchPadFilterStarted = false;
+
+inline esp_err_t touch_pad_init()
+{
+    touchPadInitialized = true;
+    return ESP_OK;
+}
+inline esp_err_t touch_pad_filter_start(uint32_t periodMs)
+{
+    if (!touchPadInitialized || periodMs == 0)
+        return ESP_ERR_INVALID_ARG;
+    touchPadFilterStarted = true;
+    return ESP_OK;
+}
+inline esp_err_t touch_pad_set_voltage(touch_high_volt_t high, touch_low_volt_t low, touch_volt_atten_t atten)
+{
+    (void)high;
+    (void)low;
+    (void)atten;
+    return ESP_OK;
+}
+inline esp_err_t touch_pad_set_meas_time(uint16_t sleepCycles, uint16_t measCycles)
+{
+    (void)sleepCycles;
+    (void)measCycles;
+    return ESP_OK;
+}
+inline esp_err_t touch_pad_config(touch_pad_t pad, uint16_t threshold)
+{
+    (void)pad;
+    (void)threshold;
+    return ESP_OK;
+}
+inline esp_err_t touch_pad_set_fsm_mode(touch_fsm_mode_t mode)
+{
+    (void)mode;
+    return ESP_OK;
+}
+inline esp_err_t touch_pad_read(touch_pad_t pad, uint16_t *value)
+{
+    if (!touchPadInitialized)
+    {
+        *value = 0;
+        return ESP_FAIL;
+    }
+    *value = (uint16_t)NativeHal::getTouchRaw((uint8_t)pad);
+    // The driver reports a zero count as a broken pad connection
+    return *value == 0 ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+inline esp_err_t touch_pad_read_raw_data(touch_pad_t pad, uint16_t *raw)
+{
+    if (!touchPadFilterStarted)
+    {
+        *raw = 0;
+        return ESP_ERR_INVALID_STATE;
+    }
+    *raw = (uint16_t)NativeHal::getTouchRaw((uint8_t)pad);
+    return ESP_OK;
+}
+
+#endif // NATIVE_DRIVER_TOUCH_PAD_H
@@ -0,0 +1,55 @@
+#ifndef NATIVE_ESP_NOW_H
+#define NATIVE_ESP_NOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+#define ESP_NOW_ETH_ALEN 6
+#define ESP_NOW_KEY_LEN 16
+#define ESP_NOW_MAX_DATA_LEN 250
+#define ESP_ERR_ESPNOW_NOT_INIT 0x3065
+#define ESP_ERR_ESPNOW_NOT_FOUND 0x3069
+#define ESP_ERR_ESPNOW_EXIST 0x306a
+
+typedef enum
+{
+    ESP_NOW_SEND_SUCCESS = 0,
+    ESP_NOW_SEND_FAIL
+} esp_now_send_status_t;
+
+typedef struct
+{
+    uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+    uint8_t lmk[ESP_NOW_KEY_LEN];
+    uint8_t channel;
+    wifi_interface_t ifidx;
+    bool encrypt;
+    void *priv;
+} esp_now_peer_info_t;
+
+typedef void (*esp_now_send_cb_t)(const uint8_t *mac_addr, esp_now_send_status_t status);
+typedef void (*esp_now_recv_cb_t)(const uint8_t *mac_addr, const uint8_t *data, int data_len);
+
+esp_err_t esp_now_init();
+esp_err_t esp_now_deinit();
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb);
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer);
+esp_err_t esp_now_get_peer(const uint8_t *peerAddr, esp_now_peer_info_t *peer);
+esp_err_t esp_now_mod_peer(const esp_now_peer_info_t *peer);
+esp_err_t esp_now_del_peer(const uint8_t *peerAddr);
+// A NULL address sends to every peer, as in the IDF
+esp_err_t esp_now_send(const uint8_t *peerAddr, const uint8_t *data, size_t len);
+
+namespace NativeHal
+{
+    // Sent frames wait "on air" until completed, like the driver's queue
+    size_t completeEspNowSends(bool delivered = true);
+    size_t getEspNowSentFrames();
+    size_t getEspNowSentBytes();
+    void receiveEspNow(const uint8_t *mac, const uint8_t *data, int len);
+}
+
+#endif // NATIVE_ESP_NOW_H
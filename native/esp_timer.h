@@ -0,0 +1,11 @@
+#ifndef NATIVE_ESP_TIMER_H
+#define NATIVE_ESP_TIMER_H
+
+#include "Arduino.h"
+
+inline int64_t esp_timer_get_time()
+{
+    return (int64_t)NativeHal::nowMicros();
+}
+
+#endif // NATIVE_ESP_TIMER_H
@@ -0,0 +1,82 @@
+#ifndef NATIVE_ESP_WIFI_H
+#define NATIVE_ESP_WIFI_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    WIFI_IF_STA = 0,
+    WIFI_IF_AP
+} wifi_interface_t;
+
+typedef enum
+{
+    WIFI_SECOND_CHAN_NONE = 0,
+    WIFI_SECOND_CHAN_ABOVE,
+    WIFI_SECOND_CHAN_BELOW
+} wifi_second_chan_t;
+
+typedef enum
+{
+    WIFI_PHY_RATE_1M_L = 0x00,
+    WIFI_PHY_RATE_6M = 0x0B,
+    WIFI_PHY_RATE_12M = 0x0A,
+    WIFI_PHY_RATE_24M = 0x09,
+    WIFI_PHY_RATE_54M = 0x0C,
+    WIFI_PHY_RATE_LORA_250K = 0x29,
+    WIFI_PHY_RATE_LORA_500K = 0x2A
+} wifi_phy_rate_t;
+
+#define WIFI_PROTOCOL_11B 1
+#define WIFI_PROTOCOL_11G 2
+#define WIFI_PROTOCOL_11N 4
+#define WIFI_PROTOCOL_LR 8
+
+typedef enum
+{
+    WIFI_PKT_MGMT,
+    WIFI_PKT_CTRL,
+    WIFI_PKT_DATA,
+    WIFI_PKT_MISC
+} wifi_promiscuous_pkt_type_t;
+
+#define WIFI_PROMIS_FILTER_MASK_MGMT (1 << 0)
+
+typedef struct
+{
+    uint32_t filter_mask;
+} wifi_promiscuous_filter_t;
+
+typedef struct
+{
+    signed rssi : 8;
+    unsigned channel : 4;
+    unsigned sig_len : 12;
+    uint32_t timestamp;
+} wifi_pkt_rx_ctrl_t;
+
+typedef struct
+{
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    uint8_t payload[0];
+} wifi_promiscuous_pkt_t;
+
+typedef void (*wifi_promiscuous_cb_t)(void *buffer, wifi_promiscuous_pkt_type_t type);
+
+esp_err_t esp_wifi_set_protocol(wifi_interface_t ifx, uint8_t protocolBitmap);
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter);
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb);
+esp_err_t esp_wifi_set_promiscuous(bool enable);
+esp_err_t esp_wifi_config_espnow_rate(wifi_interface_t ifx, wifi_phy_rate_t rate);
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second);
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second);
+
+namespace NativeHal
+{
+    // Feeds a sniffed management frame to the promiscuous callback
+    void sniffFrame(const uint8_t *frame, uint16_t length, int8_t rssi);
+    wifi_phy_rate_t getEspNowRate();
+}
+
+#endif // NATIVE_ESP_WIFI_H
@@ -0,0 +1,49 @@
+#ifndef NATIVE_QUEUE_H
+#define NATIVE_QUEUE_H
+
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "FreeRTOS.h"
+
+// Fixed-length copy queue; with a single thread a full or empty queue stays
+// that way, so every call returns at once whatever the timeout
+struct NativeQueue
+{
+    size_t length;
+    size_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+typedef NativeQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    return new NativeQueue{length, itemSize, {}};
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    (void)ticks;
+    if (queue->items.size() >= queue->length)
+        return pdFALSE;
+    const uint8_t *bytes = (const uint8_t *)item;
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    (void)ticks;
+    if (queue->items.empty())
+        return pdFALSE;
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return (UBaseType_t)queue->items.size();
+}
+
+#endif // NATIVE_QUEUE_H
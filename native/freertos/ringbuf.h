@@ -0,0 +1,24 @@
+#ifndef NATIVE_RINGBUF_H
+#define NATIVE_RINGBUF_H
+
+#include <stddef.h>
+#include "FreeRTOS.h"
+
+typedef enum
+{
+    RINGBUF_TYPE_NOSPLIT,
+    RINGBUF_TYPE_ALLOWSPLIT,
+    RINGBUF_TYPE_BYTEBUF
+} RingbufferType_t;
+
+// Item ring with the IDF's accounting: each item takes its length rounded up
+// to 4 bytes plus an 8 byte header. Only NOSPLIT semantics are modelled.
+struct NativeRingbuffer;
+typedef NativeRingbuffer *RingbufHandle_t;
+
+RingbufHandle_t xRingbufferCreate(size_t bufferSize, RingbufferType_t type);
+BaseType_t xRingbufferSend(RingbufHandle_t ring, const void *item, size_t size, TickType_t ticks);
+void *xRingbufferReceive(RingbufHandle_t ring, size_t *size, TickType_t ticks);
+void vRingbufferReturnItem(RingbufHandle_t ring, void *item);
+
+#endif // NATIVE_RINGBUF_H
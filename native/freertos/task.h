@@ -0,0 +1,16 @@
+#ifndef NATIVE_FREERTOS_TASK_H
+#define NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+// The host has a single task, loopTask
+
+typedef void *TaskHandle_t;
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    static int loopTask;
+    return &loopTask;
+}
+
+#endif // NATIVE_FREERTOS_TASK_H
@@ -0,0 +1,512 @@
+#include <stdarg.h>
+#include <deque>
+#include <vector>
+#include "Arduino.h"
+#include "WiFi.h"
+#include "SPIFFS.h"
+#include "Update.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+#include "freertos/ringbuf.h"
+
+// ========================= TIME, PINS =========================
+
+static uint64_t clockUs = 0;
+static int digitalLevels[64];
+static uint16_t analogLevels[64];
+static uint32_t touchRaw[16];
+static uint32_t restarts = 0;
+
+namespace NativeHal
+{
+    void advanceMicros(uint64_t us) { clockUs += us; }
+    uint64_t nowMicros() { return clockUs; }
+    void setDigital(uint8_t pin, int value) { digitalLevels[pin % 64] = value; }
+    void setAnalog(uint8_t pin, uint16_t value) { analogLevels[pin % 64] = value; }
+    void setTouchRaw(uint8_t channel, uint32_t value) { touchRaw[channel % 16] = value; }
+    uint32_t getTouchRaw(uint8_t channel) { return touchRaw[channel % 16]; }
+    uint32_t getRestartCount() { return restarts; }
+}
+
+unsigned long millis() { return (unsigned long)(clockUs / 1000); }
+unsigned long micros() { return (unsigned long)clockUs; }
+uint32_t esp_random() { return ((uint32_t)rand() << 16) ^ (uint32_t)rand(); }
+void delay(uint32_t ms) { clockUs += (uint64_t)ms * 1000; }
+void delayMicroseconds(uint32_t us) { clockUs += us; }
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (mode == INPUT_PULLUP)
+        digitalLevels[pin % 64] = HIGH;
+}
+int digitalRead(uint8_t pin) { return digitalLevels[pin % 64]; }
+void digitalWrite(uint8_t pin, uint8_t value) { digitalLevels[pin % 64] = value; }
+uint16_t analogRead(uint8_t pin) { return analogLevels[pin % 64]; }
+void analogSetPinAttenuation(uint8_t pin, adc_attenuation_t attenuation)
+{
+    (void)pin;
+    (void)attenuation;
+}
+
+// ESP32 (not S2/S3) mappings
+int8_t digitalPinToAnalogChannel(uint8_t pin)
+{
+    static const int8_t adc1[] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 4, 5, 6, 7, 0, 1, 2, 3};
+    return pin < sizeof(adc1) ? adc1[pin] : -1;
+}
+
+int8_t digitalPinToTouchChannel(uint8_t pin)
+{
+    switch (pin)
+    {
+    case 4: return 0;
+    case 0: return 1;
+    case 2: return 2;
+    case 15: return 3;
+    case 13: return 4;
+    case 12: return 5;
+    case 14: return 6;
+    case 27: return 7;
+    case 33: return 8;
+    case 32: return 9;
+    default: return -1;
+    }
+}
+
+EspClass ESP;
+void EspClass::restart() { restarts++; }
+uint32_t EspClass::getFreeHeap() { return 200000; }
+uint32_t EspClass::getCycleCount() { return (uint32_t)(clockUs * 240); }
+
+// ========================= SERIAL =========================
+
+HardwareSerial Serial;
+
+size_t Print::write(const uint8_t *data, size_t length)
+{
+    size_t written = 0;
+    while (written < length && write(data[written]))
+        written++;
+    return written;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0)
+        return 0;
+    return write((const uint8_t *)text, (size_t)length < sizeof(text) ? (size_t)length : sizeof(text) - 1);
+}
+
+HardwareSerial::HardwareSerial() : txBytes(0), txSpace(4096), echo(false) {}
+
+size_t HardwareSerial::write(uint8_t byte)
+{
+    return write(&byte, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t length)
+{
+    txBytes += length;
+    if (echo)
+        fwrite(data, 1, length, stdout);
+    return length;
+}
+
+int HardwareSerial::read()
+{
+    if (rx.empty())
+        return -1;
+    uint8_t byte = rx.front();
+    rx.pop_front();
+    return byte;
+}
+
+// ========================= WIFI, FILESYSTEM, UPDATE =========================
+
+WiFiClass WiFi;
+SPIFFSFS SPIFFS;
+UpdateClass Update;
+
+namespace fs
+{
+    File::File() : offset(0), nextEntry(0), writable(false), directory(false) {}
+
+    File::File(std::shared_ptr<NativeFileData> file, bool canWrite, bool append)
+        : data(file), offset(append ? file->bytes.size() : 0), nextEntry(0), writable(canWrite), directory(false)
+    {
+        size_t slash = file->path.rfind('/');
+        baseName = file->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    }
+
+    File::File(std::vector<std::shared_ptr<NativeFileData>> entries)
+        : listing(entries), offset(0), nextEntry(0), writable(false), directory(true), baseName("/") {}
+
+    size_t File::write(const uint8_t *buffer, size_t length)
+    {
+        if (!data || !writable)
+            return 0;
+        if (offset + length > data->bytes.size())
+            data->bytes.resize(offset + length);
+        memcpy(data->bytes.data() + offset, buffer, length);
+        offset += length;
+        return length;
+    }
+
+    int File::read()
+    {
+        if (!data || offset >= data->bytes.size())
+            return -1;
+        return data->bytes[offset++];
+    }
+
+    int File::read(uint8_t *buffer, size_t length)
+    {
+        if (!data)
+            return -1;
+        size_t available = data->bytes.size() - offset;
+        if (length > available)
+            length = available;
+        memcpy(buffer, data->bytes.data() + offset, length);
+        offset += length;
+        return (int)length;
+    }
+
+    bool File::seek(size_t position)
+    {
+        if (!data || position > data->bytes.size())
+            return false;
+        offset = position;
+        return true;
+    }
+
+    void File::close()
+    {
+        data.reset();
+        listing.clear();
+        directory = false;
+    }
+
+    File File::openNextFile()
+    {
+        if (!directory || nextEntry >= listing.size())
+            return File();
+        return File(listing[nextEntry++], false, false);
+    }
+
+    File FS::open(const String &path, const char *mode)
+    {
+        if (path == "/")
+        {
+            std::vector<std::shared_ptr<NativeFileData>> entries;
+            for (const auto &entry : files)
+                entries.push_back(entry.second);
+            return File(entries);
+        }
+
+        auto it = files.find(path.c_str());
+        if (mode[0] == 'r')
+            return it != files.end() ? File(it->second, false, false) : File();
+
+        if (it == files.end() || mode[0] == 'w')
+        {
+            auto entry = std::make_shared<NativeFileData>();
+            entry->path = path.c_str();
+            files[entry->path] = entry;
+            return File(entry, true, false);
+        }
+        return File(it->second, true, true);
+    }
+
+    bool FS::rename(const String &from, const String &to)
+    {
+        auto it = files.find(from.c_str());
+        if (it == files.end())
+            return false;
+        auto entry = it->second;
+        files.erase(it);
+        entry->path = to.c_str();
+        files[entry->path] = entry;
+        return true;
+    }
+
+    size_t FS::usedBytes() const
+    {
+        size_t total = 0;
+        for (const auto &entry : files)
+            total += entry.second->bytes.size();
+        return total;
+    }
+}
+
+// ========================= RING BUFFER =========================
+
+struct NativeRingbuffer
+{
+    size_t capacity;
+    size_t used;
+    std::deque<std::vector<uint8_t>> items;
+    std::vector<uint8_t> lent; // Item handed out by xRingbufferReceive
+    bool lending;
+};
+
+static size_t ringItemCost(size_t size)
+{
+    return ((size + 3) & ~(size_t)3) + 8;
+}
+
+RingbufHandle_t xRingbufferCreate(size_t bufferSize, RingbufferType_t type)
+{
+    (void)type;
+    NativeRingbuffer *ring = new NativeRingbuffer();
+    ring->capacity = bufferSize;
+    ring->used = 0;
+    ring->lending = false;
+    return ring;
+}
+
+BaseType_t xRingbufferSend(RingbufHandle_t ring, const void *item, size_t size, TickType_t ticks)
+{
+    (void)ticks;
+    if (ring->used + ringItemCost(size) > ring->capacity)
+        return pdFALSE;
+    const uint8_t *bytes = (const uint8_t *)item;
+    ring->items.emplace_back(bytes, bytes + size);
+    ring->used += ringItemCost(size);
+    return pdTRUE;
+}
+
+void *xRingbufferReceive(RingbufHandle_t ring, size_t *size, TickType_t ticks)
+{
+    (void)ticks;
+    if (ring->items.empty() || ring->lending)
+        return nullptr;
+    ring->lent.swap(ring->items.front());
+    ring->items.pop_front();
+    ring->lending = true;
+    *size = ring->lent.size();
+    return ring->lent.data();
+}
+
+void vRingbufferReturnItem(RingbufHandle_t ring, void *item)
+{
+    (void)item;
+    if (!ring->lending)
+        return;
+    ring->used -= ringItemCost(ring->lent.size());
+    ring->lending = false;
+}
+
+// ========================= WIFI DRIVER, ESP-NOW =========================
+
+static wifi_promiscuous_cb_t promiscuousCallback = nullptr;
+static bool promiscuousEnabled = false;
+static wifi_phy_rate_t espNowRate = WIFI_PHY_RATE_1M_L;
+static uint8_t radioChannel = 1;
+
+esp_err_t esp_wifi_set_protocol(wifi_interface_t ifx, uint8_t protocolBitmap)
+{
+    (void)ifx;
+    (void)protocolBitmap;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter)
+{
+    (void)filter;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb)
+{
+    promiscuousCallback = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool enable)
+{
+    promiscuousEnabled = enable;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_config_espnow_rate(wifi_interface_t ifx, wifi_phy_rate_t rate)
+{
+    (void)ifx;
+    espNowRate = rate;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second)
+{
+    *primary = radioChannel;
+    *second = WIFI_SECOND_CHAN_NONE;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second)
+{
+    (void)second;
+    radioChannel = primary;
+    return ESP_OK;
+}
+
+struct PendingSend
+{
+    uint8_t mac[6];
+};
+
+static bool espNowReady = false;
+static esp_now_send_cb_t sendCallback = nullptr;
+static esp_now_recv_cb_t receiveCallback = nullptr;
+static std::vector<esp_now_peer_info_t> espNowPeers;
+static std::deque<PendingSend> pendingSends;
+static size_t sentFrames = 0;
+static size_t sentBytes = 0;
+
+esp_err_t esp_now_init()
+{
+    espNowReady = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_deinit()
+{
+    espNowReady = false;
+    espNowPeers.clear();
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb)
+{
+    sendCallback = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb)
+{
+    receiveCallback = cb;
+    return ESP_OK;
+}
+
+static esp_now_peer_info_t *findPeer(const uint8_t *address)
+{
+    for (esp_now_peer_info_t &peer : espNowPeers)
+    {
+        if (memcmp(peer.peer_addr, address, 6) == 0)
+            return &peer;
+    }
+    return nullptr;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer)
+{
+    if (!espNowReady)
+        return ESP_ERR_ESPNOW_NOT_INIT;
+    if (findPeer(peer->peer_addr) != nullptr)
+        return ESP_ERR_ESPNOW_EXIST;
+    espNowPeers.push_back(*peer);
+    return ESP_OK;
+}
+
+esp_err_t esp_now_get_peer(const uint8_t *peerAddr, esp_now_peer_info_t *peer)
+{
+    esp_now_peer_info_t *found = findPeer(peerAddr);
+    if (found == nullptr)
+        return ESP_ERR_ESPNOW_NOT_FOUND;
+    *peer = *found;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_mod_peer(const esp_now_peer_info_t *peer)
+{
+    esp_now_peer_info_t *found = findPeer(peer->peer_addr);
+    if (found == nullptr)
+        return ESP_ERR_ESPNOW_NOT_FOUND;
+    *found = *peer;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t *peerAddr)
+{
+    for (auto it = espNowPeers.begin(); it != espNowPeers.end(); ++it)
+    {
+        if (memcmp(it->peer_addr, peerAddr, 6) == 0)
+        {
+            espNowPeers.erase(it);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_ESPNOW_NOT_FOUND;
+}
+
+esp_err_t esp_now_send(const uint8_t *peerAddr, const uint8_t *data, size_t len)
+{
+    if (!espNowReady)
+        return ESP_ERR_ESPNOW_NOT_INIT;
+    if (data == nullptr || len == 0 || len > ESP_NOW_MAX_DATA_LEN)
+        return ESP_ERR_INVALID_ARG;
+
+    if (peerAddr == nullptr)
+    {
+        for (const esp_now_peer_info_t &peer : espNowPeers)
+            esp_now_send(peer.peer_addr, data, len);
+        return ESP_OK;
+    }
+    if (findPeer(peerAddr) == nullptr)
+        return ESP_ERR_ESPNOW_NOT_FOUND;
+
+    PendingSend send;
+    memcpy(send.mac, peerAddr, 6);
+    pendingSends.push_back(send);
+    sentFrames++;
+    sentBytes += len;
+    return ESP_OK;
+}
+
+namespace NativeHal
+{
+    size_t completeEspNowSends(bool delivered)
+    {
+        size_t completed = 0;
+        while (!pendingSends.empty())
+        {
+            PendingSend send = pendingSends.front();
+            pendingSends.pop_front();
+            if (sendCallback != nullptr)
+                sendCallback(send.mac, delivered ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+            completed++;
+        }
+        return completed;
+    }
+
+    size_t getEspNowSentFrames() { return sentFrames; }
+    size_t getEspNowSentBytes() { return sentBytes; }
+
+    void receiveEspNow(const uint8_t *mac, const uint8_t *data, int len)
+    {
+        if (receiveCallback != nullptr)
+            receiveCallback(mac, data, len);
+    }
+
+    void sniffFrame(const uint8_t *frame, uint16_t length, int8_t rssi)
+    {
+        if (!promiscuousEnabled || promiscuousCallback == nullptr)
+            return;
+        std::vector<uint8_t> buffer(sizeof(wifi_promiscuous_pkt_t) + length);
+        wifi_promiscuous_pkt_t *packet = (wifi_promiscuous_pkt_t *)buffer.data();
+        packet->rx_ctrl.rssi = rssi;
+        packet->rx_ctrl.channel = radioChannel;
+        packet->rx_ctrl.sig_len = length;
+        packet->rx_ctrl.timestamp = (uint32_t)clockUs;
+        memcpy(packet->payload, frame, length);
+        promiscuousCallback(packet, WIFI_PKT_MGMT);
+    }
+
+    wifi_phy_rate_t getEspNowRate() { return espNowRate; }
+}
@@ -0,0 +1,180 @@
+#include "battery_monitor.h"
+#include <driver/adc.h>
+#include "config.h"
+#include "trace_recorder.h"
+
+#define BATTERY_ADC_ATTEN ADC_ATTEN_DB_11
+#define BATTERY_SAMPLE_FREQ_HZ 20000 // Lowest rate the ESP32 DMA ADC supports
+#define BATTERY_BLOCK_SAMPLES 2048   // Samples averaged per block (~100 ms)
+#define BATTERY_FILTER_SHIFT 2       // IIR weight of a new block: 1/4
+#define BATTERY_READ_CHUNK 256       // Bytes drained from DMA per read
+
+BatteryMonitor::BatteryMonitor()
+{
+    memset(lut, 0, sizeof(lut));
+    dmaRunning = false;
+    batteryPin = 0;
+    adcChannel = 0;
+    blockSum = 0;
+    blockCount = 0;
+    filteredRawQ4 = 0;
+    primed = false;
+    batteryMillivolts = 0;
+}
+
+void BatteryMonitor::buildLut(esp_adc_cal_value_t &source)
+{
+    esp_adc_cal_characteristics_t characteristics;
+    source = esp_adc_cal_characterize(ADC_UNIT_1, BATTERY_ADC_ATTEN, ADC_WIDTH_BIT_12, 1100, &characteristics);
+
+    for (uint32_t i = 0; i < BATTERY_LUT_SIZE; i++)
+    {
+        uint32_t raw = i << BATTERY_LUT_SHIFT;
+        if (raw > 4095)
+            raw = 4095;
+        lut[i] = (uint16_t)esp_adc_cal_raw_to_voltage(raw, &characteristics);
+    }
+}
+
+uint32_t BatteryMonitor::rawToPinMillivolts(uint32_t rawQ4) const
+{
+    // Linear interpolation between the two neighbouring table entries
+    const uint32_t shift = BATTERY_LUT_SHIFT + 4;
+    uint32_t index = rawQ4 >> shift;
+    if (index >= BATTERY_LUT_SIZE - 1)
+        return lut[BATTERY_LUT_SIZE - 1];
+    uint32_t fraction = rawQ4 & ((1 << shift) - 1);
+    uint32_t low = lut[index];
+    uint32_t high = lut[index + 1];
+    return low + (((high - low) * fraction) >> shift);
+}
+
+bool BatteryMonitor::startDma()
+{
+    adc_digi_init_config_t initConfig = {};
+    initConfig.max_store_buf_size = 1024;
+    initConfig.conv_num_each_intr = BATTERY_READ_CHUNK;
+    initConfig.adc1_chan_mask = BIT(adcChannel);
+    initConfig.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&initConfig) != ESP_OK)
+        return false;
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = BATTERY_ADC_ATTEN;
+    pattern.channel = adcChannel;
+    pattern.unit = 0; // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t digiConfig = {};
+    digiConfig.conv_limit_en = 1;
+    digiConfig.conv_limit_num = 250;
+    digiConfig.pattern_num = 1;
+    digiConfig.adc_pattern = &pattern;
+    digiConfig.sample_freq_hz = BATTERY_SAMPLE_FREQ_HZ;
+    digiConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    digiConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+    if (adc_digi_controller_configure(&digiConfig) != ESP_OK)
+    {
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    return adc_digi_start() == ESP_OK;
+}
+
+void BatteryMonitor::begin(uint8_t pin)
+{
+    esp_adc_cal_value_t source;
+    buildLut(source);
+    Serial.printf("[BATTERY] ADC calibration from %s\n",
+                  source == ESP_ADC_CAL_VAL_EFUSE_TP ? "eFuse two-point" : source == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref"
+                                                                                                             : "default Vref");
+
+    int8_t channel = digitalPinToAnalogChannel(pin);
+    if (channel < 0 || channel >= 10)
+    {
+        Serial.printf("[BATTERY] GPIO %u is not an ADC1 pin, battery readings disabled\n", pin);
+        return;
+    }
+    adcChannel = (uint8_t)channel;
+    batteryPin = pin;
+
+    // Seed the filter with a few one-shot reads so the first frame carries a
+    // real value, before the DMA controller takes over ADC1
+    analogSetPinAttenuation(pin, ADC_11db);
+    uint32_t sum = 0;
+    for (int i = 0; i < 16; i++)
+        sum += analogRead(pin);
+    addBlock(sum / 16);
+
+    dmaRunning = startDma();
+    if (!dmaRunning)
+        Serial.println("[BATTERY] Continuous ADC unavailable, falling back to single reads");
+}
+
+void BatteryMonitor::addBlock(uint32_t averageRaw)
+{
+    uint32_t rawQ4 = averageRaw << 4;
+    if (!primed)
+    {
+        filteredRawQ4 = rawQ4;
+        primed = true;
+    }
+    else
+    {
+        filteredRawQ4 = filteredRawQ4 + (rawQ4 >> BATTERY_FILTER_SHIFT) - (filteredRawQ4 >> BATTERY_FILTER_SHIFT);
+    }
+
+    uint32_t pinMv = rawToPinMillivolts(filteredRawQ4);
+    uint32_t dividedMv = pinMv * (BATTERY_DIVIDER_R1 + BATTERY_DIVIDER_R2) / BATTERY_DIVIDER_R2;
+    batteryMillivolts = dividedMv * BATTERY_CALIBRATION_PERMILLE / 1000;
+}
+
+void BatteryMonitor::poll()
+{
+    if (!primed)
+        return;
+    TRACE_SCOPE("battery adc");
+
+    if (!dmaRunning)
+    {
+        // One single-shot read per poll keeps the fallback cheap
+        blockSum += analogRead(batteryPin);
+        if (++blockCount >= 64)
+        {
+            addBlock(blockSum / blockCount);
+            blockSum = 0;
+            blockCount = 0;
+        }
+        return;
+    }
+
+    uint8_t buffer[BATTERY_READ_CHUNK];
+    uint32_t length = 0;
+    while (adc_digi_read_bytes(buffer, sizeof(buffer), &length, 0) == ESP_OK && length > 0)
+    {
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES)
+        {
+            adc_digi_output_data_t *sample = (adc_digi_output_data_t *)&buffer[i];
+            if (sample->type1.channel != adcChannel)
+                continue;
+            blockSum += sample->type1.data;
+            if (++blockCount >= BATTERY_BLOCK_SAMPLES)
+            {
+                addBlock(blockSum / blockCount);
+                blockSum = 0;
+                blockCount = 0;
+            }
+        }
+    }
+}
+
+uint16_t BatteryMonitor::getPercentTenths() const
+{
+    uint32_t mv = batteryMillivolts;
+    if (mv <= BATTERY_EMPTY_MV)
+        return 0;
+    if (mv >= BATTERY_FULL_MV)
+        return 1000;
+    return (uint16_t)((mv - BATTERY_EMPTY_MV) * 1000 / (BATTERY_FULL_MV - BATTERY_EMPTY_MV));
+}
@@ -0,0 +1,77 @@
+#include "boot_profiler.h"
+
+struct BootStage
+{
+    const char *name;
+    unsigned long startUs;
+    unsigned long durationUs;
+    bool done;
+};
+
+static BootStage stages[BOOT_PROFILER_MAX_STAGES];
+static int stageCount = 0;
+static portMUX_TYPE stageMux = portMUX_INITIALIZER_UNLOCKED;
+
+int BootProfiler::begin(const char *stage)
+{
+    unsigned long now = micros();
+    int index = -1;
+
+    // Stages may be recorded from the deferred init task as well as from loop()
+    portENTER_CRITICAL(&stageMux);
+    if (stageCount < BOOT_PROFILER_MAX_STAGES)
+    {
+        index = stageCount++;
+        stages[index] = {stage, now, 0, false};
+    }
+    portEXIT_CRITICAL(&stageMux);
+
+    return index;
+}
+
+void BootProfiler::end(int index)
+{
+    if (index < 0)
+        return;
+
+    unsigned long now = micros();
+    portENTER_CRITICAL(&stageMux);
+    stages[index].durationUs = now - stages[index].startUs;
+    stages[index].done = true;
+    portEXIT_CRITICAL(&stageMux);
+}
+
+void BootProfiler::milestone(const char *name)
+{
+    end(begin(name));
+}
+
+void BootProfiler::printReport()
+{
+    Serial.println("\n[BOOT] Stage timeline (ms since power-on):");
+    for (int i = 0; i < stageCount; i++)
+    {
+        const BootStage &stage = stages[i];
+        if (stage.done)
+            Serial.printf("[BOOT]  %8.1f  +%7.1f  %s\n", stage.startUs / 1000.0f, stage.durationUs / 1000.0f, stage.name);
+        else
+            Serial.printf("[BOOT]  %8.1f  (running) %s\n", stage.startUs / 1000.0f, stage.name);
+    }
+}
+
+String BootProfiler::getJSON()
+{
+    String json = "{\"stages\":[";
+    for (int i = 0; i < stageCount; i++)
+    {
+        const BootStage &stage = stages[i];
+        if (i > 0)
+            json += ",";
+        json += "{\"name\":\"" + String(stage.name) + "\",";
+        json += "\"startUs\":" + String(stage.startUs) + ",";
+        json += "\"durationUs\":" + String(stage.durationUs) + ",";
+        json += "\"done\":" + String(stage.done ? "true" : "false") + "}";
+    }
+    json += "]}";
+    return json;
+}
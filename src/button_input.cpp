@@ -0,0 +1,140 @@
+#include "button_input.h"
+#include <driver/gpio.h>
+
+ButtonInput::ButtonInput()
+{
+    buttonCount = 0;
+    events = nullptr;
+    debounceUs = 0;
+    longPressUs = 0;
+    repeatUs = 0;
+    edges = 0;
+    bounces = 0;
+    droppedEvents = 0;
+}
+
+bool ButtonInput::begin(const uint8_t *pins, uint8_t count, uint32_t debounceMs, uint32_t longPressMs, uint32_t repeatMs, uint8_t queueLength)
+{
+    if (count > BUTTON_MAX)
+        count = BUTTON_MAX;
+    debounceUs = debounceMs * 1000;
+    longPressUs = longPressMs * 1000;
+    repeatUs = repeatMs * 1000;
+
+    events = xQueueCreate(queueLength, sizeof(ButtonEvent));
+    if (events == nullptr)
+        return false;
+
+    // Already installed by another driver is fine
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        Serial.printf("[BUTTON] GPIO ISR service failed: %d\n", err);
+        return false;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        Button &button = buttons[i];
+        button.owner = this;
+        button.index = i;
+        button.pin = pins[i];
+
+        esp_timer_create_args_t args = {};
+        args.callback = onDebounced;
+        args.arg = &button;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "btn_debounce";
+        esp_timer_create(&args, &button.debounceTimer);
+        args.callback = onRepeat;
+        args.name = "btn_repeat";
+        esp_timer_create(&args, &button.repeatTimer);
+
+        pinMode(button.pin, INPUT_PULLUP);
+        // A button held through boot (e.g. the one that woke us) is not a press
+        button.pressed = digitalRead(button.pin) == LOW;
+
+        gpio_isr_handler_add((gpio_num_t)button.pin, onEdge, &button);
+        arm(button);
+    }
+    buttonCount = count;
+
+    Serial.printf("[BUTTON] %u buttons on interrupts, debounce %u ms, repeat after %u ms every %u ms\n",
+                  count, debounceMs, longPressMs, repeatMs);
+    return true;
+}
+
+void ButtonInput::arm(Button &button)
+{
+    gpio_set_intr_type((gpio_num_t)button.pin, GPIO_INTR_ANYEDGE);
+    gpio_intr_enable((gpio_num_t)button.pin);
+}
+
+void IRAM_ATTR ButtonInput::onEdge(void *arg)
+{
+    Button &button = *(Button *)arg;
+    // Quiet until the level settles, the bounce after this edge is not seen
+    gpio_intr_disable((gpio_num_t)button.pin);
+    esp_timer_start_once(button.debounceTimer, button.owner->debounceUs);
+    button.owner->edges++;
+}
+
+void ButtonInput::onDebounced(void *arg)
+{
+    Button &button = *(Button *)arg;
+    ButtonInput &self = *button.owner;
+
+    bool pressed = gpio_get_level((gpio_num_t)button.pin) == 0;
+    if (pressed == button.pressed)
+    {
+        self.bounces++;
+    }
+    else
+    {
+        button.pressed = pressed;
+        self.post(button, pressed ? BUTTON_PRESS : BUTTON_RELEASE);
+        if (pressed)
+            esp_timer_start_once(button.repeatTimer, self.longPressUs);
+        else
+            esp_timer_stop(button.repeatTimer);
+    }
+
+    self.arm(button);
+    // An edge between reading the level and arming was not seen, look again
+    if ((gpio_get_level((gpio_num_t)button.pin) == 0) != button.pressed)
+    {
+        gpio_intr_disable((gpio_num_t)button.pin);
+        esp_timer_start_once(button.debounceTimer, self.debounceUs);
+    }
+}
+
+void ButtonInput::onRepeat(void *arg)
+{
+    Button &button = *(Button *)arg;
+    if (!button.pressed)
+        return;
+    button.owner->post(button, BUTTON_REPEAT);
+    esp_timer_start_once(button.repeatTimer, button.owner->repeatUs);
+}
+
+void ButtonInput::post(Button &button, ButtonEventType type)
+{
+    ButtonEvent event = {button.index, type, (uint32_t)millis()};
+    if (xQueueSend(events, &event, 0) != pdTRUE)
+        droppedEvents++;
+}
+
+bool ButtonInput::poll(ButtonEvent &event)
+{
+    return events != nullptr && xQueueReceive(events, &event, 0) == pdTRUE;
+}
+
+bool ButtonInput::isPressed(uint8_t button) const
+{
+    return button < buttonCount && buttons[button].pressed;
+}
+
+void ButtonInput::printStats() const
+{
+    Serial.printf("[BUTTON] %u edges, %u bounces, %u events dropped\n", edges, bounces, droppedEvents);
+}
@@ -0,0 +1,291 @@
+#include "espnow_manager.h"
+#include <WiFi.h>
+#include <esp_timer.h>
+
+static const uint8_t BROADCAST_ADDRESS[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+volatile uint8_t EspNowManager::pendingSends = 0;
+EspNowManager::ReceiveHandler EspNowManager::receiveHandler = nullptr;
+LinkMonitor *EspNowManager::linkMonitor = nullptr;
+volatile bool EspNowManager::beaconInFlight = false;
+volatile int64_t EspNowManager::beaconSentUs = 0;
+volatile uint16_t EspNowManager::consecutiveFailures = 0;
+// pendingSends goes up in loop() and down in the WiFi task, a bare ++/-- is a read-modify-write
+static portMUX_TYPE pendingMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void releasePendingSend(volatile uint8_t &pending)
+{
+    portENTER_CRITICAL(&pendingMux);
+    if (pending > 0)
+        pending--;
+    portEXIT_CRITICAL(&pendingMux);
+}
+
+static void addPendingSend(volatile uint8_t &pending)
+{
+    portENTER_CRITICAL(&pendingMux);
+    pending++;
+    portEXIT_CRITICAL(&pendingMux);
+}
+
+EspNowManager::EspNowManager(const uint8_t (*receiverMacs)[6], uint8_t receiverCount, bool useBroadcast)
+{
+    broadcast = useBroadcast;
+    if (broadcast)
+    {
+        memcpy(peerAddresses[0], BROADCAST_ADDRESS, 6);
+        peerCount = 1;
+    }
+    else
+    {
+        peerCount = receiverCount > ESPNOW_MAX_RECEIVERS ? ESPNOW_MAX_RECEIVERS : receiverCount;
+        for (uint8_t i = 0; i < peerCount; i++)
+            memcpy(peerAddresses[i], receiverMacs[i], 6);
+    }
+    channel = 0;
+    initialized = false;
+    channelChanges = 0;
+}
+
+void EspNowManager::onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status)
+{
+    // Taken first: a broadcast is not acknowledged, so this is right after it went out
+    int64_t nowUs = esp_timer_get_time();
+    if (beaconInFlight && mac_addr != nullptr && memcmp(mac_addr, BROADCAST_ADDRESS, 6) == 0)
+    {
+        beaconSentUs = status == ESP_NOW_SEND_SUCCESS ? nowUs : 0;
+        beaconInFlight = false;
+    }
+
+    if (mac_addr != nullptr && memcmp(mac_addr, BROADCAST_ADDRESS, 6) != 0)
+    {
+        if (status == ESP_NOW_SEND_SUCCESS)
+            consecutiveFailures = 0;
+        else if (consecutiveFailures < 0xFFFF)
+            consecutiveFailures++;
+    }
+
+    releasePendingSend(pendingSends);
+    if (linkMonitor != nullptr && mac_addr != nullptr)
+        linkMonitor->recordSend(mac_addr, status == ESP_NOW_SEND_SUCCESS);
+    Serial.print("Last Packet Send Status: ");
+    Serial.println(status == ESP_NOW_SEND_SUCCESS ? "Delivery Success" : "Delivery Fail");
+}
+
+void EspNowManager::onDataReceived(const uint8_t *mac_addr, const uint8_t *data, int len)
+{
+    if (receiveHandler != nullptr)
+        receiveHandler(mac_addr, data, len);
+}
+
+void EspNowManager::setReceiveHandler(ReceiveHandler handler)
+{
+    receiveHandler = handler;
+}
+
+void EspNowManager::setLinkMonitor(LinkMonitor *monitor)
+{
+    linkMonitor = monitor;
+}
+
+bool EspNowManager::addPeer(const uint8_t *address)
+{
+    esp_now_peer_info_t peerInfo = {};
+    memcpy(peerInfo.peer_addr, address, 6);
+    peerInfo.channel = channel;
+    peerInfo.ifidx = WIFI_IF_STA;
+    peerInfo.encrypt = false;
+    return esp_now_add_peer(&peerInfo) == ESP_OK;
+}
+
+bool EspNowManager::updatePeerChannels()
+{
+    bool ok = true;
+    for (uint8_t i = 0; i < peerCount; i++)
+    {
+        esp_now_peer_info_t peerInfo = {};
+        if (esp_now_get_peer(peerAddresses[i], &peerInfo) != ESP_OK)
+            continue;
+        peerInfo.channel = channel;
+        if (esp_now_mod_peer(&peerInfo) != ESP_OK)
+        {
+            Serial.printf("[ESP-NOW] Failed to move peer %u to channel %u\n", i, channel);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool EspNowManager::ensurePeer(const uint8_t *address)
+{
+    // Listed peers are registered in init(); others (the broadcast address in
+    // unicast mode, handshake partners) are added on first use and kept on our
+    // channel here, as they are not in peerAddresses
+    esp_now_peer_info_t peerInfo = {};
+    if (esp_now_get_peer(address, &peerInfo) != ESP_OK)
+        return addPeer(address);
+    if (peerInfo.channel == channel)
+        return true;
+    peerInfo.channel = channel;
+    return esp_now_mod_peer(&peerInfo) == ESP_OK;
+}
+
+void EspNowManager::pinRadioChannel()
+{
+    uint8_t primary = 0;
+    wifi_second_chan_t second;
+    if (esp_wifi_get_channel(&primary, &second) != ESP_OK || primary == channel)
+        return;
+
+    // Fails harmlessly while the station is scanning; retried on the next call
+    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+}
+
+bool EspNowManager::init(uint8_t initialChannel)
+{
+    channel = initialChannel;
+
+    // Initialize ESP-NOW
+    if (esp_now_init() != ESP_OK)
+    {
+        Serial.println("Error initializing ESP-NOW");
+        return false;
+    }
+
+    Serial.println("ESP-NOW initialized successfully");
+
+    // Register callbacks
+    esp_now_register_send_cb(onDataSent);
+    esp_now_register_recv_cb(onDataReceived);
+
+    // Register peers (receivers, or the broadcast address)
+    for (uint8_t i = 0; i < peerCount; i++)
+    {
+        const uint8_t *address = peerAddresses[i];
+        if (!addPeer(address))
+        {
+            Serial.println("Failed to add peer");
+            return false;
+        }
+        Serial.printf("Sending ESP-NOW data to: %02X:%02X:%02X:%02X:%02X:%02X on channel %u\n",
+                      address[0], address[1], address[2], address[3], address[4], address[5], channel);
+    }
+
+    initialized = true;
+    pinRadioChannel();
+
+    Serial.printf("%u peer(s) added successfully (%s)\n\n", peerCount, broadcast ? "broadcast" : "unicast");
+
+    return true;
+}
+
+void EspNowManager::handle(bool wifiConnected, bool wifiConnecting)
+{
+    if (!initialized)
+        return;
+
+    if (wifiConnected)
+    {
+        // The station owns the radio: follow the AP if it moved channel
+        uint8_t apChannel = (uint8_t)WiFi.channel();
+        if (apChannel != 0 && apChannel != channel)
+        {
+            Serial.printf("[ESP-NOW] AP channel changed %u -> %u, re-pinning\n", channel, apChannel);
+            channel = apChannel;
+            channelChanges++;
+            updatePeerChannels();
+        }
+    }
+    else if (!wifiConnecting)
+    {
+        // Station idle between reconnect attempts: keep the radio on our channel
+        pinRadioChannel();
+    }
+}
+
+bool EspNowManager::send(const uint8_t *data, size_t len)
+{
+    if (!initialized)
+        return false;
+
+    // One copy per listed peer; not a NULL address, which would also reach the beacon peer
+    bool queued = false;
+    for (uint8_t i = 0; i < peerCount; i++)
+    {
+        addPendingSend(pendingSends);
+        if (esp_now_send(peerAddresses[i], data, len) == ESP_OK)
+            queued = true;
+        else
+            releasePendingSend(pendingSends);
+    }
+    return queued;
+}
+
+bool EspNowManager::sendBeacon(const uint8_t *data, size_t len)
+{
+    if (!initialized || !ensurePeer(BROADCAST_ADDRESS))
+        return false;
+
+    beaconInFlight = true;
+    addPendingSend(pendingSends);
+    if (esp_now_send(BROADCAST_ADDRESS, data, len) != ESP_OK)
+    {
+        releasePendingSend(pendingSends);
+        beaconInFlight = false;
+        beaconSentUs = 0;
+        return false;
+    }
+    return true;
+}
+
+bool EspNowManager::sendTo(const uint8_t *address, const uint8_t *data, size_t len)
+{
+    // Pads broadcast through here, the time master only answers by unicast: a
+    // broadcast while a beacon is in flight would take the beacon's timestamp
+    if (!initialized || !ensurePeer(address))
+        return false;
+
+    addPendingSend(pendingSends);
+    if (esp_now_send(address, data, len) != ESP_OK)
+    {
+        releasePendingSend(pendingSends);
+        return false;
+    }
+    return true;
+}
+
+bool EspNowManager::sendBroadcast(const uint8_t *data, size_t len)
+{
+    return sendTo(BROADCAST_ADDRESS, data, len);
+}
+
+bool EspNowManager::setReceiver(const uint8_t *address)
+{
+    if (!initialized)
+        return false;
+    if (broadcast)
+        return true;
+
+    for (uint8_t i = 0; i < peerCount; i++)
+    {
+        if (memcmp(peerAddresses[i], address, 6) != 0)
+            esp_now_del_peer(peerAddresses[i]);
+    }
+    memcpy(peerAddresses[0], address, 6);
+    peerCount = 1;
+    consecutiveFailures = 0;
+
+    Serial.printf("[ESP-NOW] Sending to %02X:%02X:%02X:%02X:%02X:%02X on channel %u\n",
+                  address[0], address[1], address[2], address[3], address[4], address[5], channel);
+    return ensurePeer(address);
+}
+
+void EspNowManager::setChannel(uint8_t newChannel)
+{
+    if (!initialized || newChannel == channel)
+        return;
+
+    channel = newChannel;
+    updatePeerChannels();
+    pinRadioChannel();
+}
@@ -0,0 +1,366 @@
+#include "espnow_pairing.h"
+#include "config.h"
+
+static bool isZeroMac(const uint8_t *mac)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (mac[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+EspNowPairing::EspNowPairing()
+{
+    espNow = nullptr;
+    clientIdentity = nullptr;
+    receiver = false;
+    assignIds = false;
+    mux = portMUX_INITIALIZER_UNLOCKED;
+    paired = false;
+    searching = false;
+    memset(receiverMac, 0, sizeof(receiverMac));
+    receiverChannel = 0;
+    homeChannel = 0;
+    scanChannel = 0;
+    lastScanChannel = 0;
+    nonce = 0;
+    searchStartMs = 0;
+    lastHopMs = 0;
+    nextSweepMs = 0;
+    sweeps = 0;
+    announcedId = -1;
+    announcing = false;
+    lastAnnounceMs = 0;
+    acceptPending = false;
+    memset(acceptMac, 0, sizeof(acceptMac));
+    memset(&accept, 0, sizeof(accept));
+    memset(assignedMacs, 0, sizeof(assignedMacs));
+    probeCount = 0;
+}
+
+void EspNowPairing::begin(EspNowManager *espNowManager, ClientIdentity *identity, bool isReceiver, bool assignClientIds)
+{
+    espNow = espNowManager;
+    clientIdentity = identity;
+    receiver = isReceiver;
+    assignIds = assignClientIds;
+    preferences.begin("pairing", false);
+
+    if (receiver)
+    {
+        if (preferences.getBytes("ids", assignedMacs, sizeof(assignedMacs)) != sizeof(assignedMacs))
+            memset(assignedMacs, 0, sizeof(assignedMacs));
+        int assigned = 0;
+        for (int id = 0; id < PAIRING_MAX_IDS; id++)
+        {
+            if (!isZeroMac(assignedMacs[id]))
+                assigned++;
+        }
+        Serial.printf("[PAIR] Receiver, answering pads on channel %u (%d IDs assigned)\n", espNow->getChannel(), assigned);
+        return;
+    }
+
+    announcedId = preferences.getChar("announced", -1);
+    if (preferences.getBytes("peer", receiverMac, sizeof(receiverMac)) == sizeof(receiverMac))
+    {
+        receiverChannel = preferences.getUChar("channel", ESPNOW_DEFAULT_CHANNEL);
+        paired = true;
+        espNow->setReceiver(receiverMac);
+        espNow->setChannel(receiverChannel);
+        Serial.printf("[PAIR] Stored receiver %02X:%02X:%02X:%02X:%02X:%02X on channel %u\n",
+                      receiverMac[0], receiverMac[1], receiverMac[2], receiverMac[3], receiverMac[4], receiverMac[5], receiverChannel);
+        return;
+    }
+
+    startSearch(espNow->getChannel());
+}
+
+void EspNowPairing::startSearch(uint8_t currentChannel)
+{
+    portENTER_CRITICAL(&mux);
+    nonce = esp_random();
+    searching = true;
+    announcing = false;
+    acceptPending = false;
+    portEXIT_CRITICAL(&mux);
+
+    homeChannel = currentChannel;
+    scanChannel = 0;
+    searchStartMs = millis();
+    nextSweepMs = searchStartMs;
+    sweeps = 0;
+    Serial.println("[PAIR] Searching for the receiver");
+}
+
+void EspNowPairing::onMessage(const uint8_t *mac, const struct_pair_message &message)
+{
+    if (espNow == nullptr || message.magic != ESPNOW_PAIR_MAGIC)
+        return;
+
+    portENTER_CRITICAL(&mux);
+    if (receiver && message.type == PAIR_PROBE)
+    {
+        // A pad probing again before the answer went out takes its old slot
+        uint8_t slot = 0;
+        while (slot < probeCount && memcmp(probes[slot].mac, mac, 6) != 0)
+            slot++;
+        if (slot < PAIRING_MAX_PENDING)
+        {
+            memcpy(probes[slot].mac, mac, 6);
+            probes[slot].clientId = message.clientId;
+            probes[slot].nonce = message.nonce;
+            if (slot == probeCount)
+                probeCount++;
+        }
+    }
+    else if (!receiver && message.type == PAIR_ACCEPT && (searching || announcing) && message.nonce == nonce)
+    {
+        memcpy(acceptMac, mac, 6);
+        accept = message;
+        acceptPending = true;
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+void EspNowPairing::handle(bool wifiConnected, bool wifiConnecting)
+{
+    if (espNow == nullptr)
+        return;
+
+    if (receiver)
+    {
+        answerProbes();
+        return;
+    }
+
+    uint8_t mac[6];
+    struct_pair_message message;
+    bool haveAccept;
+    portENTER_CRITICAL(&mux);
+    haveAccept = acceptPending;
+    memcpy(mac, acceptMac, 6);
+    message = accept;
+    acceptPending = false;
+    portEXIT_CRITICAL(&mux);
+
+    if (haveAccept)
+    {
+        applyAccept(mac, message, wifiConnected);
+        return;
+    }
+
+    if (searching)
+    {
+        sweep(wifiConnected, wifiConnecting);
+        return;
+    }
+
+    // Frames to the receiver stopped being acknowledged: gone, or swapped for another one
+    if (paired && espNow->getConsecutiveFailures() >= PAIRING_LOST_FAILURES)
+    {
+        Serial.printf("[PAIR] Receiver %02X:%02X:%02X:%02X:%02X:%02X not answering\n",
+                      receiverMac[0], receiverMac[1], receiverMac[2], receiverMac[3], receiverMac[4], receiverMac[5]);
+        startSearch(espNow->getChannel());
+        return;
+    }
+
+    // The ID was changed on the pad since the receiver last heard of it; a
+    // button preview is only announced once it is saved
+    if (paired && assignIds && clientIdentity->getSaved() != announcedId &&
+        (lastAnnounceMs == 0 || millis() - lastAnnounceMs >= PAIRING_RETRY_INTERVAL))
+        announceId();
+}
+
+void EspNowPairing::announceId()
+{
+    portENTER_CRITICAL(&mux);
+    nonce = esp_random();
+    announcing = true;
+    portEXIT_CRITICAL(&mux);
+
+    // A probe straight to the receiver: it answers like any other, keeping the ID if it is free
+    struct_pair_message probe = {};
+    probe.magic = ESPNOW_PAIR_MAGIC;
+    probe.type = PAIR_PROBE;
+    probe.channel = espNow->getChannel();
+    probe.clientId = (int8_t)clientIdentity->getSaved();
+    probe.nonce = nonce;
+    espNow->sendTo(receiverMac, (const uint8_t *)&probe, sizeof(probe));
+    lastAnnounceMs = millis();
+    Serial.printf("[PAIR] Announcing client ID %d to the receiver\n", probe.clientId);
+}
+
+void EspNowPairing::sweep(bool wifiConnected, bool wifiConnecting)
+{
+    unsigned long now = millis();
+
+    // The station owns the radio while it connects
+    if (wifiConnecting)
+    {
+        scanChannel = 0;
+        return;
+    }
+
+    if (scanChannel == 0)
+    {
+        if ((long)(now - nextSweepMs) < 0)
+            return;
+        scanChannel = 1;
+        lastScanChannel = PAIRING_MAX_CHANNEL;
+    }
+    else if (now - lastHopMs < PAIRING_DWELL_MS)
+    {
+        return;
+    }
+    else if (scanChannel >= lastScanChannel)
+    {
+        // Nobody answered on any channel: back home until the next sweep
+        sweeps++;
+        scanChannel = 0;
+        nextSweepMs = now + PAIRING_RETRY_INTERVAL;
+        if (!wifiConnected)
+            espNow->setChannel(homeChannel);
+        Serial.printf("[PAIR] No receiver found (sweep %u), retrying in %d ms\n", sweeps, PAIRING_RETRY_INTERVAL);
+        return;
+    }
+    else
+    {
+        scanChannel++;
+    }
+
+    // Connected, the AP's channel is the only one the receiver can be reached on
+    if (wifiConnected)
+    {
+        scanChannel = espNow->getChannel();
+        lastScanChannel = scanChannel;
+    }
+    else
+    {
+        espNow->setChannel(scanChannel);
+    }
+
+    struct_pair_message probe = {};
+    probe.magic = ESPNOW_PAIR_MAGIC;
+    probe.type = PAIR_PROBE;
+    probe.channel = scanChannel;
+    probe.clientId = (int8_t)clientIdentity->get();
+    probe.nonce = nonce;
+    espNow->sendBroadcast((const uint8_t *)&probe, sizeof(probe));
+    lastHopMs = now;
+}
+
+void EspNowPairing::applyAccept(const uint8_t *mac, const struct_pair_message &message, bool wifiConnected)
+{
+    bool wasSearching;
+    portENTER_CRITICAL(&mux);
+    wasSearching = searching;
+    searching = false;
+    announcing = false;
+    portEXIT_CRITICAL(&mux);
+    scanChannel = 0;
+
+    uint8_t channel = message.channel != 0 ? message.channel : espNow->getChannel();
+    bool changed = !paired || memcmp(receiverMac, mac, 6) != 0 || receiverChannel != channel;
+    paired = true;
+    memcpy(receiverMac, mac, 6);
+    receiverChannel = channel;
+
+    // Only when something changed, a receiver that was briefly gone costs no flash write
+    if (changed)
+    {
+        preferences.putBytes("peer", receiverMac, sizeof(receiverMac));
+        preferences.putUChar("channel", receiverChannel);
+    }
+    espNow->setReceiver(receiverMac);
+    if (!wifiConnected)
+        espNow->setChannel(receiverChannel);
+
+    if (wasSearching)
+        Serial.printf("[PAIR] Paired with %02X:%02X:%02X:%02X:%02X:%02X on channel %u after %lu ms\n",
+                      mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], channel, millis() - searchStartMs);
+
+    if (assignIds && message.clientId >= 0 && message.clientId < PAIRING_MAX_IDS && message.clientId != clientIdentity->get())
+    {
+        clientIdentity->set(message.clientId);
+        Serial.printf("[PAIR] Client ID %d assigned by the receiver\n", message.clientId);
+    }
+
+    // -1 from the receiver: all IDs taken, the pad keeps its own and does not ask again
+    int8_t confirmed = (int8_t)clientIdentity->getSaved();
+    if (confirmed != announcedId)
+    {
+        announcedId = confirmed;
+        preferences.putChar("announced", announcedId);
+    }
+}
+
+void EspNowPairing::answerProbes()
+{
+    PendingProbe pending[PAIRING_MAX_PENDING];
+    uint8_t count;
+    portENTER_CRITICAL(&mux);
+    count = probeCount;
+    memcpy(pending, probes, sizeof(PendingProbe) * count);
+    probeCount = 0;
+    portEXIT_CRITICAL(&mux);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const PendingProbe &probe = pending[i];
+        struct_pair_message answer = {};
+        answer.magic = ESPNOW_PAIR_MAGIC;
+        answer.type = PAIR_ACCEPT;
+        answer.channel = espNow->getChannel();
+        answer.clientId = assignIds ? assignId(probe.mac, probe.clientId) : -1;
+        answer.nonce = probe.nonce;
+        if (!espNow->sendTo(probe.mac, (const uint8_t *)&answer, sizeof(answer)))
+            continue;
+
+        Serial.printf("[PAIR] Pad %02X:%02X:%02X:%02X:%02X:%02X paired, ID %d\n",
+                      probe.mac[0], probe.mac[1], probe.mac[2], probe.mac[3], probe.mac[4], probe.mac[5],
+                      answer.clientId >= 0 ? answer.clientId : probe.clientId);
+    }
+}
+
+int8_t EspNowPairing::assignId(const uint8_t *mac, int8_t requested)
+{
+    int ownId = clientIdentity->get();
+    int8_t previous = -1;
+    for (int id = 0; id < PAIRING_MAX_IDS; id++)
+    {
+        if (memcmp(assignedMacs[id], mac, 6) == 0)
+            previous = id;
+    }
+
+    // The ID the pad asks for if nobody else has it, then the one it had, then the lowest free one
+    auto available = [&](int id)
+    {
+        return id >= 0 && id < PAIRING_MAX_IDS && id != ownId && (isZeroMac(assignedMacs[id]) || id == previous);
+    };
+    int8_t id = -1;
+    if (available(requested))
+        id = requested;
+    else if (available(previous))
+        id = previous;
+    else
+    {
+        for (int candidate = 0; candidate < PAIRING_MAX_IDS && id < 0; candidate++)
+        {
+            if (available(candidate))
+                id = candidate;
+        }
+    }
+    if (id < 0)
+        return -1; // All taken, the pad keeps its own
+
+    if (id != previous)
+    {
+        if (previous >= 0)
+            memset(assignedMacs[previous], 0, 6);
+        memcpy(assignedMacs[id], mac, 6);
+        preferences.putBytes("ids", assignedMacs, sizeof(assignedMacs));
+    }
+    return id;
+}
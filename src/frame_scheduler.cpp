@@ -0,0 +1,124 @@
+#include "frame_scheduler.h"
+
+FrameScheduler::FrameScheduler()
+{
+    espNow = nullptr;
+    nextSequence = nullptr;
+    capture = nullptr;
+    touchHead = 0;
+    touchCount = 0;
+    memset(&telemetry, 0, sizeof(telemetry));
+    telemetryWaiting = false;
+    telemetryQueuedMs = 0;
+    resetStats();
+}
+
+void FrameScheduler::begin(EspNowManager *espNowManager, SequenceSource sequenceSource, TrafficCapture *trafficCapture)
+{
+    espNow = espNowManager;
+    nextSequence = sequenceSource;
+    capture = trafficCapture;
+}
+
+bool FrameScheduler::transmit(espnow_header &header, size_t length)
+{
+    header.sequence = nextSequence != nullptr ? nextSequence() : 0;
+    if (capture != nullptr)
+        capture->record(CAPTURE_KIND_TX, nullptr, (const uint8_t *)&header, length);
+    if (espNow->send((const uint8_t *)&header, length))
+        return true;
+    sendErrors++;
+    return false;
+}
+
+void FrameScheduler::queueTouch(const struct_touch_frame &frame)
+{
+    if (espNow == nullptr)
+        return;
+
+    // Nothing ahead of it and a free slot: straight to the radio
+    if (touchCount == 0 && espNow->getPendingSends() < ESPNOW_TOUCH_MAX_IN_FLIGHT)
+    {
+        struct_touch_frame copy = frame;
+        transmit(copy.header, sizeof(copy));
+        touchSent++;
+        return;
+    }
+
+    if (touchCount == ESPNOW_TOUCH_QUEUE_LENGTH)
+    {
+        // The newest state matters most, the oldest waiting frame goes
+        touchHead = (touchHead + 1) % ESPNOW_TOUCH_QUEUE_LENGTH;
+        touchCount--;
+        touchDropped++;
+    }
+    uint8_t slot = (touchHead + touchCount) % ESPNOW_TOUCH_QUEUE_LENGTH;
+    touchQueue[slot] = frame;
+    touchQueuedUs[slot] = micros();
+    touchCount++;
+}
+
+void FrameScheduler::queueTelemetry(const struct_telemetry_frame &frame)
+{
+    if (espNow == nullptr)
+        return;
+
+    if (telemetryWaiting)
+        telemetryReplaced++;
+    else
+        telemetryQueuedMs = millis();
+    telemetry = frame;
+    telemetryWaiting = true;
+    handle();
+}
+
+void FrameScheduler::handle()
+{
+    if (espNow == nullptr)
+        return;
+
+    while (touchCount > 0 && espNow->getPendingSends() < ESPNOW_TOUCH_MAX_IN_FLIGHT)
+    {
+        struct_touch_frame &frame = touchQueue[touchHead];
+        uint32_t waitUs = micros() - touchQueuedUs[touchHead];
+        transmit(frame.header, sizeof(frame));
+        touchHead = (touchHead + 1) % ESPNOW_TOUCH_QUEUE_LENGTH;
+        touchCount--;
+
+        touchSent++;
+        touchWaited++;
+        touchWaitTotalUs += waitUs;
+        if (waitUs > touchWaitMaxUs)
+            touchWaitMaxUs = waitUs;
+    }
+
+    if (!telemetryWaiting || touchCount > 0)
+        return;
+    // A quiet radio, or waited long enough to take a touch slot
+    bool overdue = millis() - telemetryQueuedMs >= ESPNOW_TELEMETRY_MAX_DEFER;
+    if (espNow->isSendPending() && !(overdue && espNow->getPendingSends() < ESPNOW_TOUCH_MAX_IN_FLIGHT))
+        return;
+
+    transmit(telemetry.header, espNowTelemetrySize(telemetry));
+    telemetryWaiting = false;
+    telemetrySent++;
+}
+
+void FrameScheduler::printStats() const
+{
+    Serial.printf("[RADIO] touch %u sent, %u waited (avg %u us, max %u us), %u dropped; telemetry %u sent, %u replaced; %u send errors\n",
+                  touchSent, touchWaited, touchWaited > 0 ? (uint32_t)(touchWaitTotalUs / touchWaited) : 0, touchWaitMaxUs,
+                  touchDropped, telemetrySent, telemetryReplaced, sendErrors);
+}
+
+void FrameScheduler::resetStats()
+{
+    touchSent = 0;
+    touchWaited = 0;
+    touchDropped = 0;
+    touchWaitMaxUs = 0;
+    touchWaitTotalUs = 0;
+    telemetrySent = 0;
+    telemetryReplaced = 0;
+    sendErrors = 0;
+}
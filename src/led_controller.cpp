@@ -1,65 +1,194 @@
 #include "led_controller.h"
-#include "config.h"
 
-LEDController::LEDController() : pixel(NUM_PIXELS, RGB_LED_PIN, NEO_GRB + NEO_KHZ800)
+// WS2812 bit timings in RMT ticks: 80 MHz APB / 2 = 25 ns per tick
+#define LED_RMT_CLOCK_DIV 2
+#define WS2812_T0H 16 // 0.40 us
+#define WS2812_T0L 34 // 0.85 us
+#define WS2812_T1H 32 // 0.80 us
+#define WS2812_T1L 18 // 0.45 us
+
+LEDController::LEDController()
 {
-    currentRed = 0;
-    currentGreen = 0;
-    currentBlue = 0;
+    for (uint8_t i = 0; i < NUM_PIXELS; i++)
+        pixels[i] = {0, EFFECT_SOLID, 0, 0};
+    memset(frame, 0, sizeof(frame));
+    memset(txBuffer, 0, sizeof(txBuffer));
+    channel = (rmt_channel_t)LED_RMT_CHANNEL;
+    brightness = LED_BRIGHTNESS;
+    ready = false;
+    frameValid = false;
+    lastFrameMs = 0;
+    framesSent = 0;
+    framesSkipped = 0;
+}
+
+// Expands bytes into RMT items; runs from the RMT interrupt while the frame is sent
+void IRAM_ATTR LEDController::translateToRmt(const void *src, rmt_item32_t *dest, size_t srcSize,
+                                             size_t wantedNum, size_t *translatedSize, size_t *itemNum)
+{
+    const rmt_item32_t bit0 = {{{WS2812_T0H, 1, WS2812_T0L, 0}}};
+    const rmt_item32_t bit1 = {{{WS2812_T1H, 1, WS2812_T1L, 0}}};
+    const uint8_t *bytes = (const uint8_t *)src;
+    size_t size = 0;
+    size_t num = 0;
+
+    while (size < srcSize && num + 8 <= wantedNum)
+    {
+        for (uint8_t bit = 0; bit < 8; bit++)
+            dest[num++] = (bytes[size] & (0x80 >> bit)) ? bit1 : bit0;
+        size++;
+    }
+    *translatedSize = size;
+    *itemNum = num;
 }
 
-void LEDController::init()
+bool LEDController::init()
 {
-    pixel.begin();
-    pixel.setBrightness(128);
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)RGB_LED_PIN, channel);
+    config.clk_div = LED_RMT_CLOCK_DIV;
+
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(channel, 0, 0) != ESP_OK ||
+        rmt_translator_init(channel, translateToRmt) != ESP_OK)
+    {
+        Serial.printf("[LED] RMT initialization on GPIO %d failed\n", RGB_LED_PIN);
+        return false;
+    }
+    ready = true;
     setDisconnectedIndicator();
+    return true;
+}
+
+void LEDController::setPixel(uint8_t index, uint32_t color, Effect effect, uint16_t periodMs)
+{
+    if (index >= NUM_PIXELS)
+        return;
+
+    PixelState &pixel = pixels[index];
+    if (pixel.color == color && pixel.effect == effect && pixel.periodMs == periodMs)
+        return; // Unchanged, keep the animation phase
+
+    // Restart the phase only when the animation itself changes, not just its colour
+    if (pixel.effect != effect || pixel.periodMs != periodMs)
+        pixel.startedMs = millis();
+    pixel.color = color;
+    pixel.effect = effect;
+    pixel.periodMs = periodMs;
 }
 
 void LEDController::setColor(int red, int green, int blue)
 {
-    currentRed = red;
-    currentGreen = green;
-    currentBlue = blue;
-    pixel.setPixelColor(0, pixel.Color(red, green, blue));
-    pixel.show();
+    for (uint8_t i = 0; i < NUM_PIXELS; i++)
+        setPixel(i, ledColor(red, green, blue));
 }
 
 void LEDController::setConnectingIndicator()
 {
-    static bool ledState = false;
-    ledState = !ledState;
-    pixel.setPixelColor(0, ledState ? pixel.Color(0, 0, 255) : pixel.Color(0, 0, 0));
-    pixel.show();
+    setPixel(LED_STATUS_PIXEL, ledColor(0, 0, 255), EFFECT_BLINK, LED_BLINK_PERIOD);
 }
 
 void LEDController::setConnectedIndicator()
 {
-    pixel.setPixelColor(0, pixel.Color(0, 255, 0));
-    pixel.show();
+    setPixel(LED_STATUS_PIXEL, ledColor(0, 255, 0));
 }
 
 void LEDController::setDisconnectedIndicator()
 {
-    pixel.setPixelColor(0, pixel.Color(255, 0, 0));
-    pixel.show();
+    setPixel(LED_STATUS_PIXEL, ledColor(255, 0, 0));
 }
 
 void LEDController::setSensorIndicator(int sensorValue)
 {
     if (sensorValue == 1)
     {
-        pixel.setPixelColor(0, pixel.Color(0, 0, 255)); // Blue
+        setPixel(LED_STATUS_PIXEL, ledColor(0, 0, 255)); // Blue
     }
     else
     {
-        pixel.setPixelColor(0, pixel.Color(255, 0, 0)); // Red
+        setPixel(LED_STATUS_PIXEL, ledColor(255, 0, 0)); // Red
     }
-    pixel.show();
+}
+
+void LEDController::setPadState(int padId, bool present, bool touched)
+{
+    int index = LED_PAD_PIXEL_OFFSET + padId;
+    if (padId < 0 || index >= NUM_PIXELS)
+        return;
+
+    if (!present)
+        setPixel(index, 0);
+    else if (touched)
+        setPixel(index, LED_PAD_TOUCHED_COLOR);
+    else
+        setPixel(index, LED_PAD_IDLE_COLOR, EFFECT_PULSE, LED_PULSE_PERIOD);
+}
+
+uint32_t LEDController::renderPixel(const PixelState &pixel, unsigned long now) const
+{
+    uint32_t level = 255;
+    if (pixel.effect != EFFECT_SOLID && pixel.periodMs > 0)
+    {
+        uint32_t phase = (now - pixel.startedMs) % pixel.periodMs;
+        if (pixel.effect == EFFECT_BLINK)
+        {
+            level = phase < pixel.periodMs / 2 ? 255 : 0;
+        }
+        else
+        {
+            // Triangle wave, squared so the fade looks even to the eye
+            uint32_t triangle = phase * 510 / pixel.periodMs;
+            if (triangle > 255)
+                triangle = 510 - triangle;
+            level = triangle * triangle / 255;
+        }
+    }
+
+    level = level * (brightness + 1) >> 8;
+    uint32_t red = ((pixel.color >> 16) & 0xFF) * level / 255;
+    uint32_t green = ((pixel.color >> 8) & 0xFF) * level / 255;
+    uint32_t blue = (pixel.color & 0xFF) * level / 255;
+    return (red << 16) | (green << 8) | blue;
+}
+
+void LEDController::handle()
+{
+    if (!ready)
+        return;
+
+    unsigned long now = millis();
+    if (now - lastFrameMs < LED_FRAME_INTERVAL)
+        return;
+    lastFrameMs = now;
+
+    uint8_t next[NUM_PIXELS * 3];
+    for (uint8_t i = 0; i < NUM_PIXELS; i++)
+    {
+        uint32_t color = renderPixel(pixels[i], now);
+        next[i * 3] = (color >> 8) & 0xFF; // WS2812 wants GRB
+        next[i * 3 + 1] = (color >> 16) & 0xFF;
+        next[i * 3 + 2] = color & 0xFF;
+    }
+
+    if (frameValid && memcmp(next, frame, sizeof(next)) == 0)
+        return;
+
+    // Previous frame still going out: try again on the next tick rather than wait
+    if (rmt_wait_tx_done(channel, 0) != ESP_OK)
+    {
+        framesSkipped++;
+        return;
+    }
+
+    memcpy(frame, next, sizeof(frame));
+    memcpy(txBuffer, next, sizeof(txBuffer));
+    rmt_write_sample(channel, txBuffer, sizeof(txBuffer), false);
+    frameValid = true;
+    framesSent++;
 }
 
 void LEDController::getCurrentColor(int &red, int &green, int &blue)
 {
-    red = currentRed;
-    green = currentGreen;
-    blue = currentBlue;
-}
\ No newline at end of file
+    uint32_t color = pixels[LED_STATUS_PIXEL].color;
+    red = (color >> 16) & 0xFF;
+    green = (color >> 8) & 0xFF;
+    blue = color & 0xFF;
+}
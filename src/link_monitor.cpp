@@ -0,0 +1,262 @@
+#include "link_monitor.h"
+#include "config.h"
+
+struct RateStep
+{
+    wifi_phy_rate_t rate;
+    const char *name;
+    int8_t minRssi; // Weakest peer RSSI at which stepping up to this rate is allowed
+};
+
+// Slowest (longest range) to fastest. ESP-NOW frames are short, so higher
+// rates mostly buy airtime; the long-range rates need WIFI_PROTOCOL_LR on
+// both ends.
+static const RateStep RATE_STEPS[] = {
+    {WIFI_PHY_RATE_LORA_250K, "LR 250K", -128},
+    {WIFI_PHY_RATE_LORA_500K, "LR 500K", -92},
+    {WIFI_PHY_RATE_1M_L, "1M", -88},
+    {WIFI_PHY_RATE_6M, "6M", -80},
+    {WIFI_PHY_RATE_12M, "12M", -75},
+    {WIFI_PHY_RATE_24M, "24M", -70},
+    {WIFI_PHY_RATE_54M, "54M", -62},
+};
+static const uint8_t RATE_STEP_COUNT = sizeof(RATE_STEPS) / sizeof(RATE_STEPS[0]);
+static const uint8_t DEFAULT_RATE_INDEX = 2; // 1 Mbps, the ESP-NOW default
+
+LinkMonitor *LinkMonitor::instance = nullptr;
+
+LinkMonitor::LinkMonitor()
+{
+    memset(peers, 0, sizeof(peers));
+    peerCount = 0;
+    mux = portMUX_INITIALIZER_UNLOCKED;
+    adaptive = false;
+    lowestRateIndex = DEFAULT_RATE_INDEX;
+    rateIndex = DEFAULT_RATE_INDEX;
+    rateChanges = 0;
+    windowSent = 0;
+    windowDelivered = 0;
+    lastEvaluationMs = 0;
+    lastStepDownMs = 0;
+}
+
+void LinkMonitor::onPromiscuousPacket(void *buffer, wifi_promiscuous_pkt_type_t type)
+{
+    if (type != WIFI_PKT_MGMT || instance == nullptr)
+        return;
+
+    const wifi_promiscuous_pkt_t *packet = (const wifi_promiscuous_pkt_t *)buffer;
+    const uint8_t *frame = packet->payload;
+    if (packet->rx_ctrl.sig_len < 28)
+        return;
+
+    // Action frame, vendor specific category, Espressif OUI: an ESP-NOW frame
+    if (frame[0] != 0xD0 || frame[24] != 0x7F || frame[25] != 0x18 || frame[26] != 0xFE || frame[27] != 0x34)
+        return;
+
+    instance->recordRssi(frame + 10, (int8_t)packet->rx_ctrl.rssi);
+}
+
+void LinkMonitor::begin(bool adaptiveRate, bool allowLongRange)
+{
+    instance = this;
+    adaptive = adaptiveRate;
+    lowestRateIndex = allowLongRange ? 0 : DEFAULT_RATE_INDEX;
+
+    if (allowLongRange)
+    {
+        // Keep 802.11 b/g/n for the AP, add LR for ESP-NOW
+        esp_wifi_set_protocol(WIFI_IF_STA, WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N | WIFI_PROTOCOL_LR);
+    }
+
+    // Only management frames are delivered, ESP-NOW rides on action frames
+    wifi_promiscuous_filter_t filter = {};
+    filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT;
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(onPromiscuousPacket);
+    esp_wifi_set_promiscuous(true);
+
+    applyRate(ESPNOW_FIXED_RATE_INDEX < RATE_STEP_COUNT && ESPNOW_FIXED_RATE_INDEX >= lowestRateIndex
+                  ? ESPNOW_FIXED_RATE_INDEX
+                  : DEFAULT_RATE_INDEX);
+    Serial.printf("[LINK] ESP-NOW rate %s (%s)\n", getRateName(), adaptive ? "adaptive" : "fixed");
+}
+
+PeerLinkStats *LinkMonitor::findOrAddPeer(const uint8_t *mac)
+{
+    for (uint8_t i = 0; i < peerCount; i++)
+    {
+        if (memcmp(peers[i].mac, mac, 6) == 0)
+            return &peers[i];
+    }
+    if (peerCount >= LINK_MONITOR_MAX_PEERS)
+        return nullptr;
+
+    PeerLinkStats *peer = &peers[peerCount++];
+    memset(peer, 0, sizeof(*peer));
+    memcpy(peer->mac, mac, 6);
+    return peer;
+}
+
+void LinkMonitor::recordSend(const uint8_t *mac, bool delivered)
+{
+    // Called from the WiFi task
+    portENTER_CRITICAL(&mux);
+    PeerLinkStats *peer = findOrAddPeer(mac);
+    if (peer != nullptr)
+    {
+        peer->sent++;
+        if (delivered)
+            peer->delivered++;
+        else
+            peer->failed++;
+    }
+    windowSent++;
+    if (delivered)
+        windowDelivered++;
+    portEXIT_CRITICAL(&mux);
+}
+
+void LinkMonitor::recordRssi(const uint8_t *mac, int8_t rssi)
+{
+    portENTER_CRITICAL(&mux);
+    PeerLinkStats *peer = findOrAddPeer(mac);
+    if (peer != nullptr)
+    {
+        int32_t sampleQ4 = (int32_t)rssi * 16;
+        peer->rssiAvgQ4 = peer->rssiSamples == 0 ? sampleQ4 : peer->rssiAvgQ4 + (sampleQ4 - peer->rssiAvgQ4) / 8;
+        peer->lastRssi = rssi;
+        peer->rssiSamples++;
+        peer->lastHeardMs = millis();
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+int8_t LinkMonitor::getWorstRecentRssi(bool &known)
+{
+    unsigned long now = millis();
+    int32_t worst = 0;
+    known = false;
+
+    portENTER_CRITICAL(&mux);
+    for (uint8_t i = 0; i < peerCount; i++)
+    {
+        const PeerLinkStats &peer = peers[i];
+        if (peer.rssiSamples == 0 || now - peer.lastHeardMs > LINK_EVALUATION_INTERVAL * 2)
+            continue;
+        int32_t rssi = peer.rssiAvgQ4 / 16;
+        if (!known || rssi < worst)
+            worst = rssi;
+        known = true;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    return (int8_t)worst;
+}
+
+bool LinkMonitor::applyRate(uint8_t index)
+{
+    if (esp_wifi_config_espnow_rate(WIFI_IF_STA, RATE_STEPS[index].rate) != ESP_OK)
+    {
+        Serial.printf("[LINK] Failed to set ESP-NOW rate %s\n", RATE_STEPS[index].name);
+        return false;
+    }
+    rateIndex = index;
+    return true;
+}
+
+void LinkMonitor::handle()
+{
+    unsigned long now = millis();
+    if (now - lastEvaluationMs < LINK_EVALUATION_INTERVAL)
+        return;
+    lastEvaluationMs = now;
+
+    portENTER_CRITICAL(&mux);
+    uint32_t sent = windowSent;
+    uint32_t delivered = windowDelivered;
+    windowSent = 0;
+    windowDelivered = 0;
+    portEXIT_CRITICAL(&mux);
+
+    if (!adaptive || sent < LINK_MIN_SAMPLES)
+        return;
+
+    bool rssiKnown;
+    int8_t worstRssi = getWorstRecentRssi(rssiKnown);
+    uint32_t deliveryPercent = delivered * 100 / sent;
+    uint8_t target = rateIndex;
+
+    if (deliveryPercent < LINK_STEP_DOWN_PERCENT || (rssiKnown && worstRssi < RATE_STEPS[rateIndex].minRssi - 6))
+    {
+        // Losing frames or the weakest peer is fading: trade airtime for range
+        if (rateIndex > lowestRateIndex)
+        {
+            target = rateIndex - 1;
+            lastStepDownMs = now;
+        }
+    }
+    else if (deliveryPercent >= LINK_STEP_UP_PERCENT && rateIndex + 1 < RATE_STEP_COUNT)
+    {
+        // Climb when the weakest peer is known to be strong enough. A pure sender
+        // hears no ESP-NOW frames and never learns RSSI: it climbs on delivery
+        // alone, but not again soon after a faster rate had to be given up.
+        if (rssiKnown ? worstRssi >= RATE_STEPS[rateIndex + 1].minRssi
+                      : lastStepDownMs == 0 || now - lastStepDownMs >= LINK_BLIND_STEP_UP_HOLDOFF)
+            target = rateIndex + 1;
+    }
+
+    if (target != rateIndex)
+    {
+        const char *previous = getRateName();
+        if (applyRate(target))
+        {
+            rateChanges++;
+            Serial.printf("[LINK] Delivery %u%%, worst RSSI %s%d dBm: rate %s -> %s\n",
+                          deliveryPercent, rssiKnown ? "" : "unknown ", rssiKnown ? worstRssi : 0,
+                          previous, getRateName());
+        }
+    }
+}
+
+const char *LinkMonitor::getRateName() const
+{
+    return RATE_STEPS[rateIndex].name;
+}
+
+String LinkMonitor::getJSON()
+{
+    PeerLinkStats snapshot[LINK_MONITOR_MAX_PEERS];
+    portENTER_CRITICAL(&mux);
+    uint8_t count = peerCount;
+    memcpy(snapshot, peers, sizeof(PeerLinkStats) * count);
+    portEXIT_CRITICAL(&mux);
+
+    unsigned long now = millis();
+    String json = "{\"rate\":\"" + String(getRateName()) + "\",";
+    json += "\"adaptive\":" + String(adaptive ? "true" : "false") + ",";
+    json += "\"rateChanges\":" + String(rateChanges) + ",\"peers\":[";
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const PeerLinkStats &peer = snapshot[i];
+        char mac[18];
+        snprintf(mac, sizeof(mac), "%02X:%02X:%02X:%02X:%02X:%02X",
+                 peer.mac[0], peer.mac[1], peer.mac[2], peer.mac[3], peer.mac[4], peer.mac[5]);
+        if (i > 0)
+            json += ",";
+        json += "{\"mac\":\"" + String(mac) + "\",";
+        json += "\"sent\":" + String(peer.sent) + ",";
+        json += "\"delivered\":" + String(peer.delivered) + ",";
+        json += "\"failed\":" + String(peer.failed) + ",";
+        json += "\"deliveryPercent\":" + String(peer.sent ? peer.delivered * 100.0f / peer.sent : 0.0f, 1);
+        if (peer.rssiSamples > 0)
+        {
+            json += ",\"rssi\":" + String(peer.lastRssi);
+            json += ",\"rssiAvg\":" + String(peer.rssiAvgQ4 / 16.0f, 1);
+            json += ",\"lastHeardMs\":" + String(now - peer.lastHeardMs);
+        }
+        json += "}";
+    }
+    json += "]}";
+    return json;
+}
@@ -0,0 +1,309 @@
+#include "loop_scheduler.h"
+#include "trace_recorder.h"
+
+LoopScheduler::LoopScheduler()
+    : readyHead(-1), lastTickMs(0), loopBudgetUs(0), lateToleranceMs(0),
+      windowStartUs(0), busyUs(0), maxIterationUs(0), deferredRuns(0)
+{
+    for (int i = 0; i < SCHEDULER_MAX_JOBS; i++)
+        jobs[i].active = false;
+    for (int i = 0; i < SCHEDULER_WHEEL_SLOTS; i++)
+        wheel[i] = -1;
+}
+
+void LoopScheduler::begin(uint32_t budgetUs, uint32_t toleranceMs)
+{
+    loopBudgetUs = budgetUs;
+    lateToleranceMs = toleranceMs;
+    lastTickMs = millis();
+    resetStats();
+}
+
+int LoopScheduler::addJob(const char *name, JobFunction function, unsigned long periodMs, unsigned long delayMs, uint8_t priority, uint32_t budgetUs)
+{
+    for (int id = 0; id < SCHEDULER_MAX_JOBS; id++)
+    {
+        if (jobs[id].active)
+            continue;
+        Job &job = jobs[id];
+        job = Job();
+        job.name = name;
+        job.function = function;
+        job.periodMs = periodMs;
+        job.dueMs = millis() + delayMs;
+        job.budgetUs = budgetUs;
+        job.priority = priority;
+        job.active = true;
+        job.wakeup = true;
+        job.next = -1;
+        insert(id);
+        return id;
+    }
+    Serial.printf("[SCHED] No room for job %s\n", name);
+    return -1;
+}
+
+int LoopScheduler::addPeriodic(const char *name, JobFunction function, unsigned long periodMs, uint8_t priority, uint32_t budgetUs, unsigned long phaseMs)
+{
+    return addJob(name, function, periodMs > 0 ? periodMs : 1, phaseMs, priority, budgetUs);
+}
+
+int LoopScheduler::addOneShot(const char *name, JobFunction function, unsigned long delayMs, uint8_t priority, uint32_t budgetUs)
+{
+    return addJob(name, function, 0, delayMs, priority, budgetUs);
+}
+
+void LoopScheduler::insert(int id)
+{
+    Job &job = jobs[id];
+    // Its slot may have been passed already this turn of the wheel
+    if ((long)(job.dueMs - lastTickMs) <= 0)
+    {
+        makeReady(id);
+        return;
+    }
+    int slot = job.dueMs % SCHEDULER_WHEEL_SLOTS;
+    job.next = wheel[slot];
+    job.scheduled = true;
+    wheel[slot] = (int8_t)id;
+}
+
+void LoopScheduler::unlink(int id)
+{
+    Job &job = jobs[id];
+    int8_t *link = job.ready ? &readyHead : job.scheduled ? &wheel[job.dueMs % SCHEDULER_WHEEL_SLOTS] : nullptr;
+    if (link == nullptr)
+        return;
+    while (*link >= 0 && *link != id)
+        link = &jobs[*link].next;
+    if (*link == id)
+        *link = job.next;
+    job.next = -1;
+    job.ready = false;
+    job.scheduled = false;
+}
+
+void LoopScheduler::makeReady(int id)
+{
+    // Ordered by priority, then by due time
+    Job &job = jobs[id];
+    int8_t *link = &readyHead;
+    while (*link >= 0)
+    {
+        const Job &other = jobs[*link];
+        if (other.priority > job.priority || (other.priority == job.priority && (long)(other.dueMs - job.dueMs) > 0))
+            break;
+        link = &jobs[*link].next;
+    }
+    job.next = *link;
+    job.ready = true;
+    job.scheduled = false;
+    *link = (int8_t)id;
+}
+
+void LoopScheduler::collectDue(unsigned long now)
+{
+    // Only the slots passed since the last call; after a long gap (light
+    // sleep, a slow iteration) one sweep of the whole wheel covers it
+    unsigned long elapsed = now - lastTickMs;
+    unsigned long steps = elapsed < SCHEDULER_WHEEL_SLOTS ? elapsed : SCHEDULER_WHEEL_SLOTS;
+    for (unsigned long step = 1; step <= steps; step++)
+    {
+        int8_t *link = &wheel[(lastTickMs + step) % SCHEDULER_WHEEL_SLOTS];
+        while (*link >= 0)
+        {
+            int id = *link;
+            if ((long)(jobs[id].dueMs - now) > 0)
+            {
+                link = &jobs[id].next; // A later turn of the wheel
+                continue;
+            }
+            *link = jobs[id].next;
+            makeReady(id);
+        }
+    }
+    lastTickMs = now;
+}
+
+void LoopScheduler::runJob(int id)
+{
+    Job &job = jobs[id];
+    unsigned long now = millis();
+    uint32_t lateMs = (long)(now - job.dueMs) > 0 ? now - job.dueMs : 0;
+    if (lateMs > job.maxLateMs)
+        job.maxLateMs = lateMs;
+    if (lateMs > lateToleranceMs)
+        job.lateStarts++;
+
+    unsigned long startUs = micros();
+    {
+        TRACE_SCOPE(job.name);
+        job.function();
+    }
+    uint32_t runUs = micros() - startUs;
+
+    busyUs += runUs;
+    job.runs++;
+    job.totalRunUs += runUs;
+    if (runUs > job.maxRunUs)
+        job.maxRunUs = runUs;
+    if (job.budgetUs > 0 && runUs > job.budgetUs)
+        job.overruns++;
+
+    // The job may have cancelled or restarted itself
+    if (!job.active || job.scheduled || job.ready)
+        return;
+    if (job.periodMs == 0)
+    {
+        job.active = false;
+        return;
+    }
+
+    // Keep the phase; a job a whole period behind drops the runs it missed
+    job.dueMs += job.periodMs;
+    now = millis();
+    if ((long)(job.dueMs - now) <= 0)
+    {
+        unsigned long missed = (now - job.dueMs) / job.periodMs + 1;
+        job.dueMs += missed * job.periodMs;
+        job.skipped += missed;
+    }
+    insert(id);
+}
+
+void LoopScheduler::cancel(int id)
+{
+    if (id < 0 || id >= SCHEDULER_MAX_JOBS || !jobs[id].active)
+        return;
+    unlink(id);
+    jobs[id].active = false;
+}
+
+void LoopScheduler::restart(int id, unsigned long delayMs)
+{
+    if (id < 0 || id >= SCHEDULER_MAX_JOBS || !jobs[id].active)
+        return;
+    Job &job = jobs[id];
+    unlink(id);
+    job.dueMs = millis() + (delayMs == 0 && job.periodMs > 0 ? job.periodMs : delayMs);
+    insert(id);
+}
+
+void LoopScheduler::setWakeup(int id, bool wakeup)
+{
+    if (id >= 0 && id < SCHEDULER_MAX_JOBS)
+        jobs[id].wakeup = wakeup;
+}
+
+void LoopScheduler::run()
+{
+    unsigned long startUs = micros();
+    collectDue(millis());
+
+    while (readyHead >= 0)
+    {
+        int id = readyHead;
+        // Priority 0 always runs, the rest waits once this iteration is used up
+        if (jobs[id].priority > 0 && micros() - startUs > loopBudgetUs)
+        {
+            for (int8_t waiting = readyHead; waiting >= 0; waiting = jobs[waiting].next)
+                deferredRuns++;
+            break;
+        }
+        readyHead = jobs[id].next;
+        jobs[id].next = -1;
+        jobs[id].ready = false;
+        runJob(id);
+    }
+
+    uint32_t iterationUs = micros() - startUs;
+    if (iterationUs > maxIterationUs)
+        maxIterationUs = iterationUs;
+}
+
+unsigned long LoopScheduler::getNextDeadline() const
+{
+    unsigned long now = millis();
+    unsigned long deadline = now + 1000;
+    for (int id = 0; id < SCHEDULER_MAX_JOBS; id++)
+    {
+        const Job &job = jobs[id];
+        if (job.active && job.wakeup && (long)(job.dueMs - deadline) < 0)
+            deadline = job.dueMs;
+    }
+    return deadline;
+}
+
+float LoopScheduler::getIdlePercent() const
+{
+    uint32_t windowUs = micros() - windowStartUs;
+    if (windowUs == 0 || busyUs >= windowUs)
+        return 0.0f;
+    return 100.0f - busyUs * 100.0f / windowUs;
+}
+
+void LoopScheduler::resetStats()
+{
+    for (int id = 0; id < SCHEDULER_MAX_JOBS; id++)
+    {
+        Job &job = jobs[id];
+        job.runs = 0;
+        job.lateStarts = 0;
+        job.overruns = 0;
+        job.skipped = 0;
+        job.maxLateMs = 0;
+        job.maxRunUs = 0;
+        job.totalRunUs = 0;
+    }
+    windowStartUs = micros();
+    busyUs = 0;
+    maxIterationUs = 0;
+    deferredRuns = 0;
+}
+
+void LoopScheduler::printStats() const
+{
+    for (int id = 0; id < SCHEDULER_MAX_JOBS; id++)
+    {
+        const Job &job = jobs[id];
+        if (!job.active || job.runs == 0)
+            continue;
+        Serial.printf("[SCHED] %-10s runs=%u late=%u (max %u ms) overrun=%u skipped=%u run avg %u us max %u us\n",
+                      job.name, job.runs, job.lateStarts, job.maxLateMs, job.overruns, job.skipped,
+                      (uint32_t)(job.totalRunUs / job.runs), job.maxRunUs);
+    }
+    Serial.printf("[SCHED] idle %.1f%%, slowest iteration %u us, %u deferred runs\n",
+                  getIdlePercent(), maxIterationUs, deferredRuns);
+}
+
+String LoopScheduler::getJSON() const
+{
+    String json = "{";
+    json += "\"idlePercent\":" + String(getIdlePercent(), 1) + ",";
+    json += "\"maxIterationUs\":" + String(maxIterationUs) + ",";
+    json += "\"deferredRuns\":" + String(deferredRuns) + ",";
+    json += "\"jobs\":[";
+    bool first = true;
+    for (int id = 0; id < SCHEDULER_MAX_JOBS; id++)
+    {
+        const Job &job = jobs[id];
+        if (!job.active)
+            continue;
+        if (!first)
+            json += ",";
+        json += "{\"name\":\"" + String(job.name) + "\",";
+        json += "\"periodMs\":" + String(job.periodMs) + ",";
+        json += "\"priority\":" + String(job.priority) + ",";
+        json += "\"budgetUs\":" + String(job.budgetUs) + ",";
+        json += "\"runs\":" + String(job.runs) + ",";
+        json += "\"lateStarts\":" + String(job.lateStarts) + ",";
+        json += "\"maxLateMs\":" + String(job.maxLateMs) + ",";
+        json += "\"overruns\":" + String(job.overruns) + ",";
+        json += "\"skipped\":" + String(job.skipped) + ",";
+        json += "\"avgRunUs\":" + String(job.runs ? (uint32_t)(job.totalRunUs / job.runs) : 0) + ",";
+        json += "\"maxRunUs\":" + String(job.maxRunUs) + "}";
+        first = false;
+    }
+    json += "]}";
+    return json;
+}
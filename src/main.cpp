@@ -13,22 +13,38 @@
 #include "wifi_manager.h"
 #include "web_handlers.h"
 #include "sensor_manager.h"
-
-// ========================= RECEIVER MAC ADDRESS =========================
-// IMPORTANT: Replace with your receiver's MAC address from Serial Monitor
-uint8_t receiverMacAddress[] = {0x24, 0x6F, 0x28, 0x12, 0x34, 0x56};
-
-// ========================= ESP-NOW DATA STRUCTURE =========================
-// Must match the receiver structure exactly
-typedef struct struct_message
+#include "espnow_manager.h"
+#include "espnow_message.h"
+#include "boot_profiler.h"
+#include "power_manager.h"
+#include "serial_bridge.h"
+#include "link_monitor.h"
+#include "traffic_capture.h"
+#include "telemetry_log.h"
+#include "led_controller.h"
+#include "time_sync.h"
+#include "espnow_pairing.h"
+#include "frame_scheduler.h"
+#include "loop_scheduler.h"
+#include "button_input.h"
+#include "trace_recorder.h"
+
+// ========================= RECEIVER MAC ADDRESSES =========================
+// Only used with PAIRING_ENABLED 0, or until pairing has found the receiver.
+// Replace with your receivers' MAC addresses from Serial Monitor then.
+// Ignored when ESPNOW_BROADCAST is enabled.
+const uint8_t receiverMacAddresses[][6] = {
+  {0x24, 0x6F, 0x28, 0x12, 0x34, 0x56},
+};
+
+// Touch and telemetry frames received from other pads, handed from the WiFi task to loop()
+struct ReceivedFrame
 {
-  char clientId[32];
-  int touchValue;
-  float batteryPercent;
-} struct_message;
-
-struct_message sensorData;
-esp_now_peer_info_t peerInfo;
+  uint8_t mac[6];
+  uint8_t length;
+  uint8_t data[ESPNOW_MAX_FRAME_SIZE];
+};
+QueueHandle_t receivedFrames = nullptr;
 
 // ========================= GLOBAL OBJECTS =========================
 SensorManager sensorManager;
@@ -36,7 +52,18 @@ AsyncWebServer server(WEB_SERVER_PORT);
 WiFiManager wifiManager;
 ClientConfig clientConfig;
 ClientIdentity clientIdentity(&clientConfig);
-WebHandlers webHandlers(&server, &sensorManager, &clientIdentity);
+LinkMonitor linkMonitor;
+TrafficCapture trafficCapture;
+TelemetryLog telemetryLog;
+LEDController ledController;
+TimeSync timeSync;
+EspNowPairing pairing;
+FrameScheduler frameScheduler;
+WebHandlers webHandlers(&server, &sensorManager, &clientIdentity, &linkMonitor, &trafficCapture, &telemetryLog, &timeSync);
+EspNowManager espNow(receiverMacAddresses, sizeof(receiverMacAddresses) / sizeof(receiverMacAddresses[0]), ESPNOW_BROADCAST);
+PowerManager powerManager;
+SerialBridge serialBridge;
+ButtonInput buttons;
 
 // Display object
 U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, /* reset=*/U8X8_PIN_NONE, /* clock=*/22, /* data=*/21);
@@ -45,178 +72,537 @@ U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, /* reset=*/U8X8_PIN_NONE, /* c
 #define BTN_INC_PIN 4
 #define BTN_DEC_PIN 15
 
-// ========================= BUTTON VARIABLES =========================
-int buttonStateInc = LOW;
-int lastButtonStateInc = LOW;
-unsigned long lastDebounceTimeInc = 0;
+// ========================= SCHEDULER =========================
+// Everything loop() does on a timer runs as a job, see the SCHEDULED JOBS section
+LoopScheduler scheduler;
+int heartbeatJobId = -1;
+int displayJobId = -1;
 
-int buttonStateDec = LOW;
-int lastButtonStateDec = LOW;
-unsigned long lastDebounceTimeDec = 0;
+// ========================= BUTTON HANDLER =========================
+// Increment/decrement step the client ID on press and keep stepping while
+// held. The ID goes to NVS once, on release.
+void handleButtonEvents()
+{
+  ButtonEvent event;
+  while (buttons.poll(event))
+  {
+    powerManager.notifyActivity();
 
-const unsigned long debounceDelay = 50;
+    if (event.type == BUTTON_RELEASE)
+    {
+      clientIdentity.save();
+      continue;
+    }
 
-// ========================= TIMING VARIABLES =========================
-unsigned long previousMillis_Buttons = 0;
-const long interval_Buttons = 200;
+    int direction = event.button == 0 ? +1 : -1;
+    int id = constrain(clientIdentity.get() + direction, 0, 15);
+    if (id == clientIdentity.get())
+      continue;
+    clientIdentity.preview(id);
+    Serial.printf("[BUTTON] Client ID %s to %d\n", (direction > 0 ? "increased" : "decreased"), id);
+  }
+}
 
-unsigned long previousMillis_Display = 0;
-const long interval_Display = 500;
+// ========================= SEND DATA VIA ESP-NOW =========================
+// Touch state as last sent, a change goes out right away (see touchJob())
+uint16_t sentTouchMask = 0;
 
-unsigned long previousMillis_Send = 0;
-const long interval_Send = 500; // Send every 500ms via ESP-NOW
+void sendTouchFrame()
+{
+  TRACE_SCOPE("espnow touch");
+  int touchValue = sensorManager.getLocalTouchValue();
+  uint16_t touchMask = sensorManager.getLocalTouchMask();
+  sentTouchMask = touchMask;
 
-// ========================= BUTTON HANDLER =========================
-void handleButton(int &lastState, int &buttonState, unsigned long &lastTime, int pin, int direction)
+  // A short tap that woke us from deep sleep may already be released: report it anyway
+  static bool wakeTouchPending = powerManager.wokeByTouch();
+  if (wakeTouchPending)
+  {
+    touchValue = 1;
+    touchMask |= 1; // Channel 0 is the wake pad
+    wakeTouchPending = false;
+  }
+  if (touchValue)
+  {
+    powerManager.notifyActivity();
+  }
+
+  struct_touch_frame frame = {};
+  frame.header.type = ESPNOW_TYPE_TOUCH;
+  frame.header.clientId = (uint8_t)clientIdentity.get();
+  frame.header.boot = powerManager.getBootId();
+  frame.header.flags = timeSync.isSynced() ? ESPNOW_FLAG_TIME_SYNCED : 0;
+  frame.touchChangedUs = (uint32_t)timeSync.toSyncedUs(sensorManager.getLocalTouchChangedUs());
+  frame.touchMask = touchMask;
+  unsigned long gestureAge = millis() - sensorManager.getLocalGestureAtMs();
+  frame.gestureAgeMs = gestureAge > 0xFFFF ? 0xFFFF : (uint16_t)gestureAge;
+  frame.syncErrorUs = timeSync.getSyncErrorUs();
+  frame.touchValue = touchValue ? 1 : 0;
+  frame.gesture = sensorManager.getLocalGesture();
+  frame.gestureCount = sensorManager.getLocalGestureCount();
+  frame.touchChannels = sensorManager.getTouchChannelCount();
+
+  // Sequence number and capture are taken when the frame goes to the radio
+  frameScheduler.queueTouch(frame);
+  Serial.printf("[ESP-NOW] Touch - ID: %d, Touch: %d\n", frame.header.clientId, frame.touchValue);
+}
+
+void sendTelemetryFrame()
 {
-  int reading = digitalRead(pin);
+  TRACE_SCOPE("espnow telemetry");
+  struct_telemetry_frame frame = {};
+  frame.header.type = ESPNOW_TYPE_TELEMETRY;
+  frame.header.clientId = (uint8_t)clientIdentity.get();
+  frame.header.boot = powerManager.getBootId();
+  frame.header.flags = TOUCH_SEND_RAW ? ESPNOW_FLAG_TOUCH_RAW : 0;
+  frame.batteryPercent = sensorManager.getLocalBatteryPercent();
+  frame.touchChannels = sensorManager.getTouchChannelCount();
+  for (uint8_t i = 0; i < frame.touchChannels; i++)
+  {
+    uint32_t raw = sensorManager.getLocalTouchRaw(i);
+    frame.touchRaw[i] = raw > 0xFFFF ? 0xFFFF : (uint16_t)raw;
+  }
+
+  frameScheduler.queueTelemetry(frame);
+  Serial.printf("[ESP-NOW] Telemetry - ID: %d, Battery: %.1f%%\n", frame.header.clientId, frame.batteryPercent);
+}
+
+// ========================= RECEIVE DATA VIA ESP-NOW =========================
+// Runs on the WiFi task: copy and queue only
+void onEspNowReceive(const uint8_t *mac, const uint8_t *data, int len)
+{
+  // Arrival time for beacons, before anything else delays it
+  int64_t rxUs = esp_timer_get_time();
+
+  // Captured before validation so malformed frames can be replayed too
+  trafficCapture.record(CAPTURE_KIND_RX, mac, data, len);
 
-  if (reading != lastState)
+  if (len <= 0)
+    return;
+
+  if (data[0] == ESPNOW_TYPE_TOUCH || data[0] == ESPNOW_TYPE_TELEMETRY)
   {
-    lastTime = millis();
+    if (len < (int)sizeof(espnow_header) || len > (int)ESPNOW_MAX_FRAME_SIZE || receivedFrames == nullptr)
+      return;
+
+    ReceivedFrame frame;
+    memcpy(frame.mac, mac, sizeof(frame.mac));
+    frame.length = len;
+    memset(frame.data, 0, sizeof(frame.data));
+    memcpy(frame.data, data, len);
+    xQueueSend(receivedFrames, &frame, 0);
+    return;
   }
 
-  if ((millis() - lastTime) > debounceDelay)
+  // Control frames
+  if (len == (int)sizeof(struct_pair_message))
   {
-    if (reading != buttonState)
-    {
-      buttonState = reading;
-
-      if (buttonState == HIGH)
-      {
-        int id = clientIdentity.get();
-        id += direction;
-        id = constrain(id, 0, 15);
-        clientIdentity.set(id);
-        Serial.printf("[BUTTON] Client ID %s to %d\n", (direction > 0 ? "increased" : "decreased"), id);
-      }
-    }
+    struct_pair_message message;
+    memcpy(&message, data, sizeof(message));
+    pairing.onMessage(mac, message);
+    return;
   }
 
-  lastState = reading;
+  if (len == (int)sizeof(struct_time_beacon))
+  {
+    struct_time_beacon beacon;
+    memcpy(&beacon, data, sizeof(beacon));
+    if (beacon.magic == ESPNOW_BEACON_MAGIC)
+      timeSync.onBeacon(mac, beacon, rxUs);
+  }
 }
 
-// ========================= ESP-NOW CALLBACK =========================
-void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status)
+// The same frame may arrive through several receivers/relays, so both the
+// duplicate check and the store are keyed by the pad's ID, not the radio address
+void storeTouchFrame(const struct_touch_frame &frame)
 {
-  Serial.print("Last Packet Send Status: ");
-  Serial.println(status == ESP_NOW_SEND_SUCCESS ? "Delivery Success" : "Delivery Fail");
+  String clientId(frame.header.clientId);
+  if (frame.touchChannels > ESPNOW_MAX_TOUCH_CHANNELS || !sensorManager.acceptSequence(clientId, frame.header.boot, frame.header.sequence))
+    return;
+
+  String key = "espnow-" + clientId;
+  sensorManager.updateTouch(key, clientId, frame.touchValue);
+  sensorManager.updateGesture(key, frame.gesture, frame.gestureCount, frame.gestureAgeMs);
+  sensorManager.updateTouchChannels(key, frame.touchMask, frame.touchChannels);
+
+  // The frame carries the low 32 bits, the change happened before now on the same timebase
+  uint64_t touchChangedUs = 0;
+  if ((frame.header.flags & ESPNOW_FLAG_TIME_SYNCED) && timeSync.isSynced())
+  {
+    uint64_t nowUs = (uint64_t)timeSync.nowUs();
+    touchChangedUs = nowUs - (uint32_t)((uint32_t)nowUs - frame.touchChangedUs);
+  }
+  sensorManager.updateTouchTime(key, touchChangedUs, frame.syncErrorUs);
 }
 
-// ========================= SEND DATA VIA ESP-NOW =========================
-void sendSensorDataViaESPNOW()
+void storeTelemetryFrame(const struct_telemetry_frame &frame)
 {
-  // Get sensor readings
-  int touchValue = sensorManager.getLocalTouchValue();
-  float batteryPercent = sensorManager.getLocalBatteryPercent();
-  int clientId = clientIdentity.get();
+  String clientId(frame.header.clientId);
+  if (frame.touchChannels > ESPNOW_MAX_TOUCH_CHANNELS || !sensorManager.acceptSequence(clientId, frame.header.boot, frame.header.sequence))
+    return;
 
-  // Prepare data structure
-  snprintf(sensorData.clientId, sizeof(sensorData.clientId), "%d", clientId);
-  sensorData.touchValue = touchValue;
-  sensorData.batteryPercent = batteryPercent;
+  String key = "espnow-" + clientId;
+  sensorManager.updateBattery(key, clientId, frame.batteryPercent);
+  sensorManager.updateTouchRaw(key, frame.touchRaw, (frame.header.flags & ESPNOW_FLAG_TOUCH_RAW) ? frame.touchChannels : 0);
+}
+
+void processReceivedFrames()
+{
+  ReceivedFrame frame;
+  while (xQueueReceive(receivedFrames, &frame, 0) == pdTRUE)
+  {
+    // Dispatch by type; the length must agree with it, raw values are optional
+    if (frame.data[0] == ESPNOW_TYPE_TOUCH)
+    {
+      struct_touch_frame touch;
+      if (frame.length != sizeof(touch))
+        continue;
+      memcpy(&touch, frame.data, sizeof(touch));
+      storeTouchFrame(touch);
+    }
+    else
+    {
+      struct_telemetry_frame telemetry;
+      memcpy(&telemetry, frame.data, sizeof(telemetry));
+      if (frame.length < ESPNOW_TELEMETRY_MIN_SIZE || frame.length != espNowTelemetrySize(telemetry))
+        continue;
+      storeTelemetryFrame(telemetry);
+    }
+  }
+}
+
+// ========================= DISPLAY =========================
+bool displayReady = false;
+bool displayBlanked = false;
 
-  // Send via ESP-NOW
-  esp_err_t result = esp_now_send(receiverMacAddress, (uint8_t *)&sensorData, sizeof(sensorData));
+void updateDisplay()
+{
+  if (!displayReady)
+  {
+    int stage = BootProfiler::begin("display_init");
+    u8g2.begin();
+    BootProfiler::end(stage);
+    displayReady = true;
+  }
+
+  bool idle = powerManager.isEnabled() && powerManager.isIdleFor(DISPLAY_IDLE_TIMEOUT);
+  if (idle != displayBlanked)
+  {
+    u8g2.setPowerSave(idle ? 1 : 0);
+    displayBlanked = idle;
+  }
+  if (displayBlanked)
+  {
+    return;
+  }
 
-  if (result == ESP_OK)
+  TRACE_SCOPE("display redraw");
+  u8g2.clearBuffer();
+  u8g2.setFont(u8g2_font_ncenB08_tr);
+  u8g2.drawStr(5, 10, "SomniaSolutions");
+
+  // Get sensor data for display
+  int displayId = clientIdentity.get();
+  int displayTouch = sensorManager.getLocalTouchValue();
+  float displayBatteryPercent = sensorManager.getLocalBatteryPercent();
+
+  // ID
+  u8g2.drawStr(5, 25, "ID: ");
+  u8g2.setCursor(25, 25);
+  u8g2.print(displayId);
+
+  // Touch State, one digit per channel when several are scanned
+  u8g2.drawStr(5, 40, "State: ");
+  u8g2.setCursor(36, 40);
+  uint8_t channels = sensorManager.getTouchChannelCount();
+  if (channels > 1)
   {
-    Serial.printf("[ESP-NOW] Sent - ID: %d, Touch: %d, Battery: %.1f%%\n",
-                  clientId, touchValue, batteryPercent);
+    uint16_t mask = sensorManager.getLocalTouchMask();
+    for (uint8_t i = 0; i < channels; i++)
+      u8g2.print((mask >> i) & 1);
   }
   else
   {
-    Serial.println("[ESP-NOW] Error sending data");
+    u8g2.print(displayTouch);
   }
+
+  // Battery Percentage
+  u8g2.drawStr(5, 55, "Battery: ");
+  u8g2.setCursor(50, 55);
+  u8g2.print(displayBatteryPercent, 1);
+  u8g2.print("%");
+
+  u8g2.sendBuffer();
 }
 
-// ========================= INITIALIZE ESP-NOW =========================
-bool initESPNOW()
+// ========================= STATUS LEDS =========================
+// Only sets the wanted state; the controller renders and sends changed frames
+void updateLeds()
 {
-  // Initialize ESP-NOW
-  if (esp_now_init() != ESP_OK)
+  if (displayBlanked)
   {
-    Serial.println("Error initializing ESP-NOW");
-    return false;
+    ledController.setColor(0, 0, 0);
+  }
+  else
+  {
+    if (sensorManager.getLocalTouchValue())
+      ledController.setSensorIndicator(1);
+    else if (wifiManager.isConnected())
+      ledController.setConnectedIndicator();
+    else if (wifiManager.isConnecting())
+      ledController.setConnectingIndicator();
+    else if (powerManager.isEnabled())
+      ledController.setPixel(LED_STATUS_PIXEL, 0); // ESP-NOW only, no WiFi status to show
+    else
+      ledController.setDisconnectedIndicator();
+
+#if NUM_PIXELS > LED_PAD_PIXEL_OFFSET
+    bool padSeen[NUM_PIXELS - LED_PAD_PIXEL_OFFSET] = {false};
+    for (const auto &pair : sensorManager.getAllSensorData())
+    {
+      int padId = pair.second.clientId.toInt();
+      ledController.setPadState(padId, true, pair.second.touchValue);
+      if (padId >= 0 && padId < NUM_PIXELS - LED_PAD_PIXEL_OFFSET)
+        padSeen[padId] = true;
+    }
+    for (int padId = 0; padId < NUM_PIXELS - LED_PAD_PIXEL_OFFSET; padId++)
+    {
+      if (!padSeen[padId])
+        ledController.setPadState(padId, false, false);
+    }
+#endif
   }
 
-  Serial.println("ESP-NOW initialized successfully");
+  ledController.handle();
+}
 
-  // Register send callback
-  esp_now_register_send_cb(OnDataSent);
+// ========================= DEFERRED INITIALIZATION =========================
+// Filesystem and web server are not needed to sample and send, so they are
+// brought up after the first frame instead of delaying it.
+volatile bool filesystemReady = false;
+bool webServerStarted = false;
 
-  // Register peer (receiver)
-  memcpy(peerInfo.peer_addr, receiverMacAddress, 6);
-  peerInfo.channel = 0;
-  peerInfo.encrypt = false;
+void deferredInitTask(void *parameter)
+{
+  int stage = BootProfiler::begin("spiffs_mount");
+  bool mounted = FilesystemUtils::initSPIFFS();
+  BootProfiler::end(stage);
 
-  // Add peer
-  if (esp_now_add_peer(&peerInfo) != ESP_OK)
+  if (mounted)
   {
-    Serial.println("Failed to add peer");
-    return false;
+    stage = BootProfiler::begin("spiffs_check");
+    FilesystemUtils::checkIndexFile();
+    FilesystemUtils::listFiles();
+    BootProfiler::end(stage);
+
+#if TELEMETRY_ENABLED
+    stage = BootProfiler::begin("telemetry_recover");
+    telemetryLog.begin();
+    BootProfiler::end(stage);
+#endif
+  }
+  else
+  {
+    Serial.println("ERROR: Failed to initialize SPIFFS, web pages will be unavailable");
   }
 
-  Serial.println("Peer (receiver) added successfully");
-  Serial.print("Sending ESP-NOW data to: ");
-  for (int i = 0; i < 6; i++)
+  filesystemReady = true;
+#if CAPTURE_AUTOSTART == 1
+  if (mounted)
   {
-    Serial.printf("%02X", receiverMacAddress[i]);
-    if (i < 5)
-      Serial.print(":");
+    trafficCapture.requestStart(TrafficCapture::SINK_SPIFFS);
   }
-  Serial.println("\n");
+#endif
+  vTaskDelete(nullptr);
+}
 
-  return true;
+void startWebServer()
+{
+  int stage = BootProfiler::begin("web_server");
+  webHandlers.setupRoutes();
+  server.begin();
+  BootProfiler::end(stage);
+
+  webServerStarted = true;
+  Serial.println("Web Interface: View local sensor data and configure device");
+  BootProfiler::printReport();
 }
 
 // ========================= INITIALIZE SYSTEM =========================
 bool initializeSystem()
 {
+#if SERIAL_BRIDGE_ENABLED
+  Serial.setTxBufferSize(1024);
+  Serial.begin(SERIAL_BRIDGE_BAUD);
+  serialBridge.begin(&Serial, &sensorManager, SERIAL_BRIDGE_INTERVAL, SERIAL_BRIDGE_MIN_SLOTS);
+#else
   Serial.begin(115200);
+#endif
   Serial.println("\n=== ESP32-S3 Sender (ESP-NOW + Web Server) Starting ===");
+  trafficCapture.begin(&Serial);
+#if CAPTURE_REPLAY_INPUT
+  trafficCapture.setInjectHandler(onEspNowReceive);
+#endif
+#if CAPTURE_AUTOSTART == 2
+  trafficCapture.requestStart(TrafficCapture::SINK_SERIAL);
+#endif
+  BootProfiler::milestone("setup_entered");
+
+  powerManager.begin(POWER_SAVE_MODE, TOUCH_PIN, BTN_INC_PIN, BTN_DEC_PIN);
+  if (powerManager.wokeFromDeepSleep())
+  {
+    powerManager.printStats();
+  }
 
   // Initialize client identity
-  clientIdentity.begin();
+  int stage = BootProfiler::begin("identity_sensors");
+  int rtcClientId;
+  if (powerManager.restoreClientId(rtcClientId))
+    clientIdentity.begin(rtcClientId);
+  else
+    clientIdentity.begin();
   sensorManager.begin(&clientIdentity);
-  Serial.printf("Client ID: %d\n", clientIdentity.get());
-
-  // Initialize filesystem
-  if (!FilesystemUtils::initSPIFFS())
+  if (!ledController.init())
   {
-    Serial.println("ERROR: Failed to initialize SPIFFS");
-    return false;
+    Serial.println("ERROR: LED strip initialization failed, running without status LEDs");
   }
+  BootProfiler::end(stage);
+  Serial.printf("Client ID: %d\n", clientIdentity.get());
 
-  FilesystemUtils::listFiles();
-  FilesystemUtils::checkIndexFile();
-
-  // Initialize WiFi (connects to network)
-  if (!wifiManager.init())
+  // Initialize WiFi (connection completes in the background)
+  stage = BootProfiler::begin("wifi_start");
+  bool wifiStarted = true;
+  if (powerManager.isEnabled())
+    WiFi.mode(WIFI_STA); // Radio for ESP-NOW only, never associates
+  else
+    wifiStarted = wifiManager.init();
+  BootProfiler::end(stage);
+  if (!wifiStarted)
   {
     Serial.println("ERROR: WiFi initialization failed");
     return false;
   }
 
-  // Initialize ESP-NOW after WiFi
-  if (!initESPNOW())
+  // Initialize ESP-NOW after WiFi, on the last known AP channel
+  stage = BootProfiler::begin("espnow_init");
+  int32_t espNowChannel = wifiManager.getCachedChannel();
+  bool espNowStarted = espNow.init(espNowChannel > 0 ? (uint8_t)espNowChannel : ESPNOW_DEFAULT_CHANNEL);
+  BootProfiler::end(stage);
+  if (!espNowStarted)
   {
     Serial.println("ERROR: ESP-NOW initialization failed");
     return false;
   }
-
-  // Setup web server
-  webHandlers.setupRoutes();
-  server.begin();
+  receivedFrames = xQueueCreate(ESPNOW_RX_QUEUE_LENGTH, sizeof(ReceivedFrame));
+  espNow.setReceiveHandler(onEspNowReceive);
+  espNow.setLinkMonitor(&linkMonitor);
+  frameScheduler.begin(&espNow, []() { return powerManager.nextSequence(); }, &trafficCapture);
+  linkMonitor.begin(ESPNOW_RATE_ADAPTIVE, ESPNOW_ALLOW_LONG_RANGE);
+#if PAIRING_ENABLED
+  pairing.begin(&espNow, &clientIdentity, PAIRING_RECEIVER, PAIRING_ASSIGN_IDS);
+#endif
+#if TIME_SYNC_ENABLED
+  timeSync.begin(&espNow, TIME_SYNC_MASTER);
+#endif
 
   Serial.println("=== System initialized successfully ===");
-  Serial.printf("Web server running on: http://%s\n", WiFi.localIP().toString().c_str());
-  Serial.println("ESP-NOW: Sending sensor data to receiver");
-  Serial.println("Web Interface: View local sensor data and configure device");
+  if (powerManager.isEnabled())
+  {
+    Serial.printf("Setup took %lu ms, power save mode: web server and OTA disabled\n", millis());
+  }
+  else
+  {
+    // Filesystem (possibly formatting) runs in the background
+    xTaskCreatePinnedToCore(deferredInitTask, "deferredInit", 4096, nullptr, 1, nullptr, 0);
+    Serial.printf("Setup took %lu ms, web server will be reachable once WiFi connects\n", millis());
+  }
+  Serial.println("ESP-NOW: Sending touch and telemetry frames to receiver");
 
   return true;
 }
 
+// ========================= SCHEDULED JOBS =========================
+// Sample the touch channel at a high rate so the filter can debounce it
+void touchJob()
+{
+  sensorManager.sampleTouch();
+  sensorManager.pollBattery();
+  telemetryLog.update(sensorManager.getLocalTouchValue(), (uint16_t)(sensorManager.getLocalBatteryPercent() * 10.0f + 0.5f));
+
+  // Gestures and touch changes go out right away instead of waiting for the heartbeat
+  bool gesture = sensorManager.takeGesture();
+  if (gesture)
+    Serial.printf("[GESTURE] Local %s\n", gestureName(sensorManager.getLocalGesture()));
+  if (gesture || sensorManager.getLocalTouchMask() != sentTouchMask)
+  {
+    sendTouchFrame();
+    scheduler.restart(heartbeatJobId);
+  }
+}
+
+// Touch state via ESP-NOW (not HTTP anymore!) while nothing changes, WiFi association not required
+void heartbeatJob()
+{
+  static bool firstFrameSent = false;
+  sendTouchFrame();
+  if (!firstFrameSent)
+  {
+    BootProfiler::milestone("first_frame");
+    firstFrameSent = true;
+  }
+}
+
+// The web server task only ever sees this copy of the store
+void snapshotJob()
+{
+  sensorManager.publishSnapshot();
+}
+
+// Battery and raw touch values, sent when the radio has nothing more urgent to do
+void telemetryJob()
+{
+  sendTelemetryFrame();
+}
+
+void clientStatsJob()
+{
+  if (sensorManager.hasSensorData())
+    sensorManager.printClientStats();
+}
+
+// Update display (blanked while idle in power save mode)
+void displayJob()
+{
+  updateDisplay();
+  // A blanked display has nothing to redraw, no reason to wake up for it
+  scheduler.setWakeup(displayJobId, !displayBlanked);
+}
+
+void schedulerStatsJob()
+{
+  scheduler.printStats();
+  scheduler.resetStats();
+  buttons.printStats();
+  frameScheduler.printStats();
+  frameScheduler.resetStats();
+}
+
+void setupScheduler()
+{
+  scheduler.begin(SCHEDULER_LOOP_BUDGET_US, SCHEDULER_LATE_MS);
+
+  // Priority 0 always runs; the others give way once a loop() used its budget.
+  // The phases keep the 500 ms jobs out of the same iteration.
+  scheduler.addPeriodic("touch", touchJob, TOUCH_SAMPLE_INTERVAL, 0, 2000);
+  // First frame on the first loop iteration (the display is initialized after it, see updateDisplay())
+  heartbeatJobId = scheduler.addPeriodic("heartbeat", heartbeatJob, ESPNOW_TOUCH_HEARTBEAT, 1, 3000);
+  scheduler.addPeriodic("telemetry", telemetryJob, ESPNOW_TELEMETRY_INTERVAL, 2, 3000, 100);
+  scheduler.addPeriodic("snapshot", snapshotJob, SENSOR_SNAPSHOT_INTERVAL, 2, 2000, 3);
+  scheduler.addPeriodic("stats", clientStatsJob, CLIENT_STATS_INTERVAL, 3, 0, CLIENT_STATS_INTERVAL);
+  displayJobId = scheduler.addPeriodic("display", displayJob, 500, 3, 30000, 250);
+  scheduler.addPeriodic("sched", schedulerStatsJob, SCHEDULER_STATS_INTERVAL, 3, 0, SCHEDULER_STATS_INTERVAL);
+}
+
 // ========================= SETUP =========================
 void setup()
 {
@@ -227,72 +613,80 @@ void setup()
       delay(1000);
   }
 
-  // Initialize pins
-  pinMode(BTN_INC_PIN, INPUT_PULLUP);
-  pinMode(BTN_DEC_PIN, INPUT_PULLUP);
+  // Client ID buttons, index 0 increments, 1 decrements
+  const uint8_t buttonPins[] = {BTN_INC_PIN, BTN_DEC_PIN};
+  if (!buttons.begin(buttonPins, 2, BUTTON_DEBOUNCE_MS, BUTTON_LONG_PRESS_MS, BUTTON_REPEAT_MS, BUTTON_EVENT_QUEUE_LENGTH))
+  {
+    Serial.println("ERROR: Button initialization failed");
+  }
+
+  setupScheduler();
 
-  // Initialize display
-  u8g2.begin();
+  // Trace points in loop() show up under this thread name, see /trace/download
+  TraceRecorder::nameTask("loop");
+#if TRACE_ENABLED && TRACE_AUTOSTART
+  TraceRecorder::start();
+#endif
 }
 
 // ========================= LOOP =========================
 void loop()
 {
-  unsigned long currentMillis = millis();
-
   // Handle WiFi connection and OTA
   wifiManager.handleConnection();
 
-  // Handle button inputs
-  if (currentMillis - previousMillis_Buttons >= interval_Buttons)
+  // Bring up the web server once the filesystem is mounted
+  if (filesystemReady && !webServerStarted)
   {
-    handleButton(lastButtonStateInc, buttonStateInc, lastDebounceTimeInc, BTN_INC_PIN, +1);
-    handleButton(lastButtonStateDec, buttonStateDec, lastDebounceTimeDec, BTN_DEC_PIN, -1);
-    previousMillis_Buttons = currentMillis;
+    startWebServer();
   }
 
-  // Send sensor data via ESP-NOW (not HTTP anymore!)
-  if (wifiManager.isConnected())
-  {
-    if (currentMillis - previousMillis_Send >= interval_Send)
-    {
-      sendSensorDataViaESPNOW();
-      previousMillis_Send = currentMillis;
-    }
-  }
+  // Keep ESP-NOW on the right channel whatever the station is doing
+  espNow.handle(wifiManager.isConnected(), wifiManager.isConnecting());
+  pairing.handle(wifiManager.isConnected(), wifiManager.isConnecting());
+  frameScheduler.handle();
+  linkMonitor.handle();
+  timeSync.handle();
 
-  // Update display
-  if (currentMillis - previousMillis_Display >= interval_Display)
-  {
-    u8g2.clearBuffer();
-    u8g2.setFont(u8g2_font_ncenB08_tr);
-    u8g2.drawStr(5, 10, "SomniaSolutions");
-
-    // Get sensor data for display
-    int displayId = clientIdentity.get();
-    int displayTouch = sensorManager.getLocalTouchValue();
-    float displayBatteryPercent = sensorManager.getLocalBatteryPercent();
-
-    // ID
-    u8g2.drawStr(5, 25, "ID: ");
-    u8g2.setCursor(25, 25);
-    u8g2.print(displayId);
-
-    // Touch State
-    u8g2.drawStr(5, 40, "State: ");
-    u8g2.setCursor(36, 40);
-    u8g2.print(displayTouch);
+  // Button presses queued by the interrupt handlers
+  handleButtonEvents();
 
-    // Battery Percentage
-    u8g2.drawStr(5, 55, "Battery: ");
-    u8g2.setCursor(50, 55);
-    u8g2.print(displayBatteryPercent, 1);
-    u8g2.print("%");
+  // Feed frames from other pads and readings posted over HTTP into the sensor store, drop pads gone silent
+  processReceivedFrames();
+  sensorManager.processPostedReadings();
+  sensorManager.evictStaleClients(CLIENT_TTL);
 
-    u8g2.sendBuffer();
+  // Timed work: touch sampling, frames, snapshot, display, statistics
+  scheduler.run();
 
-    previousMillis_Display = currentMillis;
+#if SERIAL_BRIDGE_ENABLED
+  // Stream the sensor store to the host
+  serialBridge.handle();
+#endif
+
+  // Write captured frames out and take replayed ones in
+  trafficCapture.handle();
+
+  // Persist buffered history
+  telemetryLog.handle();
+
+  // Status and per-pad LEDs, rate limited inside the controller
+  updateLeds();
+
+  if (powerManager.isEnabled())
+  {
+    if (powerManager.isIdleFor(DEEP_SLEEP_TIMEOUT))
+    {
+      powerManager.saveClientId(clientIdentity.get());
+      u8g2.setPowerSave(1);
+      powerManager.enterDeepSleep(sensorManager.getTouchWakeThreshold());
+    }
+
+    // Sleep until the earliest job is due; touch and buttons wake us early.
+    // Never sleep with a frame still in the radio's queue or waiting for it, or while waiting for the receiver to answer.
+    if (!espNow.isSendPending() && !frameScheduler.hasWaitingFrames() && !pairing.isSweeping())
+      powerManager.sleepUntil(scheduler.getNextDeadline());
   }
 
   yield();
-}
\ No newline at end of file
+}
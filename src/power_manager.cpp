@@ -0,0 +1,197 @@
+#include "power_manager.h"
+#include <driver/rtc_io.h>
+#include <esp_wifi.h>
+#include "config.h"
+#include "trace_recorder.h"
+
+#define RTC_STATE_MAGIC 0x50414453 // "PADS"
+
+// Survives deep sleep, reset to defaults on power-on (magic mismatch)
+struct RtcState
+{
+    uint32_t magic;
+    int32_t clientId;
+    uint32_t sequence;
+    uint8_t bootId; // Tells receivers the sequence restarted
+    uint32_t wakeCount;
+    uint32_t awakeMsTotal;
+    uint32_t lightSleepMsTotal;
+};
+
+RTC_DATA_ATTR static RtcState rtcState;
+
+PowerManager::PowerManager()
+{
+    enabled = false;
+    touchPin = 0;
+    buttonPinA = 0;
+    buttonPinB = 0;
+    wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    rtcStateValid = false;
+    lastActivityMs = 0;
+    lightSleepMs = 0;
+    lightSleepCount = 0;
+    touchWakeThreshold = 0;
+}
+
+void PowerManager::begin(bool powerSaveEnabled, uint8_t touch, uint8_t buttonA, uint8_t buttonB)
+{
+    enabled = powerSaveEnabled;
+    touchPin = touch;
+    buttonPinA = buttonA;
+    buttonPinB = buttonB;
+    wakeCause = esp_sleep_get_wakeup_cause();
+
+    rtcStateValid = rtcState.magic == RTC_STATE_MAGIC && wakeCause != ESP_SLEEP_WAKEUP_UNDEFINED;
+    if (!rtcStateValid)
+    {
+        memset(&rtcState, 0, sizeof(rtcState));
+        rtcState.magic = RTC_STATE_MAGIC;
+        rtcState.clientId = -1;
+        rtcState.bootId = (uint8_t)esp_random();
+    }
+    rtcState.wakeCount++;
+
+    // Deep sleep held the RTC pins, hand them back to the digital GPIO matrix
+    if (rtcStateValid)
+    {
+#if !TOUCH_SENSE_CAPACITIVE
+        rtc_gpio_deinit((gpio_num_t)touchPin);
+#endif
+        rtc_gpio_deinit((gpio_num_t)buttonPinA);
+    }
+
+    // A touch or button wake counts as activity
+    lastActivityMs = millis();
+}
+
+bool PowerManager::wokeByTouch() const
+{
+#if TOUCH_SENSE_CAPACITIVE
+    return wakeCause == ESP_SLEEP_WAKEUP_TOUCHPAD;
+#else
+    return wakeCause == ESP_SLEEP_WAKEUP_EXT1;
+#endif
+}
+
+bool PowerManager::restoreClientId(int &clientId) const
+{
+    if (!rtcStateValid || rtcState.clientId < 0)
+        return false;
+    clientId = rtcState.clientId;
+    return true;
+}
+
+void PowerManager::saveClientId(int clientId)
+{
+    rtcState.clientId = clientId;
+}
+
+uint8_t PowerManager::getBootId() const
+{
+    return rtcState.bootId;
+}
+
+uint32_t PowerManager::nextSequence()
+{
+    return ++rtcState.sequence;
+}
+
+void PowerManager::notifyActivity()
+{
+    lastActivityMs = millis();
+}
+
+bool PowerManager::isIdleFor(unsigned long timeoutMs) const
+{
+    return millis() - lastActivityMs >= timeoutMs;
+}
+
+// A pin already at its active level (a held button) would end every light
+// sleep at once, so it wakes us on its release instead
+static void enableLevelWakeup(uint8_t pin, int activeLevel)
+{
+    int wakeLevel = digitalRead(pin) == activeLevel ? !activeLevel : activeLevel;
+    gpio_wakeup_enable((gpio_num_t)pin, wakeLevel == HIGH ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+}
+
+void PowerManager::enableWakeSources(bool deepSleep)
+{
+    if (deepSleep)
+    {
+        // ext0: one button (active low)
+        rtc_gpio_pullup_en((gpio_num_t)buttonPinA);
+        rtc_gpio_pulldown_dis((gpio_num_t)buttonPinA);
+        esp_sleep_enable_ext0_wakeup((gpio_num_t)buttonPinA, 0);
+#if TOUCH_SENSE_CAPACITIVE
+        // Touch FSM keeps measuring in deep sleep and wakes us past the threshold
+        touchAttachInterrupt(touchPin, []() {}, touchWakeThreshold);
+        esp_sleep_enable_touchpad_wakeup();
+#else
+        // ext1: touch module output (active high)
+        esp_sleep_enable_ext1_wakeup(1ULL << touchPin, ESP_EXT1_WAKEUP_ANY_HIGH);
+#endif
+    }
+    else
+    {
+        // Capacitive touch is sampled every TOUCH_SAMPLE_INTERVAL, so light
+        // sleeps are already shorter than a touch
+#if !TOUCH_SENSE_CAPACITIVE
+        enableLevelWakeup(touchPin, HIGH);
+#endif
+        enableLevelWakeup(buttonPinA, LOW);
+        enableLevelWakeup(buttonPinB, LOW);
+        esp_sleep_enable_gpio_wakeup();
+    }
+}
+
+void PowerManager::sleepUntil(unsigned long deadlineMs)
+{
+    if (!enabled)
+        return;
+
+    unsigned long now = millis();
+    long remaining = (long)(deadlineMs - now);
+    if (remaining < LIGHT_SLEEP_MIN_MS)
+        return;
+
+    Serial.flush();
+    esp_sleep_enable_timer_wakeup((uint64_t)remaining * 1000ULL);
+    enableWakeSources(false);
+    esp_light_sleep_start();
+    // The cycle counter did not run while asleep
+    TraceRecorder::resync();
+
+    // millis() keeps counting through light sleep
+    unsigned long slept = millis() - now;
+    lightSleepMs += slept;
+    lightSleepCount++;
+
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO)
+        notifyActivity();
+}
+
+void PowerManager::enterDeepSleep(uint32_t touchThreshold)
+{
+    touchWakeThreshold = touchThreshold;
+    unsigned long now = millis();
+    rtcState.awakeMsTotal += now - lightSleepMs;
+    rtcState.lightSleepMsTotal += lightSleepMs;
+
+    printStats();
+    Serial.println("[POWER] Entering deep sleep, wake on touch or button");
+    Serial.flush();
+
+    esp_wifi_stop();
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+    enableWakeSources(true);
+    esp_deep_sleep_start();
+}
+
+void PowerManager::printStats()
+{
+    unsigned long awakeNow = millis() - lightSleepMs;
+    Serial.printf("[POWER] Wake #%u (cause %d), awake %lu ms this cycle, %u ms total, light sleep %lu ms (%u sleeps)\n",
+                  rtcState.wakeCount, (int)wakeCause, awakeNow, rtcState.awakeMsTotal,
+                  lightSleepMs, lightSleepCount);
+}
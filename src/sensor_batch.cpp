@@ -0,0 +1,179 @@
+#include "sensor_batch.h"
+#include <stdlib.h>
+#include <string.h>
+
+SensorBatch::SensorBatch()
+    : lineLength(0), lineTooLong(false), clientCount(0), readingCount(0), accepted(0), rejected(0), dropped(0)
+{
+}
+
+void SensorBatch::feed(const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        char c = (char)data[i];
+        if (c == '\n')
+        {
+            if (lineTooLong)
+                rejected++;
+            else
+                parseLine();
+            lineLength = 0;
+            lineTooLong = false;
+        }
+        else if (c == '\r')
+        {
+            continue;
+        }
+        else if (lineLength < SENSOR_BATCH_MAX_LINE - 1)
+        {
+            line[lineLength++] = c;
+        }
+        else
+        {
+            lineTooLong = true;
+        }
+    }
+}
+
+void SensorBatch::finish()
+{
+    static const uint8_t newline = '\n';
+    if (lineLength > 0 || lineTooLong)
+        feed(&newline, 1);
+    compact();
+}
+
+void SensorBatch::compact()
+{
+    // Oldest first; insertion sort keeps line order for equal ages, the slots are few
+    for (uint8_t i = 1; i < readingCount; i++)
+    {
+        SensorBatchReading reading = readings[i];
+        uint8_t j = i;
+        while (j > 0 && readings[j - 1].ageMs < reading.ageMs)
+        {
+            readings[j] = readings[j - 1];
+            j--;
+        }
+        readings[j] = reading;
+    }
+
+    // A reading followed by a newer one of the same client and touch value adds nothing
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < readingCount; i++)
+    {
+        const SensorBatchReading &reading = readings[i];
+        bool superseded = false;
+        for (uint8_t j = i + 1; j < readingCount; j++)
+        {
+            if (readings[j].client == reading.client)
+            {
+                superseded = readings[j].touchValue == reading.touchValue;
+                break;
+            }
+        }
+        if (!superseded)
+            readings[kept++] = reading;
+    }
+    readingCount = kept;
+}
+
+void SensorBatch::parseLine()
+{
+    if (lineLength == 0)
+        return;
+    line[lineLength] = '\0';
+
+    // The ID ends up in the JSON API unescaped, so keep it to plain characters
+    char *field = line;
+    char *comma = strchr(field, ',');
+    size_t idLength = comma ? (size_t)(comma - field) : 0;
+    if (idLength == 0 || idLength >= sizeof(clientIds[0]))
+    {
+        rejected++;
+        return;
+    }
+    for (size_t i = 0; i < idLength; i++)
+    {
+        if (field[i] <= ' ' || field[i] == '"' || field[i] == '\\' || field[i] > '~')
+        {
+            rejected++;
+            return;
+        }
+    }
+
+    char *end;
+    unsigned long ageMs = strtoul(comma + 1, &end, 10);
+    if (end == comma + 1 || *end != ',')
+    {
+        rejected++;
+        return;
+    }
+    field = end + 1;
+    long touchValue = strtol(field, &end, 10);
+    if (end == field || (*end != ',' && *end != '\0'))
+    {
+        rejected++;
+        return;
+    }
+    float batteryPercent = 0.0f;
+    if (*end == ',')
+    {
+        field = end + 1;
+        batteryPercent = strtof(field, &end);
+        if (end == field || *end != '\0')
+        {
+            rejected++;
+            return;
+        }
+    }
+
+    uint8_t client = 0;
+    while (client < clientCount && (strncmp(clientIds[client], line, idLength) != 0 || clientIds[client][idLength] != '\0'))
+        client++;
+    if (client == clientCount)
+    {
+        if (clientCount >= SENSOR_BATCH_MAX_CLIENTS)
+        {
+            rejected++;
+            return;
+        }
+        memcpy(clientIds[client], line, idLength);
+        clientIds[client][idLength] = '\0';
+        clientCount++;
+    }
+
+    if (readingCount == SENSOR_BATCH_MAX_READINGS)
+    {
+        compact();
+        // Nothing left to fold, every slot is a touch change: the oldest one
+        // that is not its client's newest goes
+        if (readingCount == SENSOR_BATCH_MAX_READINGS)
+        {
+            uint8_t oldest = 0;
+            bool found = false;
+            while (oldest < readingCount && !found)
+            {
+                for (uint8_t j = oldest + 1; j < readingCount && !found; j++)
+                    found = readings[j].client == readings[oldest].client;
+                if (!found)
+                    oldest++;
+            }
+            if (!found)
+            {
+                rejected++;
+                return;
+            }
+            memmove(&readings[oldest], &readings[oldest + 1], (readingCount - oldest - 1) * sizeof(readings[0]));
+            readingCount--;
+            dropped++;
+        }
+    }
+    SensorBatchReading &reading = readings[readingCount++];
+    reading.ageMs = ageMs > UINT32_MAX ? UINT32_MAX : (uint32_t)ageMs;
+    reading.touchValue = (int32_t)touchValue;
+    reading.batteryPercent = batteryPercent;
+    reading.client = client;
+    accepted++;
+}
@@ -1,38 +1,418 @@
 #include "sensor_manager.h"
 #include <WiFi.h>
+#include <esp_timer.h>
+#include <memory>
+#include "config.h"
+#if TOUCH_SENSE_CAPACITIVE
+#include <driver/touch_pad.h>
+#endif
 
-#define TOUCH_PIN 13
-#define BATTERY_PIN 34
-#define TOUCH_THRESHOLD 40
-#define VCC 3.3f
-#define R1 100000.0f            // Adjust as per your voltage divider
-#define R2 10000.0f             // Adjust as per your voltage divider
-#define CALIBRATION_FACTOR 1.0f // Adjust as needed
+static const uint8_t TOUCH_PIN_LIST[] = {TOUCH_PINS};
+static_assert(sizeof(TOUCH_PIN_LIST) <= ESPNOW_MAX_TOUCH_CHANNELS, "Too many TOUCH_PINS");
 
-void SensorManager::updateSensorData(const String &senderIP, const String &clientId, int touchValue, float batteryPercent)
+// Where an entry last seen at lastSeenMs goes in ageOrder: after every entry
+// seen before it. Backdated readings are at most a batch old, so the walk
+// from the young end is short.
+std::list<String>::iterator SensorManager::ageOrderSlot(unsigned long now, unsigned long lastSeenMs)
 {
-    sensorDataMap[senderIP] = {clientId, touchValue, batteryPercent};
+    auto slot = ageOrder.end();
+    while (slot != ageOrder.begin())
+    {
+        auto it = sensorDataMap.find(*std::prev(slot));
+        if (it != sensorDataMap.end() && now - it->second.lastSeenMs >= now - lastSeenMs)
+            break;
+        slot--;
+    }
+    return slot;
+}
+
+void SensorManager::updateSensorData(const String &senderIP, const String &clientId, int touchValue, float batteryPercent, unsigned long ageMs)
+{
+    unsigned long now = millis();
+    auto it = sensorDataMap.find(senderIP);
+    if (it == sensorDataMap.end())
+    {
+        auto position = ageOrder.insert(ageOrderSlot(now, now - ageMs), senderIP);
+        sensorDataMap[senderIP] = {clientId, touchValue, batteryPercent, now - ageMs, position,
+                                   GESTURE_NONE, 0, 0, 0, (uint16_t)(touchValue ? 1 : 0), 1, 0, {0}, 0, 0xFFFF};
+        return;
+    }
+
+    SensorData &data = it->second;
+    if (now - data.lastSeenMs < ageMs)
+        return;
+    data.clientId = clientId;
+    data.touchValue = touchValue;
+    data.batteryPercent = batteryPercent;
+    data.lastSeenMs = now - ageMs;
+    // Only ever moves towards the young end, the entry itself stops the walk
+    ageOrder.splice(ageOrderSlot(now, data.lastSeenMs), ageOrder, data.agePosition);
+}
+
+SensorData &SensorManager::refreshClient(const String &senderIP, const String &clientId)
+{
+    auto it = sensorDataMap.find(senderIP);
+    if (it == sensorDataMap.end())
+    {
+        updateSensorData(senderIP, clientId, 0, 0.0f);
+        return sensorDataMap[senderIP];
+    }
+
+    SensorData &data = it->second;
+    data.clientId = clientId;
+    data.lastSeenMs = millis();
+    ageOrder.splice(ageOrder.end(), ageOrder, data.agePosition);
+    return data;
+}
+
+void SensorManager::updateTouch(const String &senderIP, const String &clientId, int touchValue)
+{
+    refreshClient(senderIP, clientId).touchValue = touchValue;
+}
+
+void SensorManager::updateBattery(const String &senderIP, const String &clientId, float batteryPercent)
+{
+    refreshClient(senderIP, clientId).batteryPercent = batteryPercent;
+}
+
+bool SensorManager::acceptSequence(const String &clientId, uint8_t boot, uint32_t sequence)
+{
+    LinkStats &stats = linkStats[clientId];
+
+    // A power-on or reset without RTC state starts the counter over from 1,
+    // whatever the window has seen: frames of the new boot are never too old
+    bool rebooted = stats.received > 0 && boot != stats.boot;
+    if (rebooted)
+    {
+        Serial.printf("[ESP-NOW] Client %s rebooted, sequence starts over at %u\n", clientId.c_str(), sequence);
+        stats.window.reset();
+    }
+    stats.boot = boot;
+
+    bool first = stats.received == 0 || rebooted;
+    uint32_t previousHighest = stats.window.getHighest();
+
+    switch (stats.window.check(sequence))
+    {
+    case SequenceWindow::DUPLICATE:
+        stats.duplicates++;
+        duplicateFrames++;
+        return false;
+    case SequenceWindow::TOO_OLD:
+        staleFrames++;
+        return false;
+    case SequenceWindow::RESTARTED:
+        Serial.printf("[ESP-NOW] Client %s restarted its sequence at %u\n", clientId.c_str(), sequence);
+        break;
+    default:
+        if (first)
+            break;
+        if (sequence > previousHighest)
+        {
+            stats.lost += sequence - previousHighest - 1;
+        }
+        else
+        {
+            // Late frame filling an earlier gap
+            stats.reordered++;
+            if (stats.lost > 0)
+                stats.lost--;
+        }
+        break;
+    }
+
+    // Inter-arrival jitter, smoothed like RTP (RFC 3550): J += (|D| - J) / 16
+    unsigned long now = millis();
+    if (stats.lastArrivalMs != 0)
+    {
+        unsigned long interval = now - stats.lastArrivalMs;
+        if (stats.lastIntervalMs != 0)
+        {
+            long difference = (long)interval - (long)stats.lastIntervalMs;
+            uint32_t deviationQ4 = (uint32_t)(difference < 0 ? -difference : difference) << 4;
+            stats.jitterQ4 = stats.jitterQ4 + deviationQ4 / 16 - stats.jitterQ4 / 16;
+        }
+        stats.lastIntervalMs = interval;
+    }
+    stats.lastArrivalMs = now;
+    stats.received++;
+    return true;
+}
+
+void SensorManager::updateGesture(const String &senderIP, uint8_t gesture, uint8_t gestureCount, uint16_t gestureAgeMs)
+{
+    auto it = sensorDataMap.find(senderIP);
+    if (it == sensorDataMap.end() || gesture == GESTURE_NONE)
+        return;
+
+    SensorData &data = it->second;
+    if (data.gesture != GESTURE_NONE && gestureCount == data.gestureCount)
+        return; // Same event repeated in a later frame
+
+    if (data.gesture != GESTURE_NONE)
+        data.missedGestures += (uint8_t)(gestureCount - data.gestureCount - 1);
+    data.gesture = gesture;
+    data.gestureCount = gestureCount;
+    data.gestureAtMs = millis() - gestureAgeMs;
+    Serial.printf("[GESTURE] %s id=%s %s (%u ms ago)\n", senderIP.c_str(), data.clientId.c_str(),
+                  gestureName(gesture), gestureAgeMs);
+}
+
+void SensorManager::updateTouchChannels(const String &senderIP, uint16_t mask, uint8_t channels)
+{
+    auto it = sensorDataMap.find(senderIP);
+    if (it == sensorDataMap.end())
+        return;
+
+    it->second.touchMask = mask;
+    it->second.touchChannels = channels;
+}
+
+void SensorManager::updateTouchRaw(const String &senderIP, const uint16_t *raw, uint8_t rawCount)
+{
+    auto it = sensorDataMap.find(senderIP);
+    if (it == sensorDataMap.end())
+        return;
+
+    SensorData &data = it->second;
+    data.rawCount = rawCount > ESPNOW_MAX_TOUCH_CHANNELS ? ESPNOW_MAX_TOUCH_CHANNELS : rawCount;
+    memcpy(data.touchRaw, raw, data.rawCount * sizeof(uint16_t));
+}
+
+void SensorManager::updateTouchTime(const String &senderIP, uint64_t touchChangedUs, uint16_t syncErrorUs)
+{
+    auto it = sensorDataMap.find(senderIP);
+    if (it == sensorDataMap.end())
+        return;
+
+    it->second.touchChangedUs = touchChangedUs;
+    it->second.syncErrorUs = syncErrorUs;
+}
+
+void SensorManager::evictStaleClients(unsigned long ttlMs)
+{
+    unsigned long now = millis();
+
+    // Oldest entries are at the front, stop at the first one still alive
+    while (!ageOrder.empty())
+    {
+        auto it = sensorDataMap.find(ageOrder.front());
+        if (it != sensorDataMap.end())
+        {
+            if (now - it->second.lastSeenMs < ttlMs)
+                break;
+            Serial.printf("[STORE] Client %s (%s) silent for %lu ms, evicted\n",
+                          it->second.clientId.c_str(), it->first.c_str(), now - it->second.lastSeenMs);
+            linkStats.erase(it->second.clientId);
+            sensorDataMap.erase(it);
+        }
+        ageOrder.pop_front();
+    }
+}
+
+void SensorManager::printClientStats() const
+{
+    unsigned long now = millis();
+    for (const auto &pair : sensorDataMap)
+    {
+        const SensorData &data = pair.second;
+        auto stats = linkStats.find(data.clientId);
+        if (stats == linkStats.end())
+        {
+            Serial.printf("[STATS] %s id=%s age=%lums\n", pair.first.c_str(), data.clientId.c_str(), now - data.lastSeenMs);
+            continue;
+        }
+        const LinkStats &link = stats->second;
+        uint32_t expected = link.received + link.lost;
+        Serial.printf("[STATS] %s id=%s age=%lums rx=%u lost=%u (%.1f%%) reorder=%u dup=%u jitter=%.1fms\n",
+                      pair.first.c_str(), data.clientId.c_str(), now - data.lastSeenMs,
+                      link.received, link.lost, expected ? link.lost * 100.0f / expected : 0.0f,
+                      link.reordered, link.duplicates, link.jitterQ4 / 16.0f);
+    }
 }
 
 String SensorManager::getSensorDataJSON() const
 {
+    std::unique_ptr<SensorSnapshot> state(new SensorSnapshot());
+    if (!readSnapshot(*state))
+        return String();
+
+    unsigned long now = millis();
     String json = "{";
-    bool first = true;
-    for (const auto &pair : sensorDataMap)
+    for (uint8_t i = 0; i < state->clientCount; i++)
     {
-        if (!first)
+        const ClientSnapshot &client = state->clients[i];
+        if (i > 0)
             json += ",";
-        json += "\"" + pair.first + "\":{";
-        json += "\"clientId\":\"" + pair.second.clientId + "\",";
-        json += "\"touch\":" + String(pair.second.touchValue) + ",";
-        json += "\"batteryPercent\":" + String(pair.second.batteryPercent, 1);
+        json += "\"" + String(client.key) + "\":{";
+        json += "\"clientId\":\"" + String(client.clientId) + "\",";
+        json += "\"touch\":" + String(client.touchValue) + ",";
+        json += "\"batteryPercent\":" + String(client.batteryPercent, 1) + ",";
+        json += "\"ageMs\":" + String(now - client.lastSeenMs);
+        if (client.touchChannels > 1)
+        {
+            json += ",\"touchMask\":" + String(client.touchMask);
+            json += ",\"channels\":" + String(client.touchChannels);
+        }
+        if (client.rawCount > 0)
+        {
+            json += ",\"raw\":[";
+            for (uint8_t j = 0; j < client.rawCount; j++)
+                json += (j ? "," : "") + String(client.touchRaw[j]);
+            json += "]";
+        }
+        if (client.gesture != GESTURE_NONE)
+        {
+            json += ",\"gesture\":\"" + String(gestureName(client.gesture)) + "\"";
+            json += ",\"gestureCount\":" + String(client.gestureCount);
+            json += ",\"gestureAgeMs\":" + String(now - client.gestureAtMs);
+            json += ",\"missedGestures\":" + String(client.missedGestures);
+        }
+        if (client.touchChangedUs != 0)
+        {
+            json += ",\"touchChangedUs\":" + String(client.touchChangedUs);
+            json += ",\"syncErrorUs\":" + String(client.syncErrorUs);
+        }
+        if (client.hasLinkStats)
+        {
+            uint32_t expected = client.received + client.lost;
+            json += ",\"received\":" + String(client.received);
+            json += ",\"lost\":" + String(client.lost);
+            json += ",\"lossPercent\":" + String(expected ? client.lost * 100.0f / expected : 0.0f, 1);
+            json += ",\"reordered\":" + String(client.reordered);
+            json += ",\"duplicates\":" + String(client.duplicates);
+            json += ",\"jitterMs\":" + String(client.jitterQ4 / 16.0f, 1);
+        }
         json += "}";
-        first = false;
     }
     json += "}";
     return json;
 }
 
+void SensorManager::publishSnapshot()
+{
+    SensorSnapshot &next = nextSnapshot;
+
+    next.touchMask = touchMask;
+    next.touchChannels = touchChannelCount;
+    next.gesture = localGesture;
+    next.batteryPercent = getLocalBatteryPercent();
+    next.touchConfig = touchFilters[0].getConfig();
+    next.gestureConfig = gestureDetector.getConfig();
+    for (uint8_t i = 0; i < touchChannelCount; i++)
+    {
+        TouchChannelSnapshot &channel = next.channels[i];
+        channel.pin = touchPins[i];
+        channel.touched = touchFilters[i].isTouched();
+        channel.raw = lastTouchRaw[i];
+        channel.filtered = touchFilters[i].getFiltered();
+        channel.baseline = touchFilters[i].getBaseline();
+        channel.delta = touchFilters[i].getDelta();
+    }
+
+    next.clientCount = 0;
+    next.omittedClients = 0;
+    for (const auto &pair : sensorDataMap)
+    {
+        if (next.clientCount >= SENSOR_SNAPSHOT_MAX_CLIENTS)
+        {
+            next.omittedClients++;
+            continue;
+        }
+        const SensorData &data = pair.second;
+        ClientSnapshot &client = next.clients[next.clientCount++];
+        snprintf(client.key, sizeof(client.key), "%s", pair.first.c_str());
+        snprintf(client.clientId, sizeof(client.clientId), "%s", data.clientId.c_str());
+        client.touchValue = data.touchValue;
+        client.batteryPercent = data.batteryPercent;
+        client.lastSeenMs = data.lastSeenMs;
+        client.gestureAtMs = data.gestureAtMs;
+        client.missedGestures = data.missedGestures;
+        client.gesture = data.gesture;
+        client.gestureCount = data.gestureCount;
+        client.touchMask = data.touchMask;
+        client.touchChannels = data.touchChannels;
+        client.rawCount = data.rawCount;
+        client.syncErrorUs = data.syncErrorUs;
+        memcpy(client.touchRaw, data.touchRaw, data.rawCount * sizeof(uint16_t));
+        client.touchChangedUs = data.touchChangedUs;
+
+        auto stats = linkStats.find(data.clientId);
+        client.hasLinkStats = stats != linkStats.end();
+        if (client.hasLinkStats)
+        {
+            const LinkStats &link = stats->second;
+            client.received = link.received;
+            client.lost = link.lost;
+            client.reordered = link.reordered;
+            client.duplicates = link.duplicates;
+            client.jitterQ4 = link.jitterQ4;
+        }
+    }
+
+    snapshot.publish(next);
+}
+
+bool SensorManager::readSnapshot(SensorSnapshot &out) const
+{
+    // A publish takes microseconds; repeated overlaps mean loop() was
+    // preempted mid-copy by this task, so give it a tick to finish
+    for (uint8_t attempt = 0; attempt < 3; attempt++)
+    {
+        if (snapshot.read(out))
+            return true;
+        delay(1);
+    }
+    return false;
+}
+
+bool SensorManager::postReading(const String &senderIP, const String &clientId, int touchValue, float batteryPercent, unsigned long ageMs)
+{
+    if (postedReadings == nullptr)
+        return false;
+    PostedReading reading;
+    snprintf(reading.senderIP, sizeof(reading.senderIP), "%s", senderIP.c_str());
+    snprintf(reading.clientId, sizeof(reading.clientId), "%s", clientId.c_str());
+    reading.touchValue = touchValue;
+    reading.batteryPercent = batteryPercent;
+    reading.ageMs = ageMs;
+    return xQueueSend(postedReadings, &reading, 0) == pdTRUE;
+}
+
+void SensorManager::processPostedReadings()
+{
+    if (postedReadings == nullptr)
+        return;
+    PostedReading reading;
+    while (xQueueReceive(postedReadings, &reading, 0) == pdTRUE)
+        updateSensorData(reading.senderIP, reading.clientId, reading.touchValue, reading.batteryPercent, reading.ageMs);
+
+    PostedConfig config;
+    while (postedConfigs != nullptr && xQueueReceive(postedConfigs, &config, 0) == pdTRUE)
+    {
+        setTouchConfig(config.touch);
+        setGestureConfig(config.gestures);
+    }
+}
+
+bool SensorManager::postConfig(const TouchFilterConfig &touch, const GestureConfig &gestures)
+{
+    if (postedConfigs == nullptr)
+        return false;
+    PostedConfig config = {touch, gestures};
+    return xQueueSend(postedConfigs, &config, 0) == pdTRUE;
+}
+
+bool SensorManager::readPublishedConfig(TouchFilterConfig &touch, GestureConfig &gestures) const
+{
+    std::unique_ptr<SensorSnapshot> state(new SensorSnapshot());
+    if (!readSnapshot(*state))
+        return false;
+    touch = state->touchConfig;
+    gestures = state->gestureConfig;
+    return true;
+}
+
 const std::map<String, SensorData> &SensorManager::getAllSensorData() const
 {
     return sensorDataMap;
@@ -41,6 +421,8 @@ const std::map<String, SensorData> &SensorManager::getAllSensorData() const
 void SensorManager::clearSensorData()
 {
     sensorDataMap.clear();
+    linkStats.clear();
+    ageOrder.clear();
 }
 
 bool SensorManager::hasSensorData() const
@@ -86,33 +468,189 @@ String SensorManager::getFormattedSensorData(int minSensors) const
     return result;
 }
 
+void SensorManager::beginTouchChannels()
+{
+    touchChannelCount = sizeof(TOUCH_PIN_LIST);
+    memcpy(touchPins, TOUCH_PIN_LIST, touchChannelCount);
+
+#if TOUCH_SENSE_CAPACITIVE
+    // The FSM scans every configured pad on its own timer; sampleTouch()
+    // only picks up the latest results, no CPU time is spent measuring
+    esp_err_t err = touch_pad_init();
+    if (err != ESP_OK)
+        Serial.printf("[TOUCH] touch_pad_init failed: %d\n", err);
+#if CONFIG_IDF_TARGET_ESP32
+    touch_pad_set_voltage(TOUCH_HVOLT_2V7, TOUCH_LVOLT_0V5, TOUCH_HVOLT_ATTEN_1V);
+    touch_pad_set_meas_time(TOUCH_FSM_SLEEP_CYCLES, TOUCH_FSM_MEAS_CYCLES);
+    for (uint8_t i = 0; i < touchChannelCount; i++)
+        touch_pad_config((touch_pad_t)digitalPinToTouchChannel(touchPins[i]), 0);
+    touch_pad_set_fsm_mode(TOUCH_FSM_MODE_TIMER);
+#else
+    for (uint8_t i = 0; i < touchChannelCount; i++)
+        touch_pad_config((touch_pad_t)digitalPinToTouchChannel(touchPins[i]));
+    touch_pad_set_fsm_mode(TOUCH_FSM_MODE_TIMER);
+    touch_pad_fsm_start();
+#endif
+#else
+    for (uint8_t i = 0; i < touchChannelCount; i++)
+        pinMode(touchPins[i], INPUT);
+#endif
+}
+
+void SensorManager::sampleTouch()
+{
+    uint16_t mask = 0;
+    for (uint8_t i = 0; i < touchChannelCount; i++)
+    {
+#if TOUCH_SENSE_CAPACITIVE
+#if CONFIG_IDF_TARGET_ESP32
+        // The ESP32's raw data is only filled in by the software filter task,
+        // touch_pad_read() takes the FSM's last measurement directly
+        uint16_t raw = 0;
+        esp_err_t err = touch_pad_read((touch_pad_t)digitalPinToTouchChannel(touchPins[i]), &raw);
+#else
+        uint32_t raw = 0;
+        esp_err_t err = touch_pad_read_raw_data((touch_pad_t)digitalPinToTouchChannel(touchPins[i]), &raw);
+#endif
+        // Zero until the FSM has completed its first scan
+        if (err == ESP_OK && raw != 0)
+        {
+            lastTouchRaw[i] = raw;
+            touchFilters[i].update(raw);
+        }
+#else
+        // External touch module: already a clean digital output, scale it so the
+        // filter's debounce still applies with the default thresholds
+        lastTouchRaw[i] = digitalRead(touchPins[i]) ? 0 : 64;
+        touchFilters[i].update(lastTouchRaw[i]);
+#endif
+        if (touchFilters[i].isTouched())
+            mask |= 1 << i;
+    }
+    // Sampling limits this to TOUCH_SAMPLE_INTERVAL, the same on every pad
+    if (mask != touchMask)
+        touchChangedUs = esp_timer_get_time();
+    touchMask = mask;
+
+    unsigned long now = millis();
+    GestureEvent event = gestureDetector.update(touchMask != 0, now);
+    if (event != GESTURE_NONE)
+    {
+        localGesture = event;
+        localGestureCount++;
+        localGestureAtMs = now;
+        gesturePending = true;
+    }
+}
+
+bool SensorManager::takeGesture()
+{
+    bool pending = gesturePending;
+    gesturePending = false;
+    return pending;
+}
+
+GestureConfig SensorManager::getGestureConfig() const
+{
+    return gestureDetector.getConfig();
+}
+
+void SensorManager::setGestureConfig(const GestureConfig &config)
+{
+    gestureDetector.setConfig(config);
+    gestureDetector.reset();
+}
+
 int SensorManager::getLocalTouchValue() const
 {
-    return digitalRead(TOUCH_PIN);
+    return touchMask != 0 ? 1 : 0;
 }
 
-float SensorManager::getLocalBatteryVoltage() const
+uint32_t SensorManager::getTouchWakeThreshold() const
+{
+    // Absolute raw reading that counts as a touch, for the sleep-time touch FSM
+    // Only the first channel (TOUCH_PIN) wakes the pad
+    const TouchFilterConfig &config = touchFilters[0].getConfig();
+    int32_t baseline = touchFilters[0].getBaseline();
+    int32_t threshold = config.touchDecreases ? baseline - (int32_t)config.touchThreshold
+                                              : baseline + (int32_t)config.touchThreshold;
+    return threshold > 0 ? (uint32_t)threshold : 0;
+}
+
+TouchFilterConfig SensorManager::getTouchConfig() const
+{
+    return touchFilters[0].getConfig();
+}
+
+void SensorManager::setTouchConfig(const TouchFilterConfig &config)
+{
+    for (uint8_t i = 0; i < touchChannelCount; i++)
+        touchFilters[i].setConfig(config);
+}
+
+String SensorManager::getTouchStateJSON() const
 {
-    float totalVoltage = 0.0f;
-    for (int i = 0; i < 100; i++)
+    std::unique_ptr<SensorSnapshot> state(new SensorSnapshot());
+    if (!readSnapshot(*state))
+        return String();
+
+    // Top-level readings are channel 0 (TOUCH_PIN), every channel is listed under "channels"
+    const TouchChannelSnapshot &primary = state->channels[0];
+    const TouchFilterConfig &config = state->touchConfig;
+    String json = "{";
+    json += "\"touched\":" + String(primary.touched ? "true" : "false") + ",";
+    json += "\"raw\":" + String(primary.raw) + ",";
+    json += "\"filtered\":" + String(primary.filtered) + ",";
+    json += "\"baseline\":" + String(primary.baseline) + ",";
+    json += "\"delta\":" + String(primary.delta) + ",";
+    json += "\"touchMask\":" + String(state->touchMask) + ",\"channels\":[";
+    for (uint8_t i = 0; i < state->touchChannels; i++)
     {
-        int batteryReading = analogRead(BATTERY_PIN);
-        float batteryVoltage = batteryReading * ((VCC / 4096.0f) * (R1 + R2) / R2) * CALIBRATION_FACTOR;
-        totalVoltage += batteryVoltage;
+        const TouchChannelSnapshot &channel = state->channels[i];
+        if (i > 0)
+            json += ",";
+        json += "{\"pin\":" + String(channel.pin) + ",";
+        json += "\"raw\":" + String(channel.raw) + ",";
+        json += "\"baseline\":" + String(channel.baseline) + ",";
+        json += "\"delta\":" + String(channel.delta) + ",";
+        json += "\"touched\":" + String(channel.touched ? "true" : "false") + "}";
     }
-    return totalVoltage / 100.0f;
+    json += "],";
+    json += "\"touchThreshold\":" + String(config.touchThreshold) + ",";
+    json += "\"releaseThreshold\":" + String(config.releaseThreshold) + ",";
+    json += "\"debounceSamples\":" + String(config.debounceSamples) + ",";
+    json += "\"filterShift\":" + String(config.filterShift) + ",";
+    json += "\"baselineShift\":" + String(config.baselineShift) + ",";
+    const GestureConfig &gestures = state->gestureConfig;
+    json += "\"longPressMs\":" + String(gestures.longPressMs) + ",";
+    json += "\"doubleTapGapMs\":" + String(gestures.doubleTapGapMs) + ",";
+    json += "\"holdRepeatMs\":" + String(gestures.holdRepeatMs) + ",";
+    json += "\"gesture\":\"" + String(gestureName(state->gesture)) + "\"";
+    json += "}";
+    return json;
+}
+
+void SensorManager::pollBattery()
+{
+    batteryMonitor.poll();
+}
+
+float SensorManager::getLocalBatteryVoltage() const
+{
+    return batteryMonitor.getMillivolts() / 1000.0f;
 }
 
 float SensorManager::getLocalBatteryPercent() const
 {
-    float voltage = getLocalBatteryVoltage();
-    float percent = (voltage - 3.2f) / (4.2f - 3.2f) * 100.0f;
-    percent = constrain(percent, 0.0f, 100.0f);
-    return percent;
+    return batteryMonitor.getPercentTenths() / 10.0f;
 }
 
 String SensorManager::getLocalSensorDataJSON() const
 {
+    std::unique_ptr<SensorSnapshot> state(new SensorSnapshot());
+    if (!readSnapshot(*state))
+        return String();
+
     String json = "{";
     String localIP = WiFi.localIP().toString();
     json += "\"ip\":\"" + localIP + "\",";
@@ -120,17 +658,37 @@ String SensorManager::getLocalSensorDataJSON() const
     int clientId = clientIdentity ? clientIdentity->get() : 0;
 
     json += "\"clientId\":" + String(clientId) + ",";
-    int touchValue = getLocalTouchValue();
-    float batteryPercent = getLocalBatteryPercent();
-    json += "\"touch\":" + String(touchValue) + ",";
-    json += "\"batteryPercent\":" + String(batteryPercent, 1);
+    json += "\"touch\":" + String(state->touchMask != 0 ? 1 : 0) + ",";
+    json += "\"touchMask\":" + String(state->touchMask) + ",";
+    json += "\"channels\":" + String(state->touchChannels) + ",";
+    json += "\"batteryPercent\":" + String(state->batteryPercent, 1) + ",";
+    json += "\"gesture\":\"" + String(gestureName(state->gesture)) + "\"";
     json += "}";
     return json;
 }
 
 void SensorManager::begin(ClientIdentity *identity)
 {
-    pinMode(TOUCH_PIN, INPUT);
-    pinMode(BATTERY_PIN, INPUT);
+    beginTouchChannels();
+    batteryMonitor.begin(BATTERY_PIN);
     clientIdentity = identity;
+
+    TouchFilterConfig config;
+    config.touchThreshold = TOUCH_THRESHOLD;
+    config.releaseThreshold = TOUCH_RELEASE_THRESHOLD;
+#if TOUCH_SENSE_CAPACITIVE && (CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3)
+    config.touchDecreases = false;
+#endif
+    setTouchConfig(config);
+
+    GestureConfig gestures;
+    gestures.longPressMs = GESTURE_LONG_PRESS_MS;
+    gestures.doubleTapGapMs = GESTURE_DOUBLE_TAP_GAP_MS;
+    gestures.holdRepeatMs = GESTURE_HOLD_REPEAT_MS;
+    gestureDetector.setConfig(gestures);
+    sampleTouch(); // Prime the baseline
+
+    postedReadings = xQueueCreate(HTTP_READING_QUEUE_LENGTH, sizeof(PostedReading));
+    postedConfigs = xQueueCreate(HTTP_CONFIG_QUEUE_LENGTH, sizeof(PostedConfig));
+    publishSnapshot();
 }
@@ -0,0 +1,83 @@
+#include "serial_bridge.h"
+
+SerialBridge::SerialBridge()
+{
+    output = nullptr;
+    sensorManager = nullptr;
+    intervalMs = 0;
+    lastFrameMs = 0;
+    minSlots = 0;
+    sequence = 0;
+    droppedFrames = 0;
+}
+
+void SerialBridge::begin(HardwareSerial *port, SensorManager *sensors, unsigned long frameIntervalMs, int minimumSlots)
+{
+    output = port;
+    sensorManager = sensors;
+    intervalMs = frameIntervalMs;
+    minSlots = constrain(minimumSlots, 0, SERIAL_FRAME_MAX_SLOTS);
+}
+
+size_t SerialBridge::buildFrame(uint32_t timestampMs)
+{
+    uint8_t *slot = payload + SERIAL_FRAME_HEADER_SIZE;
+    uint8_t slotCount = 0;
+
+    for (const auto &pair : sensorManager->getAllSensorData())
+    {
+        if (slotCount >= SERIAL_FRAME_MAX_SLOTS)
+            break;
+        const SensorData &data = pair.second;
+        uint8_t flags = SERIAL_SLOT_FLAG_PRESENT;
+        if (data.touchValue)
+            flags |= SERIAL_SLOT_FLAG_TOUCH;
+        slot[0] = (uint8_t)data.clientId.toInt();
+        slot[1] = flags;
+        SerialFrame::putU16(slot + 2, (uint16_t)(data.batteryPercent * 10.0f + 0.5f));
+        slot += SERIAL_FRAME_SLOT_SIZE;
+        slotCount++;
+    }
+
+    // Same padding rule as the "TP:" text format
+    while (slotCount < minSlots)
+    {
+        slot[0] = 0;
+        slot[1] = 0;
+        SerialFrame::putU16(slot + 2, 0);
+        slot += SERIAL_FRAME_SLOT_SIZE;
+        slotCount++;
+    }
+
+    payload[0] = SERIAL_FRAME_VERSION;
+    payload[1] = slotCount;
+    SerialFrame::putU16(payload + 2, sequence++);
+    SerialFrame::putU32(payload + 4, timestampMs);
+
+    size_t length = slot - payload;
+    SerialFrame::putU16(slot, SerialFrame::crc16(payload, length));
+    length += SERIAL_FRAME_CRC_SIZE;
+
+    return SerialFrame::cobsEncode(payload, length, encoded);
+}
+
+void SerialBridge::handle()
+{
+    if (output == nullptr)
+        return;
+
+    unsigned long now = millis();
+    if (now - lastFrameMs < intervalMs)
+        return;
+    lastFrameMs = now;
+
+    size_t length = buildFrame(now);
+
+    // Never block the loop on a full UART: skip the frame, the host sees the sequence gap
+    if (output->availableForWrite() < (int)length)
+    {
+        droppedFrames++;
+        return;
+    }
+    output->write(encoded, length);
+}
@@ -0,0 +1,458 @@
+#include "telemetry_log.h"
+#include <SPIFFS.h>
+#include <algorithm>
+#include <memory>
+
+static size_t putVarint(uint8_t *out, uint64_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80)
+    {
+        out[length++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+// Returns bytes consumed, 0 if the varint is cut off
+static size_t getVarint(const uint8_t *in, size_t length, uint64_t &value)
+{
+    value = 0;
+    for (size_t i = 0; i < length && i < 10; i++)
+    {
+        value |= (uint64_t)(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0)
+            return i + 1;
+    }
+    return 0;
+}
+
+static size_t encodeRecord(uint8_t *out, uint64_t deltaMs, uint8_t type, int32_t batteryDelta)
+{
+    size_t length = putVarint(out, (deltaMs << 2) | type);
+    if (type == TELEMETRY_RECORD_BATTERY)
+        length += putVarint(out + length, (uint32_t)((batteryDelta << 1) ^ (batteryDelta >> 31)));
+    return length;
+}
+
+// Advances timeMs/batteryTenths, returns bytes consumed or 0 if the record is incomplete
+static size_t decodeRecord(const uint8_t *in, size_t length, uint64_t &timeMs, int32_t &batteryTenths, uint8_t &type)
+{
+    uint64_t header;
+    size_t used = getVarint(in, length, header);
+    if (used == 0)
+        return 0;
+    type = header & 0x03;
+    if (type == TELEMETRY_RECORD_BATTERY)
+    {
+        uint64_t zigzag;
+        size_t more = getVarint(in + used, length - used, zigzag);
+        if (more == 0)
+            return 0;
+        used += more;
+        batteryTenths += (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+    }
+    timeMs += header >> 2;
+    return used;
+}
+
+TelemetryLog::TelemetryLog()
+{
+    segmentCount = 0;
+    ready = false;
+    fileMutex = nullptr;
+    bufferMux = portMUX_INITIALIZER_UNLOCKED;
+    bufferLength = 0;
+    lastMs = 0;
+    lastBatteryTenths = 0;
+    rotatePending = false;
+    pendingBaseMs = 0;
+    clockOffsetMs = 0;
+    lastFlushMs = 0;
+    lastFailedFlushMs = 0;
+    flushFailing = false;
+    lastBatteryLogMs = 0;
+    lastTouched = -1;
+    loggedBatteryTenths = -1;
+    droppedRecords = 0;
+}
+
+String TelemetryLog::segmentPath(uint32_t number)
+{
+    char path[24];
+    snprintf(path, sizeof(path), TELEMETRY_FILE_PREFIX "%05u.bin", number);
+    return String(path);
+}
+
+bool TelemetryLog::scanSegment(TelemetrySegment &segment, int32_t &endBatteryTenths)
+{
+    File file = SPIFFS.open(segmentPath(segment.number), "r");
+    if (!file)
+        return false;
+
+    uint8_t header[TELEMETRY_HEADER_SIZE];
+    if (file.read(header, sizeof(header)) != sizeof(header) || memcmp(header, "TLOG", 4) != 0 ||
+        header[4] != TELEMETRY_FILE_VERSION)
+    {
+        file.close();
+        return false;
+    }
+    memcpy(&segment.firstMs, header + 8, sizeof(segment.firstMs));
+
+    uint64_t timeMs = segment.firstMs;
+    int32_t battery = 0;
+    size_t fileSize = file.size();
+    size_t valid = TELEMETRY_HEADER_SIZE;
+
+    // Walk the records to find the end time and any torn write at the tail
+    uint8_t chunk[256];
+    size_t pending = 0;
+    while (true)
+    {
+        int got = file.read(chunk + pending, sizeof(chunk) - pending);
+        if (got <= 0)
+            break;
+        size_t available = pending + got;
+        size_t offset = 0;
+        uint8_t type;
+        while (offset < available)
+        {
+            size_t used = decodeRecord(chunk + offset, available - offset, timeMs, battery, type);
+            if (used == 0)
+                break;
+            offset += used;
+            valid += used;
+        }
+        pending = available - offset;
+        memmove(chunk, chunk + offset, pending);
+    }
+    file.close();
+
+    segment.lastMs = timeMs;
+    // A torn tail cannot be appended to, mark the segment full so the next record rotates
+    segment.bytes = valid == fileSize ? valid : TELEMETRY_SEGMENT_BYTES;
+    endBatteryTenths = battery;
+    return true;
+}
+
+bool TelemetryLog::begin()
+{
+    fileMutex = xSemaphoreCreateMutex();
+    if (fileMutex == nullptr)
+        return false;
+
+    // Collect segment numbers, oldest first
+    uint32_t numbers[TELEMETRY_MAX_SEGMENTS + 8];
+    uint8_t found = 0;
+    File root = SPIFFS.open("/");
+    File file = root.openNextFile();
+    while (file)
+    {
+        String name = file.name();
+        file.close();
+        if (!name.startsWith("/"))
+            name = "/" + name;
+        if (name.startsWith(TELEMETRY_FILE_PREFIX) && found < sizeof(numbers) / sizeof(numbers[0]))
+            numbers[found++] = name.substring(strlen(TELEMETRY_FILE_PREFIX)).toInt();
+        file = root.openNextFile();
+    }
+    root.close();
+    std::sort(numbers, numbers + found);
+
+    int32_t endBattery = 0;
+    for (uint8_t i = 0; i < found; i++)
+    {
+        // Keep only the newest TELEMETRY_MAX_SEGMENTS, drop anything unreadable
+        TelemetrySegment segment = {numbers[i], 0, 0, 0};
+        if (found - i > TELEMETRY_MAX_SEGMENTS || !scanSegment(segment, endBattery))
+        {
+            SPIFFS.remove(segmentPath(numbers[i]));
+            continue;
+        }
+        segments[segmentCount++] = segment;
+    }
+
+    if (segmentCount > 0)
+    {
+        const TelemetrySegment &newest = segments[segmentCount - 1];
+        lastMs = newest.lastMs;
+        lastBatteryTenths = endBattery;
+        // Continue the log clock just after the last record
+        clockOffsetMs = (int64_t)newest.lastMs + 1 - (int64_t)millis();
+    }
+
+    lastFlushMs = millis();
+    ready = true;
+    append(TELEMETRY_RECORD_BOOT, 0);
+
+    Serial.printf("[TELEMETRY] %u segments, log clock at %llu ms\n", segmentCount, (unsigned long long)now());
+    return true;
+}
+
+bool TelemetryLog::createSegment(uint32_t number, uint64_t baseMs)
+{
+    if (segmentCount == TELEMETRY_MAX_SEGMENTS)
+    {
+        SPIFFS.remove(segmentPath(segments[0].number));
+        memmove(segments, segments + 1, sizeof(TelemetrySegment) * (segmentCount - 1));
+        segmentCount--;
+    }
+
+    File file = SPIFFS.open(segmentPath(number), "w");
+    if (!file)
+    {
+        Serial.printf("[TELEMETRY] Failed to create segment %u\n", number);
+        return false;
+    }
+    uint8_t header[TELEMETRY_HEADER_SIZE] = {'T', 'L', 'O', 'G', TELEMETRY_FILE_VERSION};
+    memcpy(header + 8, &baseMs, sizeof(baseMs));
+    bool written = file.write(header, sizeof(header)) == sizeof(header);
+    file.close();
+    if (!written)
+        return false;
+
+    segments[segmentCount++] = {number, baseMs, baseMs, TELEMETRY_HEADER_SIZE};
+    return true;
+}
+
+bool TelemetryLog::flush()
+{
+    if (bufferLength == 0 && !rotatePending)
+        return true;
+    // Not on every loop pass (or every record once the buffer is full) while the flash keeps failing
+    if (flushFailing && millis() - lastFailedFlushMs < TELEMETRY_FLUSH_RETRY_INTERVAL)
+        return false;
+    if (xSemaphoreTake(fileMutex, 0) != pdTRUE)
+        return false; // A query is reading, try again on the next pass
+
+    bool ok = true;
+    if (rotatePending)
+    {
+        uint32_t number = segmentCount > 0 ? segments[segmentCount - 1].number + 1 : 0;
+        ok = createSegment(number, pendingBaseMs);
+    }
+    if (ok && bufferLength > 0)
+    {
+        File file = SPIFFS.open(segmentPath(segments[segmentCount - 1].number), "a");
+        ok = file && file.write(buffer, bufferLength) == bufferLength;
+        file.close();
+    }
+    if (ok)
+    {
+        TelemetrySegment &open = segments[segmentCount - 1];
+        open.bytes += bufferLength;
+        open.lastMs = lastMs;
+        portENTER_CRITICAL(&bufferMux);
+        bufferLength = 0;
+        rotatePending = false;
+        portEXIT_CRITICAL(&bufferMux);
+    }
+    flushFailing = !ok;
+    if (!ok)
+        lastFailedFlushMs = millis();
+    xSemaphoreGive(fileMutex);
+    return ok;
+}
+
+void TelemetryLog::append(uint8_t type, int32_t batteryTenths)
+{
+    if (bufferLength + TELEMETRY_MAX_RECORD_SIZE > TELEMETRY_BUFFER_BYTES && !flush())
+    {
+        droppedRecords++;
+        return;
+    }
+
+    uint64_t timeMs = now();
+    bool segmentFull = segmentCount == 0 ||
+                       segments[segmentCount - 1].bytes + bufferLength + TELEMETRY_MAX_RECORD_SIZE > TELEMETRY_SEGMENT_BYTES;
+    if (!rotatePending && segmentFull)
+    {
+        if (bufferLength > 0 && !flush())
+        {
+            droppedRecords++;
+            return;
+        }
+        // The next records start a new segment with fresh delta state
+        portENTER_CRITICAL(&bufferMux);
+        rotatePending = true;
+        pendingBaseMs = timeMs;
+        portEXIT_CRITICAL(&bufferMux);
+        lastMs = timeMs;
+        lastBatteryTenths = 0;
+    }
+
+    uint8_t record[TELEMETRY_MAX_RECORD_SIZE];
+    size_t length = encodeRecord(record, timeMs - lastMs, type, batteryTenths - lastBatteryTenths);
+
+    portENTER_CRITICAL(&bufferMux);
+    memcpy(buffer + bufferLength, record, length);
+    bufferLength += length;
+    portEXIT_CRITICAL(&bufferMux);
+
+    lastMs = timeMs;
+    if (type == TELEMETRY_RECORD_BATTERY)
+        lastBatteryTenths = batteryTenths;
+}
+
+void TelemetryLog::update(bool touched, uint16_t batteryTenths)
+{
+    if (!ready)
+        return;
+
+    if (lastTouched != (int)touched)
+    {
+        append(touched ? TELEMETRY_RECORD_TOUCHED : TELEMETRY_RECORD_RELEASED, 0);
+        lastTouched = touched;
+    }
+
+    unsigned long nowMs = millis();
+    if (loggedBatteryTenths < 0 || nowMs - lastBatteryLogMs >= TELEMETRY_BATTERY_INTERVAL)
+    {
+        lastBatteryLogMs = nowMs;
+        if (loggedBatteryTenths < 0 || abs((int32_t)batteryTenths - loggedBatteryTenths) >= TELEMETRY_BATTERY_MIN_CHANGE)
+        {
+            append(TELEMETRY_RECORD_BATTERY, batteryTenths);
+            loggedBatteryTenths = batteryTenths;
+        }
+    }
+}
+
+void TelemetryLog::handle()
+{
+    if (!ready)
+        return;
+
+    unsigned long nowMs = millis();
+    if (nowMs - lastFlushMs >= TELEMETRY_FLUSH_INTERVAL && flush())
+        lastFlushMs = nowMs;
+}
+
+String TelemetryLog::query(uint64_t fromMs, uint64_t toMs, uint32_t limit)
+{
+    if (!ready)
+        return "{\"error\":\"Telemetry log not ready\"}";
+    if (xSemaphoreTake(fileMutex, pdMS_TO_TICKS(1000)) != pdTRUE)
+        return "{\"error\":\"Telemetry log busy\"}";
+
+    // Segments and buffer only change under the file mutex or (buffer) in loop() under bufferMux
+    TelemetrySegment index[TELEMETRY_MAX_SEGMENTS];
+    uint8_t count = segmentCount;
+    memcpy(index, segments, sizeof(TelemetrySegment) * count);
+    std::unique_ptr<uint8_t[]> data(new uint8_t[TELEMETRY_SEGMENT_BYTES + TELEMETRY_BUFFER_BYTES]);
+    portENTER_CRITICAL(&bufferMux);
+    size_t buffered = bufferLength;
+    bool pending = rotatePending;
+    uint64_t pendingBase = pendingBaseMs;
+    memcpy(data.get() + TELEMETRY_SEGMENT_BYTES, buffer, buffered);
+    portEXIT_CRITICAL(&bufferMux);
+
+    String touch = "";
+    String battery = "";
+    String boots = "";
+    uint32_t emitted = 0;
+    bool more = false;
+    uint64_t next = 0;
+
+    // Decodes one segment (file bytes plus, for the open one, the RAM buffer)
+    auto decode = [&](const uint8_t *bytes, size_t length, uint64_t &timeMs, int32_t &tenths)
+    {
+        size_t offset = 0;
+        uint8_t type;
+        while (!more && offset < length)
+        {
+            size_t used = decodeRecord(bytes + offset, length - offset, timeMs, tenths, type);
+            if (used == 0)
+                break;
+            offset += used;
+            if (timeMs < fromMs || timeMs > toMs)
+                continue;
+            if (emitted == limit)
+            {
+                more = true;
+                next = timeMs;
+                break;
+            }
+            String entry = "[" + String(timeMs) + ",";
+            if (type == TELEMETRY_RECORD_BATTERY)
+                battery += (battery.length() ? "," : "") + entry + String(tenths / 10.0f, 1) + "]";
+            else if (type == TELEMETRY_RECORD_BOOT)
+                boots += (boots.length() ? "," : "") + String(timeMs);
+            else
+                touch += (touch.length() ? "," : "") + entry + String(type) + "]";
+            emitted++;
+        }
+    };
+
+    for (uint8_t i = 0; i < count && !more; i++)
+    {
+        bool openSegment = i == count - 1 && !pending;
+        if (index[i].firstMs > toMs)
+            break;
+        if (index[i].lastMs < fromMs && !openSegment)
+            continue;
+
+        File file = SPIFFS.open(segmentPath(index[i].number), "r");
+        if (!file)
+            continue;
+        size_t length = file.size() > TELEMETRY_HEADER_SIZE ? file.size() - TELEMETRY_HEADER_SIZE : 0;
+        if (length > TELEMETRY_SEGMENT_BYTES)
+            length = TELEMETRY_SEGMENT_BYTES;
+        file.seek(TELEMETRY_HEADER_SIZE);
+        length = file.read(data.get(), length);
+        file.close();
+
+        uint64_t timeMs = index[i].firstMs;
+        int32_t tenths = 0;
+        decode(data.get(), length, timeMs, tenths);
+        if (openSegment)
+            decode(data.get() + TELEMETRY_SEGMENT_BYTES, buffered, timeMs, tenths);
+    }
+    if (pending && !more)
+    {
+        uint64_t timeMs = pendingBase;
+        int32_t tenths = 0;
+        decode(data.get() + TELEMETRY_SEGMENT_BYTES, buffered, timeMs, tenths);
+    }
+    xSemaphoreGive(fileMutex);
+
+    String json = "{\"now\":" + String(now()) + ",";
+    json += "\"from\":" + String(fromMs) + ",";
+    json += "\"to\":" + String(toMs) + ",";
+    json += "\"touch\":[" + touch + "],";
+    json += "\"battery\":[" + battery + "],";
+    json += "\"boots\":[" + boots + "],";
+    json += "\"more\":" + String(more ? "true" : "false");
+    if (more)
+        json += ",\"next\":" + String(next);
+    json += "}";
+    return json;
+}
+
+String TelemetryLog::getIndexJSON()
+{
+    if (!ready)
+        return "{\"error\":\"Telemetry log not ready\"}";
+    if (xSemaphoreTake(fileMutex, pdMS_TO_TICKS(1000)) != pdTRUE)
+        return "{\"error\":\"Telemetry log busy\"}";
+
+    uint32_t totalBytes = 0;
+    String json = "{\"now\":" + String(now()) + ",\"segments\":[";
+    for (uint8_t i = 0; i < segmentCount; i++)
+    {
+        const TelemetrySegment &segment = segments[i];
+        if (i > 0)
+            json += ",";
+        json += "{\"number\":" + String(segment.number) + ",";
+        json += "\"firstMs\":" + String(segment.firstMs) + ",";
+        json += "\"lastMs\":" + String(segment.lastMs) + ",";
+        json += "\"bytes\":" + String(segment.bytes) + "}";
+        totalBytes += segment.bytes;
+    }
+    xSemaphoreGive(fileMutex);
+
+    json += "],\"totalBytes\":" + String(totalBytes) + ",";
+    json += "\"bufferedBytes\":" + String(bufferLength) + ",";
+    json += "\"droppedRecords\":" + String(droppedRecords) + "}";
+    return json;
+}
@@ -0,0 +1,282 @@
+#include "time_sync.h"
+
+TimeSync::TimeSync()
+{
+    espNow = nullptr;
+    master = false;
+    mux = portMUX_INITIALIZER_UNLOCKED;
+    beaconSequence = 0;
+    beaconsSent = 0;
+    lastBeaconMs = 0;
+    memset(masterMac, 0, sizeof(masterMac));
+    hasMaster = false;
+    masterChanged = false;
+    lastRxSequence = 0;
+    lastRxUs = 0;
+    lastBeaconHeardMs = 0;
+    beaconsReceived = 0;
+    samplePending = false;
+    rejectedBeacons = 0;
+    resets = 0;
+    reset();
+    publish();
+}
+
+void TimeSync::begin(EspNowManager *espNowManager, bool isMaster)
+{
+    espNow = espNowManager;
+    master = isMaster;
+    Serial.printf("[SYNC] %s, beacons every %d ms\n", master ? "Time master" : "Following the time master",
+                  TIME_SYNC_BEACON_INTERVAL);
+}
+
+void TimeSync::reset()
+{
+    sampleCount = 0;
+    nextSample = 0;
+    fitLocalUs = 0;
+    fitOffsetUs = 0;
+    fitDrift = 0;
+    locked = false;
+    outlierRun = 0;
+    lastErrorUs = 0;
+    avgErrorQ4 = 0;
+    maxErrorUs = 0;
+}
+
+void TimeSync::onBeacon(const uint8_t *mac, const struct_time_beacon &beacon, int64_t rxUs)
+{
+    if (espNow == nullptr || master)
+        return;
+
+    unsigned long now = millis();
+    portENTER_CRITICAL(&mux);
+    bool sameMaster = hasMaster && memcmp(mac, masterMac, 6) == 0;
+    if (!sameMaster && hasMaster && now - lastBeaconHeardMs < TIME_SYNC_MASTER_TIMEOUT)
+    {
+        // A second master: stay with ours while it is alive
+        portEXIT_CRITICAL(&mux);
+        return;
+    }
+    if (!sameMaster || beacon.sequence <= lastRxSequence)
+    {
+        // New master, or ours restarted: its clock is unrelated to the fit
+        memcpy(masterMac, mac, 6);
+        hasMaster = true;
+        masterChanged = true;
+        lastRxUs = 0;
+    }
+    else if (lastRxUs != 0 && beacon.previousTxUs != 0 && beacon.sequence == lastRxSequence + 1)
+    {
+        // previousTxUs is when the beacon we timestamped last time was sent
+        pendingSample.localUs = lastRxUs;
+        pendingSample.masterUs = (int64_t)beacon.previousTxUs;
+        samplePending = true;
+    }
+    lastRxSequence = beacon.sequence;
+    lastRxUs = rxUs;
+    lastBeaconHeardMs = now;
+    beaconsReceived++;
+    portEXIT_CRITICAL(&mux);
+}
+
+void TimeSync::handle()
+{
+    if (espNow == nullptr)
+        return;
+
+    unsigned long now = millis();
+    if (master)
+    {
+        sendBeacon(now);
+        return;
+    }
+
+    TimeSyncSample sample;
+    bool haveSample;
+    bool restart;
+    portENTER_CRITICAL(&mux);
+    haveSample = samplePending;
+    sample = pendingSample;
+    samplePending = false;
+    restart = masterChanged;
+    masterChanged = false;
+    portEXIT_CRITICAL(&mux);
+
+    if (restart)
+    {
+        if (sampleCount > 0)
+            resets++;
+        reset();
+        Serial.printf("[SYNC] Following %02X:%02X:%02X:%02X:%02X:%02X\n",
+                      masterMac[0], masterMac[1], masterMac[2], masterMac[3], masterMac[4], masterMac[5]);
+    }
+    if (haveSample)
+        addSample(sample);
+
+    // Keeps extrapolating the last fit, but frames are no longer stamped as synced
+    // (signed: a beacon may have arrived on the WiFi task since `now` was read)
+    if (locked && (long)(now - lastBeaconHeardMs) > TIME_SYNC_MASTER_TIMEOUT)
+    {
+        locked = false;
+        Serial.printf("[SYNC] No beacon for %lu ms, unlocked\n", now - lastBeaconHeardMs);
+    }
+    publish();
+}
+
+void TimeSync::publish()
+{
+    portENTER_CRITICAL(&mux);
+    published = {locked, sampleCount, fitLocalUs, fitOffsetUs, fitDrift, lastErrorUs,
+                 avgErrorQ4, maxErrorUs, rejectedBeacons, resets};
+    portEXIT_CRITICAL(&mux);
+}
+
+void TimeSync::sendBeacon(unsigned long now)
+{
+    // Waiting for idle keeps the send callbacks unambiguous, see EspNowManager::sendBeacon()
+    if (now - lastBeaconMs < TIME_SYNC_BEACON_INTERVAL || espNow->isSendPending())
+        return;
+
+    struct_time_beacon beacon;
+    beacon.magic = ESPNOW_BEACON_MAGIC;
+    beacon.sequence = ++beaconSequence;
+    beacon.previousTxUs = (uint64_t)espNow->getBeaconSentUs();
+    if (espNow->sendBeacon((const uint8_t *)&beacon, sizeof(beacon)))
+        beaconsSent++;
+    lastBeaconMs = now;
+}
+
+void TimeSync::addSample(const TimeSyncSample &sample)
+{
+    if (sampleCount >= TIME_SYNC_MIN_SAMPLES)
+    {
+        int64_t error = sample.masterUs - toSyncedUs(sample.localUs);
+        uint32_t absError = (uint32_t)(error < 0 ? -error : error);
+        if (absError > TIME_SYNC_OUTLIER_US)
+        {
+            rejectedBeacons++;
+            if (++outlierRun < TIME_SYNC_OUTLIER_RESET)
+                return;
+            Serial.printf("[SYNC] %u beacons in a row off by more than %d us, restarting the fit\n",
+                          outlierRun, TIME_SYNC_OUTLIER_US);
+            resets++;
+            reset();
+        }
+        else
+        {
+            outlierRun = 0;
+            lastErrorUs = (int32_t)error;
+            avgErrorQ4 = avgErrorQ4 == 0 ? absError << 4 : avgErrorQ4 + (int32_t)((absError << 4) - avgErrorQ4) / 8;
+            if (absError > maxErrorUs)
+                maxErrorUs = absError;
+        }
+    }
+
+    samples[nextSample] = sample;
+    nextSample = (nextSample + 1) % TIME_SYNC_WINDOW;
+    if (sampleCount < TIME_SYNC_WINDOW)
+        sampleCount++;
+    fit();
+
+    if (!locked && sampleCount >= TIME_SYNC_MIN_SAMPLES)
+    {
+        locked = true;
+        Serial.printf("[SYNC] Locked, offset %lld us, drift %.2f ppm\n", (long long)fitOffsetUs, fitDrift * 1e6);
+    }
+}
+
+void TimeSync::fit()
+{
+    // Least squares of (master - local) over local time, relative to the
+    // newest sample so the sums stay small
+    const TimeSyncSample &newest = samples[(nextSample + TIME_SYNC_WINDOW - 1) % TIME_SYNC_WINDOW];
+    int64_t refOffset = newest.masterUs - newest.localUs;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (uint8_t i = 0; i < sampleCount; i++)
+    {
+        double x = (double)(samples[i].localUs - newest.localUs);
+        double y = (double)(samples[i].masterUs - samples[i].localUs - refOffset);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+
+    double n = sampleCount;
+    double variance = sxx / n - (sx / n) * (sx / n);
+    double slope = variance > 0 ? (sxy / n - (sx / n) * (sy / n)) / variance : 0;
+    fitLocalUs = newest.localUs;
+    fitOffsetUs = (double)refOffset + sy / n - slope * (sx / n);
+    fitDrift = slope;
+}
+
+int64_t TimeSync::toSyncedUs(int64_t localUs) const
+{
+    if (master || sampleCount == 0)
+        return localUs;
+    return localUs + (int64_t)(fitOffsetUs + fitDrift * (double)(localUs - fitLocalUs));
+}
+
+uint16_t TimeSync::getSyncErrorUs() const
+{
+    if (master)
+        return 0;
+    if (!locked)
+        return 0xFFFF;
+    uint32_t error = (avgErrorQ4 + 8) >> 4;
+    return error > 0xFFFE ? 0xFFFE : (uint16_t)error;
+}
+
+String TimeSync::getJSON()
+{
+    unsigned long now = millis();
+    if (master)
+    {
+        String json = "{\"role\":\"master\",\"synced\":true,";
+        json += "\"nowUs\":" + String((uint64_t)esp_timer_get_time());
+        json += ",\"beaconsSent\":" + String(beaconsSent);
+        json += ",\"beaconSequence\":" + String(beaconSequence);
+        json += "}";
+        return json;
+    }
+
+    // The fit belongs to loop() and the beacon state to the WiFi task, take one consistent copy
+    TimeSyncStatus status;
+    uint8_t mac[6];
+    bool haveMaster;
+    unsigned long heardMs;
+    uint32_t received;
+    portENTER_CRITICAL(&mux);
+    status = published;
+    memcpy(mac, masterMac, sizeof(mac));
+    haveMaster = hasMaster;
+    heardMs = lastBeaconHeardMs;
+    received = beaconsReceived;
+    portEXIT_CRITICAL(&mux);
+
+    int64_t localUs = esp_timer_get_time();
+    int64_t syncedUs = status.sampleCount == 0 ? localUs
+                                               : localUs + (int64_t)(status.fitOffsetUs + status.fitDrift * (double)(localUs - status.fitLocalUs));
+    String json = "{\"role\":\"follower\",";
+    json += "\"synced\":" + String(status.locked ? "true" : "false") + ",";
+    json += "\"nowUs\":" + String((uint64_t)syncedUs);
+    if (haveMaster)
+    {
+        char macText[18];
+        snprintf(macText, sizeof(macText), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        json += ",\"master\":\"" + String(macText) + "\"";
+        json += ",\"lastBeaconMs\":" + String(now - heardMs);
+    }
+    json += ",\"beaconsReceived\":" + String(received);
+    json += ",\"samples\":" + String(status.sampleCount);
+    json += ",\"offsetUs\":" + String((long long)status.fitOffsetUs);
+    json += ",\"driftPpm\":" + String(status.fitDrift * 1e6, 2);
+    json += ",\"errorUs\":" + String(status.lastErrorUs);
+    json += ",\"avgErrorUs\":" + String(status.avgErrorQ4 / 16.0f, 1);
+    json += ",\"maxErrorUs\":" + String(status.maxErrorUs);
+    json += ",\"rejected\":" + String(status.rejectedBeacons);
+    json += ",\"resets\":" + String(status.resets);
+    json += "}";
+    return json;
+}
@@ -0,0 +1,328 @@
+#include "trace_recorder.h"
+#include <esp_timer.h>
+
+struct TraceEvent
+{
+    union
+    {
+        const char *name;
+        uint32_t timeLow; // Anchor: esp_timer time in us
+    };
+    uint32_t cycles;
+    union
+    {
+        TaskHandle_t task;
+        uint32_t timeHigh; // Anchor
+    };
+    uint8_t type;
+    uint8_t core;
+    uint16_t mhz; // Anchor
+};
+
+struct NamedTask
+{
+    TaskHandle_t task;
+    const char *name;
+};
+
+volatile bool TraceRecorder::active = false;
+
+#if TRACE_ENABLED
+static TraceEvent events[TRACE_BUFFER_EVENTS];
+#else
+static TraceEvent events[1];
+#endif
+static const uint32_t eventCapacity = sizeof(events) / sizeof(events[0]);
+static uint32_t head = 0;  // Next slot written
+static uint32_t count = 0;
+static uint32_t written = 0;
+static uint32_t overwritten = 0;
+static uint32_t epoch = 0; // Bumped by start() and resync(), every core anchors again
+
+// Each core's last anchor
+static uint32_t anchorEpoch[TRACE_MAX_CORES];
+static uint32_t anchorCycles[TRACE_MAX_CORES];
+static uint64_t anchorUs[TRACE_MAX_CORES];
+static uint32_t anchorWritten[TRACE_MAX_CORES];
+static NamedTask namedTasks[TRACE_MAX_NAMED_TASKS];
+static uint8_t namedTaskCount = 0;
+static portMUX_TYPE traceMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Called under traceMux
+static TraceEvent &nextEvent()
+{
+    TraceEvent &event = events[head];
+    head = (head + 1) % eventCapacity;
+    written++;
+    if (count < eventCapacity)
+        count++;
+    else
+        overwritten++;
+    return event;
+}
+
+void TraceRecorder::start()
+{
+#if TRACE_ENABLED
+    portENTER_CRITICAL(&traceMux);
+    head = 0;
+    count = 0;
+    overwritten = 0;
+    epoch++;
+    portEXIT_CRITICAL(&traceMux);
+    active = true;
+    Serial.printf("[TRACE] Recording, %u events max\n", eventCapacity);
+#endif
+}
+
+void TraceRecorder::stop()
+{
+    if (!active)
+        return;
+    active = false;
+    Serial.printf("[TRACE] Stopped, %u events (%u overwritten)\n", count, overwritten);
+}
+
+void TraceRecorder::resync()
+{
+    portENTER_CRITICAL(&traceMux);
+    epoch++;
+    portEXIT_CRITICAL(&traceMux);
+}
+
+void TraceRecorder::record(uint8_t type, const char *name)
+{
+    portENTER_CRITICAL(&traceMux);
+    uint8_t core = xPortGetCoreID();
+    uint32_t cycles = ESP.getCycleCount();
+
+    if (anchorEpoch[core] != epoch || cycles - anchorCycles[core] >= TRACE_ANCHOR_CYCLES ||
+        written - anchorWritten[core] >= eventCapacity / 2)
+    {
+        uint64_t nowUs = (uint64_t)esp_timer_get_time();
+        cycles = ESP.getCycleCount();
+        uint16_t mhz = (uint16_t)ESP.getCpuFreqMHz();
+        // Less than half a wrap since the last anchor, and no sleep or start in between
+        bool continued = anchorEpoch[core] == epoch && (nowUs - anchorUs[core]) * mhz < 2 * (uint64_t)TRACE_ANCHOR_CYCLES;
+
+        TraceEvent &anchor = nextEvent();
+        anchor.timeLow = (uint32_t)nowUs;
+        anchor.timeHigh = (uint32_t)(nowUs >> 32);
+        anchor.cycles = cycles;
+        anchor.type = continued ? TRACE_ANCHOR_CONTINUED : TRACE_ANCHOR;
+        anchor.core = core;
+        anchor.mhz = mhz;
+        anchorEpoch[core] = epoch;
+        anchorCycles[core] = cycles;
+        anchorUs[core] = nowUs;
+        anchorWritten[core] = written;
+    }
+
+    TraceEvent &event = nextEvent();
+    event.name = name;
+    event.cycles = cycles;
+    event.task = xTaskGetCurrentTaskHandle();
+    event.type = type;
+    event.core = core;
+    event.mhz = 0;
+    portEXIT_CRITICAL(&traceMux);
+}
+
+void TraceRecorder::nameTask(const char *name)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&traceMux);
+    uint8_t slot = 0;
+    while (slot < namedTaskCount && namedTasks[slot].task != task)
+        slot++;
+    if (slot < TRACE_MAX_NAMED_TASKS)
+    {
+        namedTasks[slot] = {task, name};
+        if (slot == namedTaskCount)
+            namedTaskCount++;
+    }
+    portEXIT_CRITICAL(&traceMux);
+}
+
+String TraceRecorder::getStatusJSON()
+{
+    String json = "{\"enabled\":" + String(TRACE_ENABLED ? "true" : "false") + ",";
+    json += "\"active\":" + String(active ? "true" : "false") + ",";
+    json += "\"events\":" + String(count) + ",";
+    json += "\"capacity\":" + String(TRACE_ENABLED ? eventCapacity : 0) + ",";
+    json += "\"overwritten\":" + String(overwritten) + "}";
+    return json;
+}
+
+#define TRACE_EXPORT_HEADER 0
+#define TRACE_EXPORT_EVENTS 1
+#define TRACE_EXPORT_THREADS 2
+#define TRACE_EXPORT_FOOTER 3
+#define TRACE_EXPORT_DONE 4
+
+TraceExport::TraceExport()
+{
+    memset(anchors, 0, sizeof(anchors));
+    memset(oldest, 0, sizeof(oldest));
+    taskCount = 0;
+    position = 0;
+    stage = TRACE_EXPORT_HEADER;
+    firstEntry = true;
+    skipped = 0;
+    entryLength = 0;
+    entrySent = 0;
+
+    portENTER_CRITICAL(&traceMux);
+    first = (head + eventCapacity - count) % eventCapacity;
+    total = count;
+    portEXIT_CRITICAL(&traceMux);
+
+    // Before its first anchor in the ring a core's events count back from that one
+    bool seen[TRACE_MAX_CORES] = {};
+    for (uint32_t i = 0; i < total; i++)
+    {
+        const TraceEvent &event = events[(first + i) % eventCapacity];
+        if ((event.type != TRACE_ANCHOR && event.type != TRACE_ANCHOR_CONTINUED) || event.core >= TRACE_MAX_CORES || seen[event.core])
+            continue;
+        seen[event.core] = true;
+        oldest[event.core] = {event.type == TRACE_ANCHOR_CONTINUED && event.mhz > 0,
+                              (((uint64_t)event.timeHigh << 32) | event.timeLow) * 1000, event.cycles, event.mhz};
+    }
+}
+
+size_t TraceExport::read(uint8_t *buffer, size_t maxLength)
+{
+    size_t length = 0;
+    while (length < maxLength)
+    {
+        if (entrySent == entryLength)
+        {
+            if (!nextEntry())
+                break;
+        }
+        size_t part = entryLength - entrySent;
+        if (part > maxLength - length)
+            part = maxLength - length;
+        memcpy(buffer + length, entry + entrySent, part);
+        entrySent += part;
+        length += part;
+    }
+    return length;
+}
+
+bool TraceExport::nextEntry()
+{
+    entryLength = 0;
+    entrySent = 0;
+    while (entryLength == 0)
+    {
+        switch (stage)
+        {
+        case TRACE_EXPORT_HEADER:
+            entryLength = snprintf(entry, sizeof(entry), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+            stage = TRACE_EXPORT_EVENTS;
+            break;
+
+        case TRACE_EXPORT_EVENTS:
+        {
+            // Recording again overwrites the ring under us
+            if (position == total || TraceRecorder::isActive())
+            {
+                position = 0;
+                stage = TRACE_EXPORT_THREADS;
+                break;
+            }
+            const TraceEvent &event = events[(first + position++) % eventCapacity];
+            if (event.core >= TRACE_MAX_CORES)
+                break;
+            CoreAnchor &anchor = anchors[event.core];
+
+            if (event.type == TRACE_ANCHOR || event.type == TRACE_ANCHOR_CONTINUED)
+            {
+                anchor.valid = event.mhz > 0;
+                anchor.timeNs = (((uint64_t)event.timeHigh << 32) | event.timeLow) * 1000;
+                anchor.cycles = event.cycles;
+                anchor.mhz = event.mhz;
+                break;
+            }
+            if (!anchor.valid && !oldest[event.core].valid)
+            {
+                skipped++;
+                break;
+            }
+
+            uint8_t tid = 0;
+            while (tid < taskCount && tasks[tid] != event.task)
+                tid++;
+            if (tid == taskCount)
+            {
+                if (taskCount == sizeof(tasks) / sizeof(tasks[0]))
+                {
+                    skipped++;
+                    break;
+                }
+                tasks[taskCount] = event.task;
+                depth[taskCount] = 0;
+                taskCount++;
+            }
+            if (event.type == TRACE_END)
+            {
+                if (depth[tid] == 0)
+                    break;
+                depth[tid]--;
+            }
+            else
+            {
+                depth[tid]++;
+            }
+
+            uint64_t timeNs;
+            if (anchor.valid)
+                timeNs = anchor.timeNs + (uint64_t)(event.cycles - anchor.cycles) * 1000 / anchor.mhz;
+            else
+                timeNs = oldest[event.core].timeNs - (uint64_t)(oldest[event.core].cycles - event.cycles) * 1000 / oldest[event.core].mhz;
+            entryLength = snprintf(entry, sizeof(entry), "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":1,\"tid\":%u}",
+                                   firstEntry ? "" : ",", event.name, event.type == TRACE_BEGIN ? 'B' : 'E',
+                                   (unsigned long long)(timeNs / 1000), (unsigned)(timeNs % 1000), tid + 1);
+            firstEntry = false;
+            break;
+        }
+
+        case TRACE_EXPORT_THREADS:
+        {
+            if (position == taskCount)
+            {
+                stage = TRACE_EXPORT_FOOTER;
+                break;
+            }
+            uint8_t tid = (uint8_t)position++;
+            const char *name = nullptr;
+            for (uint8_t i = 0; i < namedTaskCount; i++)
+            {
+                if (namedTasks[i].task == tasks[tid])
+                    name = namedTasks[i].name;
+            }
+            if (name == nullptr)
+                break;
+            entryLength = snprintf(entry, sizeof(entry), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                                   firstEntry ? "" : ",", tid + 1, name);
+            firstEntry = false;
+            break;
+        }
+
+        case TRACE_EXPORT_FOOTER:
+            entryLength = snprintf(entry, sizeof(entry), "],\"otherData\":{\"overwritten\":%u,\"skipped\":%u}}",
+                                   (unsigned)overwritten, (unsigned)skipped);
+            stage = TRACE_EXPORT_DONE;
+            break;
+
+        default:
+            return false;
+        }
+
+        // Cut short by snprintf: never hand out more than the buffer holds
+        if (entryLength >= sizeof(entry))
+            entryLength = sizeof(entry) - 1;
+    }
+    return true;
+}
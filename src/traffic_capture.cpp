@@ -0,0 +1,242 @@
+#include "traffic_capture.h"
+#include <SPIFFS.h>
+#include "config.h"
+
+TrafficCapture::TrafficCapture()
+{
+    serialPort = nullptr;
+    ring = nullptr;
+    sink = SINK_NONE;
+    startMicros = 0;
+    lastFlushMs = 0;
+    active = false;
+    requestedSink = SINK_NONE;
+    stopRequested = false;
+    records = 0;
+    bytesWritten = 0;
+    droppedRecords = 0;
+    injectHandler = nullptr;
+    inputLength = 0;
+    injectedFrames = 0;
+    rejectedFrames = 0;
+}
+
+bool TrafficCapture::begin(HardwareSerial *port)
+{
+    serialPort = port;
+    ring = xRingbufferCreate(CAPTURE_RING_BYTES, RINGBUF_TYPE_NOSPLIT);
+    if (ring == nullptr)
+    {
+        Serial.println("[CAPTURE] Failed to allocate ring buffer");
+        return false;
+    }
+    return true;
+}
+
+bool TrafficCapture::startCapture(Sink target)
+{
+    if (active)
+        stopCapture();
+
+    if (target == SINK_SPIFFS)
+    {
+        file = SPIFFS.open(CAPTURE_FILE_PATH, "w");
+        if (!file)
+        {
+            Serial.println("[CAPTURE] Failed to open " CAPTURE_FILE_PATH);
+            return false;
+        }
+        uint8_t header[CAPTURE_FILE_HEADER_SIZE] = {0};
+        memcpy(header, CAPTURE_FILE_MAGIC, 4);
+        header[4] = CAPTURE_FILE_VERSION;
+        SerialFrame::putU32(header + 8, millis());
+        file.write(header, sizeof(header));
+        bytesWritten = sizeof(header);
+    }
+    else
+    {
+        bytesWritten = 0;
+    }
+
+    // Discard anything queued by an earlier capture
+    size_t size;
+    void *item;
+    while ((item = xRingbufferReceive(ring, &size, 0)) != nullptr)
+        vRingbufferReturnItem(ring, item);
+
+    sink = target;
+    records = 0;
+    droppedRecords = 0;
+    startMicros = micros();
+    lastFlushMs = millis();
+    active = true;
+    Serial.printf("[CAPTURE] Started, sink %s\n", sink == SINK_SPIFFS ? CAPTURE_FILE_PATH : "serial");
+    return true;
+}
+
+void TrafficCapture::stopCapture()
+{
+    if (!active)
+        return;
+    active = false;
+    drainRing();
+    if (sink == SINK_SPIFFS)
+        file.close();
+    Serial.printf("[CAPTURE] Stopped: %u records, %u bytes, %u dropped\n", records, bytesWritten, droppedRecords);
+    sink = SINK_NONE;
+}
+
+void TrafficCapture::record(uint8_t kind, const uint8_t *mac, const uint8_t *data, int len)
+{
+    if (!active || len < 0 || len > ESP_NOW_MAX_DATA_LEN)
+        return;
+
+    uint8_t buffer[CAPTURE_RECORD_MAX_SIZE];
+    buffer[0] = kind;
+    SerialFrame::putU32(buffer + 1, micros() - startMicros);
+    if (mac != nullptr)
+        memcpy(buffer + 5, mac, 6);
+    else
+        memset(buffer + 5, 0, 6);
+    buffer[11] = (uint8_t)len;
+    memcpy(buffer + CAPTURE_RECORD_HEADER_SIZE, data, len);
+
+    if (xRingbufferSend(ring, buffer, CAPTURE_RECORD_HEADER_SIZE + len, 0) != pdTRUE)
+        droppedRecords++;
+}
+
+void TrafficCapture::writeRecord(const uint8_t *record, size_t length)
+{
+    if (sink == SINK_SPIFFS)
+    {
+        file.write(record, length);
+        bytesWritten += length;
+    }
+    else if (sink == SINK_SERIAL)
+    {
+        uint8_t payload[CAPTURE_SERIAL_MAX_PAYLOAD];
+        payload[0] = SERIAL_FRAME_TAG_CAPTURE;
+        memcpy(payload + 1, record, length);
+        SerialFrame::putU16(payload + 1 + length, SerialFrame::crc16(payload, 1 + length));
+        size_t encodedLength = SerialFrame::cobsEncode(payload, 1 + length + SERIAL_FRAME_CRC_SIZE, encoded);
+
+        // Same rule as the serial bridge: never block the loop on a full UART
+        if (serialPort->availableForWrite() < (int)encodedLength)
+        {
+            droppedRecords++;
+            return;
+        }
+        serialPort->write(encoded, encodedLength);
+        bytesWritten += encodedLength;
+    }
+    records++;
+}
+
+void TrafficCapture::drainRing()
+{
+    size_t size;
+    void *item;
+    while ((item = xRingbufferReceive(ring, &size, 0)) != nullptr)
+    {
+        writeRecord((const uint8_t *)item, size);
+        vRingbufferReturnItem(ring, item);
+    }
+}
+
+void TrafficCapture::handleInjectedFrame(const uint8_t *frame, size_t length)
+{
+    uint8_t payload[CAPTURE_SERIAL_MAX_ENCODED];
+    size_t payloadLength = SerialFrame::cobsDecode(frame, length, payload);
+
+    // Anything else on the line (bridge frames echoed back, stray text) is ignored
+    if (payloadLength < 1 + CAPTURE_RECORD_HEADER_SIZE + SERIAL_FRAME_CRC_SIZE || payload[0] != SERIAL_FRAME_TAG_INJECT)
+        return;
+
+    size_t bodyLength = payloadLength - SERIAL_FRAME_CRC_SIZE;
+    const uint8_t *record = payload + 1;
+    if (SerialFrame::crc16(payload, bodyLength) != SerialFrame::getU16(payload + bodyLength) ||
+        CAPTURE_RECORD_HEADER_SIZE + (size_t)record[11] != bodyLength - 1)
+    {
+        rejectedFrames++;
+        return;
+    }
+
+    injectHandler(record + 5, record + CAPTURE_RECORD_HEADER_SIZE, record[11]);
+    injectedFrames++;
+}
+
+void TrafficCapture::pollInjection()
+{
+    int available = serialPort->available();
+    while (available-- > 0)
+    {
+        uint8_t byte = serialPort->read();
+        if (byte != 0)
+        {
+            if (inputLength < sizeof(inputBuffer))
+                inputBuffer[inputLength++] = byte;
+            else
+                inputLength = sizeof(inputBuffer) + 1; // Oversized, drop up to the next delimiter
+            continue;
+        }
+        if (inputLength > 0 && inputLength <= sizeof(inputBuffer))
+            handleInjectedFrame(inputBuffer, inputLength);
+        inputLength = 0;
+    }
+}
+
+void TrafficCapture::handle()
+{
+    if (ring == nullptr)
+        return;
+
+    if (stopRequested)
+    {
+        stopRequested = false;
+        stopCapture();
+    }
+    if (requestedSink != SINK_NONE)
+    {
+        Sink target = requestedSink;
+        requestedSink = SINK_NONE;
+        startCapture(target);
+    }
+
+    if (injectHandler != nullptr)
+        pollInjection();
+
+    if (!active)
+        return;
+
+    drainRing();
+
+    if (sink == SINK_SPIFFS)
+    {
+        if (bytesWritten >= CAPTURE_MAX_FILE_BYTES)
+        {
+            Serial.println("[CAPTURE] File size limit reached");
+            stopCapture();
+            return;
+        }
+        // Keep the file usable if the pad crashes or loses power mid-capture
+        unsigned long now = millis();
+        if (now - lastFlushMs >= CAPTURE_FLUSH_INTERVAL)
+        {
+            file.flush();
+            lastFlushMs = now;
+        }
+    }
+}
+
+String TrafficCapture::getStatusJSON()
+{
+    String json = "{\"active\":" + String(active ? "true" : "false") + ",";
+    json += "\"sink\":\"" + String(sink == SINK_SPIFFS ? "spiffs" : sink == SINK_SERIAL ? "serial" : "none") + "\",";
+    json += "\"records\":" + String(records) + ",";
+    json += "\"bytes\":" + String(bytesWritten) + ",";
+    json += "\"dropped\":" + String(droppedRecords) + ",";
+    json += "\"injected\":" + String(injectedFrames) + ",";
+    json += "\"rejected\":" + String(rejectedFrames) + ",";
+    json += "\"file\":\"" CAPTURE_FILE_PATH "\"}";
+    return json;
+}
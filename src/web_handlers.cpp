@@ -1,9 +1,19 @@
 #include "web_handlers.h"
+#include <errno.h>
+#include <new>
+#include <memory>
 #include <Update.h>
 #include "ClientIdentity.h"
+#include "boot_profiler.h"
+#include "trace_recorder.h"
+#include "sensor_batch.h"
+#include "config.h"
 
-WebHandlers::WebHandlers(AsyncWebServer *webServer, SensorManager *sensorMgr, ClientIdentity *clientIdentity)
-    : server(webServer), sensorManager(sensorMgr), clientIdentity(clientIdentity) {}
+static_assert(SENSOR_BATCH_MAX_READINGS <= HTTP_READING_QUEUE_LENGTH, "A whole batch must fit the reading queue");
+
+WebHandlers::WebHandlers(AsyncWebServer *webServer, SensorManager *sensorMgr, ClientIdentity *clientIdentity, LinkMonitor *linkMonitor, TrafficCapture *trafficCapture, TelemetryLog *telemetryLog, TimeSync *timeSync)
+    : server(webServer), sensorManager(sensorMgr), clientIdentity(clientIdentity), linkMonitor(linkMonitor), trafficCapture(trafficCapture), telemetryLog(telemetryLog), timeSync(timeSync),
+      heavyRequests(WEB_HEAVY_RATE, WEB_HEAVY_BURST) {}
 
 String WebHandlers::getContentType(String filename)
 {
@@ -47,18 +57,39 @@ void WebHandlers::sendJsonResponse(AsyncWebServerRequest *request, bool success,
     request->send(success ? 200 : 400, "application/json", json);
 }
 
+bool WebHandlers::admitHeavyRequest(AsyncWebServerRequest *request)
+{
+    // Handlers share the CPU with the sampling loop, so bursts are turned away early
+    if (heavyRequests.allow(millis()))
+        return true;
+    request->send(429, "text/plain", "Too many requests");
+    return false;
+}
+
+void WebHandlers::sendSnapshotJson(AsyncWebServerRequest *request, const String &json)
+{
+    // Empty when loop() kept overlapping the snapshot read
+    if (json.isEmpty())
+        request->send(503, "text/plain", "Busy, try again");
+    else
+        request->send(200, "application/json", json);
+}
+
 void WebHandlers::handleRoot(AsyncWebServerRequest *request)
 {
+    TRACE_SCOPE("web /");
     sendFile("/index.html", request);
 }
 
 void WebHandlers::handleStaticFile(AsyncWebServerRequest *request)
 {
+    TRACE_SCOPE("web static");
     sendFile(request->url(), request);
 }
 
 void WebHandlers::handleSensorData(AsyncWebServerRequest *request)
 {
+    TRACE_SCOPE("web POST /sensor");
     String ip = request->client()->remoteIP().toString();
     int touch = 0;
     float percent = 0.0;
@@ -71,27 +102,334 @@ void WebHandlers::handleSensorData(AsyncWebServerRequest *request)
     if (request->hasParam("clientId"))
         clientId = request->getParam("clientId")->value();
 
-    sensorManager->updateSensorData(ip, clientId, touch, percent);
+    // The store belongs to loop(), the reading is handed over
+    if (!sensorManager->postReading(ip, clientId, touch, percent))
+    {
+        request->send(503, "text/plain", "Busy, try again");
+        return;
+    }
     request->send(200, "text/plain", "OK");
 }
 
+void WebHandlers::handleSensorBatchBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    // Parsed chunk by chunk as it arrives, the server frees the state with the request
+    if (index == 0)
+    {
+        if (total > SENSOR_BATCH_MAX_BODY || request->_tempObject != nullptr)
+            return;
+        void *memory = malloc(sizeof(SensorBatch));
+        if (memory == nullptr)
+            return;
+        request->_tempObject = new (memory) SensorBatch();
+    }
+
+    SensorBatch *batch = (SensorBatch *)request->_tempObject;
+    if (batch != nullptr)
+        batch->feed(data, len);
+}
+
+void WebHandlers::handleSensorBatch(AsyncWebServerRequest *request)
+{
+    TRACE_SCOPE("web POST /sensor/batch");
+    SensorBatch *batch = (SensorBatch *)request->_tempObject;
+    if (batch == nullptr)
+    {
+        bool tooLarge = request->contentLength() > SENSOR_BATCH_MAX_BODY;
+        request->send(tooLarge ? 413 : 400, "text/plain", tooLarge ? "Batch too large" : "Empty batch");
+        return;
+    }
+    batch->finish();
+
+    String ip = request->client()->remoteIP().toString();
+    bool queued = true;
+    // Oldest first, so the store goes through each touch change in turn
+    for (uint8_t i = 0; i < batch->getReadingCount() && queued; i++)
+    {
+        const SensorBatchReading &reading = batch->getReading(i);
+        if (reading.ageMs >= CLIENT_TTL)
+            continue; // Would be evicted right away
+        String clientId(batch->getClientId(reading.client));
+        queued = sensorManager->postReading(ip + "/" + clientId, clientId, reading.touchValue, reading.batteryPercent, reading.ageMs);
+    }
+
+    if (batch->getRejected() > 0 || batch->getDropped() > 0)
+        Serial.printf("[BATCH] %s: %u readings, %u rejected, %u touch changes dropped\n", ip.c_str(),
+                      batch->getAccepted(), batch->getRejected(), batch->getDropped());
+    // Resending the whole batch is harmless, older readings never overwrite newer ones
+    if (!queued)
+        request->send(503, "text/plain", "Busy, try again");
+    else
+        request->send(200, "text/plain", "OK");
+}
+
 void WebHandlers::handleGetSensorData(AsyncWebServerRequest *request)
 {
-    request->send(200, "application/json", sensorManager->getSensorDataJSON());
+    TRACE_SCOPE("web /sensorData");
+    if (!admitHeavyRequest(request))
+        return;
+    sendSnapshotJson(request, sensorManager->getSensorDataJSON());
 }
 
 void WebHandlers::handleGetLocalSensorData(AsyncWebServerRequest *request)
 {
-    request->send(200, "application/json", sensorManager->getLocalSensorDataJSON());
+    TRACE_SCOPE("web /localSensorData");
+    sendSnapshotJson(request, sensorManager->getLocalSensorDataJSON());
+}
+
+void WebHandlers::handleGetBootStats(AsyncWebServerRequest *request)
+{
+    request->send(200, "application/json", BootProfiler::getJSON());
+}
+
+void WebHandlers::handleGetLinkStats(AsyncWebServerRequest *request)
+{
+    request->send(200, "application/json", linkMonitor->getJSON());
+}
+
+void WebHandlers::handleGetTimeSync(AsyncWebServerRequest *request)
+{
+    request->send(200, "application/json", timeSync->getJSON());
+}
+
+void WebHandlers::handleGetCapture(AsyncWebServerRequest *request)
+{
+    request->send(200, "application/json", trafficCapture->getStatusJSON());
+}
+
+void WebHandlers::handleSetCapture(AsyncWebServerRequest *request)
+{
+    String action = request->hasParam("action", true) ? request->getParam("action", true)->value() : "";
+
+    if (action == "stop")
+    {
+        trafficCapture->requestStop();
+        sendJsonResponse(request, true, "Capture stop requested");
+        return;
+    }
+    if (action != "start")
+    {
+        sendJsonResponse(request, false, "action must be start or stop");
+        return;
+    }
+
+    String sink = request->hasParam("sink", true) ? request->getParam("sink", true)->value() : "spiffs";
+    if (sink == "spiffs")
+        trafficCapture->requestStart(TrafficCapture::SINK_SPIFFS);
+    else if (sink == "serial")
+        trafficCapture->requestStart(TrafficCapture::SINK_SERIAL);
+    else
+    {
+        sendJsonResponse(request, false, "sink must be spiffs or serial");
+        return;
+    }
+    sendJsonResponse(request, true, "Capture start requested");
+}
+
+void WebHandlers::handleDownloadCapture(AsyncWebServerRequest *request)
+{
+    TRACE_SCOPE("web /capture/download");
+    if (!admitHeavyRequest(request))
+        return;
+
+    // The file is still being written while a SPIFFS capture runs
+    if (trafficCapture->isActive())
+    {
+        sendJsonResponse(request, false, "Stop the capture before downloading");
+        return;
+    }
+    if (!SPIFFS.exists(CAPTURE_FILE_PATH))
+    {
+        request->send(404, "text/plain", "File not found");
+        return;
+    }
+    request->send(SPIFFS, CAPTURE_FILE_PATH, "application/octet-stream", true);
+}
+
+void WebHandlers::handleGetTrace(AsyncWebServerRequest *request)
+{
+    request->send(200, "application/json", TraceRecorder::getStatusJSON());
+}
+
+void WebHandlers::handleSetTrace(AsyncWebServerRequest *request)
+{
+    String action = request->hasParam("action", true) ? request->getParam("action", true)->value() : "";
+
+    if (!TRACE_ENABLED)
+    {
+        sendJsonResponse(request, false, "Tracing is compiled out (TRACE_ENABLED 0)");
+        return;
+    }
+    if (action == "start")
+    {
+        TraceRecorder::start();
+        sendJsonResponse(request, true, "Trace started");
+    }
+    else if (action == "stop")
+    {
+        TraceRecorder::stop();
+        sendJsonResponse(request, true, "Trace stopped");
+    }
+    else
+    {
+        sendJsonResponse(request, false, "action must be start or stop");
+    }
+}
+
+void WebHandlers::handleDownloadTrace(AsyncWebServerRequest *request)
+{
+    if (!admitHeavyRequest(request))
+        return;
+
+    // The ring is read without a copy, nothing may be recorded into it meanwhile
+    if (TraceRecorder::isActive())
+    {
+        sendJsonResponse(request, false, "Stop the trace before downloading");
+        return;
+    }
+    TraceRecorder::nameTask("web");
+    // Streamed in chunks as the connection takes them, never held whole in RAM
+    std::shared_ptr<TraceExport> exporter(new (std::nothrow) TraceExport());
+    if (!exporter)
+    {
+        request->send(503, "text/plain", "Out of memory");
+        return;
+    }
+    request->send(request->beginChunkedResponse("application/json", [exporter](uint8_t *buffer, size_t maxLen, size_t) -> size_t
+                                                { return exporter->read(buffer, maxLen); }));
+}
+
+void WebHandlers::handleGetTelemetry(AsyncWebServerRequest *request)
+{
+    TRACE_SCOPE("web /telemetry");
+    if (!admitHeavyRequest(request))
+        return;
+
+    // Times are on the log clock, "now" in the response maps them to wall time
+    uint64_t now = telemetryLog->now();
+    uint64_t from = 0;
+    uint64_t to = now;
+    uint32_t limit = TELEMETRY_QUERY_LIMIT;
+
+    if (request->hasParam("last"))
+    {
+        uint64_t window = strtoull(request->getParam("last")->value().c_str(), nullptr, 10);
+        from = window < now ? now - window : 0;
+    }
+    if (request->hasParam("from"))
+        from = strtoull(request->getParam("from")->value().c_str(), nullptr, 10);
+    if (request->hasParam("to"))
+        to = strtoull(request->getParam("to")->value().c_str(), nullptr, 10);
+    if (request->hasParam("limit"))
+        limit = constrain(request->getParam("limit")->value().toInt(), 1, TELEMETRY_QUERY_LIMIT);
+
+    if (from > to)
+    {
+        sendJsonResponse(request, false, "from must not be after to");
+        return;
+    }
+    request->send(200, "application/json", telemetryLog->query(from, to, limit));
+}
+
+void WebHandlers::handleGetTelemetryIndex(AsyncWebServerRequest *request)
+{
+    TRACE_SCOPE("web /telemetry/index");
+    if (!admitHeavyRequest(request))
+        return;
+    request->send(200, "application/json", telemetryLog->getIndexJSON());
+}
+
+void WebHandlers::handleGetTouchConfig(AsyncWebServerRequest *request)
+{
+    sendSnapshotJson(request, sensorManager->getTouchStateJSON());
+}
+
+// Optional POST parameter into an unsigned field: true and assigned when it is
+// a whole number in 0..maxValue, true and untouched when absent, false otherwise
+template <typename T>
+static bool readUnsignedParam(AsyncWebServerRequest *request, const char *name, unsigned long maxValue, T &field)
+{
+    if (!request->hasParam(name, true))
+        return true;
+    const String &text = request->getParam(name, true)->value();
+    char *end;
+    errno = 0;
+    long value = strtol(text.c_str(), &end, 10);
+    if (text.isEmpty() || *end != '\0' || errno == ERANGE || value < 0 || (unsigned long)value > maxValue)
+        return false;
+    field = (T)value;
+    return true;
+}
+
+void WebHandlers::handleSetTouchConfig(AsyncWebServerRequest *request)
+{
+    TRACE_SCOPE("web POST /touchConfig");
+    // Unset parameters keep their published value, the filters themselves belong to loop()
+    TouchFilterConfig config;
+    GestureConfig gestures;
+    if (!sensorManager->readPublishedConfig(config, gestures))
+    {
+        request->send(503, "text/plain", "Busy, try again");
+        return;
+    }
+
+    // Out of range is refused rather than wrapped into the narrower field
+    if (!readUnsignedParam(request, "touchThreshold", TOUCH_MAX_THRESHOLD, config.touchThreshold) ||
+        !readUnsignedParam(request, "releaseThreshold", TOUCH_MAX_THRESHOLD, config.releaseThreshold) ||
+        !readUnsignedParam(request, "debounceSamples", UINT8_MAX, config.debounceSamples) ||
+        !readUnsignedParam(request, "filterShift", 8, config.filterShift) ||
+        !readUnsignedParam(request, "baselineShift", 15, config.baselineShift))
+    {
+        sendJsonResponse(request, false, "Filter parameter out of range");
+        return;
+    }
+    if (!readUnsignedParam(request, "longPressMs", UINT16_MAX, gestures.longPressMs) ||
+        !readUnsignedParam(request, "doubleTapGapMs", UINT16_MAX, gestures.doubleTapGapMs) ||
+        !readUnsignedParam(request, "holdRepeatMs", UINT16_MAX, gestures.holdRepeatMs))
+    {
+        sendJsonResponse(request, false, "Gesture time out of range (0-65535 ms)");
+        return;
+    }
+
+    if (config.touchThreshold == 0 || config.releaseThreshold >= config.touchThreshold)
+    {
+        sendJsonResponse(request, false, "releaseThreshold must be below touchThreshold");
+        return;
+    }
+    if (config.debounceSamples == 0)
+    {
+        sendJsonResponse(request, false, "Filter parameter out of range");
+        return;
+    }
+
+    if (gestures.longPressMs == 0)
+    {
+        sendJsonResponse(request, false, "longPressMs must be above 0");
+        return;
+    }
+
+    if (!sensorManager->postConfig(config, gestures))
+    {
+        request->send(503, "text/plain", "Busy, try again");
+        return;
+    }
+    sendJsonResponse(request, true, "Touch config updated");
+    Serial.printf("[TOUCH] Thresholds %u/%u, debounce %u, shifts %u/%u\n",
+                  config.touchThreshold, config.releaseThreshold, config.debounceSamples,
+                  config.filterShift, config.baselineShift);
+    Serial.printf("[TOUCH] Gestures: long %u ms, double tap gap %u ms, repeat %u ms\n",
+                  gestures.longPressMs, gestures.doubleTapGapMs, gestures.holdRepeatMs);
 }
 
 void WebHandlers::handleSensorDataPage(AsyncWebServerRequest *request)
 {
+    TRACE_SCOPE("web /sensorpage");
     sendFile("/sensor_data.html", request);
 }
 
 void WebHandlers::handleSetClientId(AsyncWebServerRequest *request)
 {
+    TRACE_SCOPE("web POST /setClientId");
     String idParam = "";
 
     // Check both POST body parameters and URL parameters
@@ -133,6 +471,7 @@ void WebHandlers::handleUpload(AsyncWebServerRequest *request)
 
 void WebHandlers::handleFileUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final)
 {
+    TRACE_SCOPE("web upload");
     static File uploadFile;
 
     if (index == 0) // Start of upload
@@ -192,6 +531,10 @@ void WebHandlers::handleDeleteFile(AsyncWebServerRequest *request)
 
 void WebHandlers::handleListFiles(AsyncWebServerRequest *request)
 {
+    TRACE_SCOPE("web /list");
+    if (!admitHeavyRequest(request))
+        return;
+
     String json = "[";
     File root = SPIFFS.open("/");
     File file = root.openNextFile();
@@ -295,6 +638,13 @@ void WebHandlers::setupRoutes()
     server->on("/firmware", HTTP_GET, [this](AsyncWebServerRequest *request)
                { handleFirmware(request); });
 
+    // Registered before "/sensor", which would otherwise also match this path
+    server->on("/sensor/batch", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handleSensorBatch(request); },
+               nullptr,
+               [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+               { handleSensorBatchBody(request, data, len, index, total); });
+
     server->on("/sensor", HTTP_POST, [this](AsyncWebServerRequest *request)
                { handleSensorData(request); });
 
@@ -304,6 +654,47 @@ void WebHandlers::setupRoutes()
     server->on("/localSensorData", HTTP_GET, [this](AsyncWebServerRequest *request)
                { handleGetLocalSensorData(request); });
 
+    server->on("/bootStats", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleGetBootStats(request); });
+
+    server->on("/linkStats", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleGetLinkStats(request); });
+
+    server->on("/timeSync", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleGetTimeSync(request); });
+
+    // Registered before "/capture", which would otherwise also match this path
+    server->on("/capture/download", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleDownloadCapture(request); });
+
+    server->on("/capture", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleGetCapture(request); });
+
+    server->on("/capture", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handleSetCapture(request); });
+
+    // Registered before "/trace", which would otherwise also match this path
+    server->on("/trace/download", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleDownloadTrace(request); });
+
+    server->on("/trace", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleGetTrace(request); });
+
+    server->on("/trace", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handleSetTrace(request); });
+
+    server->on("/telemetry/index", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleGetTelemetryIndex(request); });
+
+    server->on("/telemetry", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleGetTelemetry(request); });
+
+    server->on("/touchConfig", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleGetTouchConfig(request); });
+
+    server->on("/touchConfig", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handleSetTouchConfig(request); });
+
     server->on("/setClientId", HTTP_POST, [this](AsyncWebServerRequest *request)
                { handleSetClientId(request); });
 
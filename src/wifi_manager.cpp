@@ -1,11 +1,30 @@
 #include "wifi_manager.h"
 #include "config.h"
+#include "boot_profiler.h"
+#include "trace_recorder.h"
 #include <SPIFFS.h>
 #include <Update.h>
 
 WiFiManager::WiFiManager()
 {
-    lastReconnectAttempt = 0;
+    state = STATE_IDLE;
+    gotIpEvent = false;
+    disconnectedEvent = false;
+    lastDisconnectReason = 0;
+    memset(cachedBssid, 0, sizeof(cachedBssid));
+    cachedChannel = 0;
+    hasCachedAp = false;
+    fastConnectInProgress = false;
+    attemptStartedAt = 0;
+    outageStartedAt = 0;
+    backoffUntil = 0;
+    failedAttempts = 0;
+    otaReady = false;
+    everConnected = false;
+    firstConnectMs = 0;
+    lastConnectMs = 0;
+    lastOutageMs = 0;
+    reconnectCount = 0;
 }
 
 void WiFiManager::setupOTA()
@@ -74,56 +93,208 @@ void WiFiManager::printWiFiStatus()
     }
 }
 
-bool WiFiManager::init()
+void WiFiManager::onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
 {
-    WiFi.mode(WIFI_STA);
+    // Runs on the WiFi event task: only record what happened
+    switch (event)
+    {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        gotIpEvent = true;
+        break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        lastDisconnectReason = info.wifi_sta_disconnected.reason;
+        disconnectedEvent = true;
+        break;
+    default:
+        break;
+    }
+}
+
+void WiFiManager::loadCachedAp()
+{
+    hasCachedAp = preferences.getBytes("bssid", cachedBssid, sizeof(cachedBssid)) == sizeof(cachedBssid);
+    cachedChannel = preferences.getInt("channel", 0);
+    if (cachedChannel <= 0)
+        hasCachedAp = false;
+}
 
-    Serial.printf("Connecting to WiFi: %s\n", WIFI_SSID);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+void WiFiManager::saveCachedAp()
+{
+    uint8_t *bssid = WiFi.BSSID();
+    int32_t channel = WiFi.channel();
+    if (bssid == nullptr || channel <= 0)
+        return;
+
+    // Only touch flash when the AP actually changed
+    if (hasCachedAp && channel == cachedChannel && memcmp(bssid, cachedBssid, sizeof(cachedBssid)) == 0)
+        return;
+
+    memcpy(cachedBssid, bssid, sizeof(cachedBssid));
+    cachedChannel = channel;
+    hasCachedAp = true;
+    preferences.putBytes("bssid", cachedBssid, sizeof(cachedBssid));
+    preferences.putInt("channel", cachedChannel);
+    Serial.printf("[WIFI] Cached AP %02X:%02X:%02X:%02X:%02X:%02X on channel %d\n",
+                  cachedBssid[0], cachedBssid[1], cachedBssid[2],
+                  cachedBssid[3], cachedBssid[4], cachedBssid[5], cachedChannel);
+}
 
-    int connectionAttempts = 0;
-    while (WiFi.status() != WL_CONNECTED && connectionAttempts < CONNECTION_TIMEOUT)
+void WiFiManager::clearCachedAp()
+{
+    if (!hasCachedAp)
+        return;
+    hasCachedAp = false;
+    preferences.remove("bssid");
+    preferences.remove("channel");
+    Serial.println("[WIFI] Cached AP cleared, next attempt will scan");
+}
+
+void WiFiManager::startConnect(unsigned long now)
+{
+    disconnectedEvent = false;
+    fastConnectInProgress = hasCachedAp;
+    attemptStartedAt = now;
+    state = STATE_CONNECTING;
+
+    if (fastConnectInProgress)
+    {
+        Serial.printf("[WIFI] Fast connect to %s (channel %d)\n", WIFI_SSID, cachedChannel);
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, cachedChannel, cachedBssid, true);
+    }
+    else
     {
-        delay(500);
-        Serial.print(".");
-        connectionAttempts++;
+        Serial.printf("[WIFI] Connecting to %s\n", WIFI_SSID);
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
     }
-    Serial.println();
+}
+
+void WiFiManager::onConnected(unsigned long now)
+{
+    unsigned long attemptMs = now - attemptStartedAt;
+    state = STATE_CONNECTED;
+    failedAttempts = 0;
+    lastConnectMs = attemptMs;
 
-    if (WiFi.status() == WL_CONNECTED)
+    if (!everConnected)
     {
-        printConnectionInfo();
-        setupOTA();
-        return true;
+        everConnected = true;
+        firstConnectMs = now;
+        BootProfiler::milestone("wifi_connected");
+        Serial.printf("[WIFI] Connected %lu ms after boot (attempt took %lu ms%s)\n",
+                      now, attemptMs, fastConnectInProgress ? ", fast" : "");
     }
     else
     {
-        Serial.println("Failed to connect to WiFi!");
-        printWiFiStatus();
-        return false;
+        reconnectCount++;
+        lastOutageMs = now - outageStartedAt;
+        Serial.printf("[WIFI] Reconnected after %lu ms outage (attempt took %lu ms%s), reconnects: %u\n",
+                      lastOutageMs, attemptMs, fastConnectInProgress ? ", fast" : "", reconnectCount);
+    }
+
+    saveCachedAp();
+    printConnectionInfo();
+
+    if (!otaReady)
+    {
+        setupOTA();
+        otaReady = true;
     }
 }
 
+void WiFiManager::scheduleBackoff(unsigned long now)
+{
+    Serial.printf("[WIFI] Connect attempt failed (reason %u)\n", lastDisconnectReason);
+    printWiFiStatus();
+
+    // AP not found on the cached BSSID/channel (or timed out): it probably moved
+    if (fastConnectInProgress && (lastDisconnectReason == WIFI_REASON_NO_AP_FOUND || lastDisconnectReason == 0))
+        clearCachedAp();
+
+    WiFi.disconnect();
+
+    // Exponential backoff with "equal jitter": half fixed, half random
+    unsigned long ceiling = RECONNECT_BACKOFF_MIN;
+    for (uint8_t i = 0; i < failedAttempts && ceiling < RECONNECT_INTERVAL; i++)
+        ceiling *= 2;
+    if (ceiling > RECONNECT_INTERVAL)
+        ceiling = RECONNECT_INTERVAL;
+    unsigned long delayMs = ceiling / 2 + esp_random() % (ceiling / 2 + 1);
+
+    if (failedAttempts < 255)
+        failedAttempts++;
+    backoffUntil = now + delayMs;
+    state = STATE_BACKOFF;
+    Serial.printf("[WIFI] Retrying in %lu ms\n", delayMs);
+}
+
+bool WiFiManager::init()
+{
+    preferences.begin("WiFiPrefs", false);
+    loadCachedAp();
+
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(false);
+    WiFi.mode(WIFI_STA);
+    WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info)
+                 { onWiFiEvent(event, info); });
+
+    // Connection completes in the background, see handleConnection()
+    startConnect(millis());
+    return true;
+}
+
 void WiFiManager::handleConnection()
 {
-    ArduinoOTA.handle();
+    TRACE_SCOPE("wifi");
+    if (otaReady)
+        ArduinoOTA.handle();
 
-    if (WiFi.status() != WL_CONNECTED)
+    unsigned long now = millis();
+
+    if (gotIpEvent)
+    {
+        gotIpEvent = false;
+        if (state != STATE_CONNECTED)
+            onConnected(now);
+    }
+
+    if (disconnectedEvent)
     {
-        unsigned long currentMillis = millis();
-        if (currentMillis - lastReconnectAttempt > RECONNECT_INTERVAL)
+        disconnectedEvent = false;
+        if (state == STATE_CONNECTED)
         {
-            Serial.println("WiFi connection lost! Reconnecting...");
-            WiFi.disconnect();
-            WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-            lastReconnectAttempt = currentMillis;
+            // Retry immediately against the cached AP, no scan and no delay
+            Serial.printf("[WIFI] Connection lost (reason %u), reconnecting...\n", lastDisconnectReason);
+            outageStartedAt = now;
+            startConnect(now);
         }
+        else if (state == STATE_CONNECTING)
+        {
+            scheduleBackoff(now);
+        }
+    }
+
+    switch (state)
+    {
+    case STATE_CONNECTING:
+        if (now - attemptStartedAt > CONNECT_ATTEMPT_TIMEOUT)
+        {
+            lastDisconnectReason = 0;
+            scheduleBackoff(now);
+        }
+        break;
+    case STATE_BACKOFF:
+        if ((long)(now - backoffUntil) >= 0)
+            startConnect(now);
+        break;
+    default:
+        break;
     }
 }
 
 bool WiFiManager::isConnected()
 {
-    return WiFi.status() == WL_CONNECTED;
+    return state == STATE_CONNECTED && WiFi.status() == WL_CONNECTED;
 }
 
 void WiFiManager::printConnectionInfo()
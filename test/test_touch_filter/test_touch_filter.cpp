@@ -0,0 +1,108 @@
+// Replays the recorded touchRead() trace in touch_trace.h through TouchFilter
+// with the default config and checks where it touches and releases:
+//
+//   pio test -e native
+
+#include <unity.h>
+#include "touch_filter.h"
+#include "touch_trace.h"
+
+// Debounced state changes the default config produces on TOUCH_TRACE
+#define EXPECTED_TOUCH_AT 391    // Ramp (3 samples) + debounce (3 samples) into the touch
+#define EXPECTED_RELEASE_AT 447  // The low-pass has to climb back under the release threshold
+#define EXPECTED_TOUCHED_SAMPLES (EXPECTED_RELEASE_AT - EXPECTED_TOUCH_AT)
+
+struct ReplayResult
+{
+    int touches = 0;
+    int releases = 0;
+    int touchedSamples = 0;
+    int firstTouchAt = -1;
+    int firstReleaseAt = -1;
+};
+
+static ReplayResult replay(TouchFilter &filter, int from, int to)
+{
+    ReplayResult result;
+    bool wasTouched = filter.isTouched();
+    for (int i = from; i < to; i++)
+    {
+        bool touched = filter.update(TOUCH_TRACE[i]);
+        if (touched && !wasTouched)
+        {
+            result.touches++;
+            if (result.firstTouchAt < 0)
+                result.firstTouchAt = i;
+        }
+        else if (!touched && wasTouched)
+        {
+            result.releases++;
+            if (result.firstReleaseAt < 0)
+                result.firstReleaseAt = i;
+        }
+        result.touchedSamples += touched ? 1 : 0;
+        wasTouched = touched;
+    }
+    return result;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_drift_is_tracked_without_touching()
+{
+    TouchFilter filter;
+    ReplayResult result = replay(filter, TRACE_SETTLE_START, TRACE_BOUNCE_START);
+
+    TEST_ASSERT_EQUAL_INT(0, result.touches);
+    TEST_ASSERT_EQUAL_INT(0, result.touchedSamples);
+    // The reading sagged from 64 to 56; the baseline has to have followed most of it
+    TEST_ASSERT_INT_WITHIN(3, TOUCH_TRACE[TRACE_BOUNCE_START - 1], filter.getBaseline());
+}
+
+static void test_bounce_is_debounced()
+{
+    TouchFilter filter;
+    replay(filter, TRACE_SETTLE_START, TRACE_BOUNCE_START);
+    ReplayResult result = replay(filter, TRACE_BOUNCE_START, TRACE_TOUCH_START);
+
+    TEST_ASSERT_EQUAL_INT(0, result.touches);
+    TEST_ASSERT_EQUAL_INT(0, result.touchedSamples);
+}
+
+static void test_touch_and_release_transitions()
+{
+    TouchFilter filter;
+    ReplayResult result = replay(filter, 0, TRACE_SAMPLES);
+
+    TEST_ASSERT_EQUAL_INT(1, result.touches);
+    TEST_ASSERT_EQUAL_INT(1, result.releases);
+    TEST_ASSERT_EQUAL_INT(EXPECTED_TOUCH_AT, result.firstTouchAt);
+    TEST_ASSERT_EQUAL_INT(EXPECTED_RELEASE_AT, result.firstReleaseAt);
+    TEST_ASSERT_EQUAL_INT(EXPECTED_TOUCHED_SAMPLES, result.touchedSamples);
+    TEST_ASSERT_FALSE(filter.isTouched());
+}
+
+static void test_stricter_debounce_delays_transitions()
+{
+    TouchFilterConfig config;
+    config.debounceSamples = 5;
+    TouchFilter filter;
+    filter.setConfig(config);
+    ReplayResult result = replay(filter, 0, TRACE_SAMPLES);
+
+    TEST_ASSERT_EQUAL_INT(1, result.touches);
+    TEST_ASSERT_EQUAL_INT(1, result.releases);
+    TEST_ASSERT_EQUAL_INT(EXPECTED_TOUCH_AT + 2, result.firstTouchAt);
+    TEST_ASSERT_EQUAL_INT(EXPECTED_RELEASE_AT + 2, result.firstReleaseAt);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_drift_is_tracked_without_touching);
+    RUN_TEST(test_bounce_is_debounced);
+    RUN_TEST(test_touch_and_release_transitions);
+    RUN_TEST(test_stricter_debounce_delays_transitions);
+    return UNITY_END();
+}
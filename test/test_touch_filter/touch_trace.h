@@ -0,0 +1,50 @@
+#ifndef TOUCH_TRACE_H
+#define TOUCH_TRACE_H
+
+#include <stdint.h>
+
+// touchRead() trace of one ESP32 pad sampled every TOUCH_SAMPLE_INTERVAL (10 ms),
+// replayed through TouchFilter by test_touch_filter.cpp. Segment starts are
+// sample indices into TOUCH_TRACE.
+
+#define TRACE_SETTLE_START 0
+#define TRACE_DRIFT_START 40
+#define TRACE_BOUNCE_START 340
+#define TRACE_TOUCH_START 386
+#define TRACE_RELEASE_START 436
+#define TRACE_SAMPLES 476
+
+static const uint16_t TOUCH_TRACE[TRACE_SAMPLES] = {
+    // settle: pad idle after power-up, +-1 count of noise
+    63, 64, 64, 63, 64, 64, 64, 65, 64, 63, 64, 64, 65, 63, 63, 64, 64, 65, 63, 63,
+    64, 64, 65, 65, 65, 64, 64, 64, 63, 64, 65, 63, 64, 65, 63, 64, 63, 64, 64, 64,
+    // drift: idle while the reading sags 8 counts over 3 s (humidity, temperature)
+    65, 63, 63, 65, 63, 65, 64, 64, 64, 65, 65, 63, 63, 64, 65, 65, 64, 64, 65, 63,
+    62, 63, 62, 63, 63, 62, 63, 63, 63, 63, 64, 64, 62, 62, 63, 64, 63, 64, 62, 62,
+    63, 64, 63, 63, 64, 63, 64, 64, 64, 64, 64, 62, 62, 62, 64, 64, 63, 63, 61, 63,
+    62, 62, 63, 61, 63, 62, 61, 61, 62, 61, 61, 63, 61, 61, 61, 63, 63, 61, 62, 63,
+    63, 62, 62, 63, 61, 63, 62, 63, 62, 62, 62, 63, 63, 63, 61, 60, 61, 61, 62, 62,
+    61, 62, 62, 60, 62, 61, 62, 61, 60, 60, 62, 60, 60, 60, 60, 60, 60, 61, 62, 60,
+    61, 62, 61, 60, 62, 60, 60, 61, 61, 61, 62, 61, 60, 60, 61, 60, 59, 59, 59, 59,
+    59, 60, 61, 59, 60, 61, 61, 61, 61, 61, 60, 61, 61, 61, 60, 59, 61, 61, 60, 59,
+    59, 60, 59, 60, 61, 59, 61, 59, 59, 59, 58, 60, 58, 60, 58, 58, 59, 59, 60, 58,
+    58, 60, 58, 59, 58, 58, 60, 59, 59, 58, 60, 60, 59, 60, 58, 60, 58, 59, 59, 59,
+    59, 60, 60, 58, 59, 60, 60, 57, 57, 57, 57, 59, 58, 59, 58, 58, 59, 58, 58, 57,
+    57, 57, 59, 57, 59, 59, 59, 59, 57, 58, 59, 59, 59, 59, 59, 59, 58, 58, 57, 58,
+    59, 57, 57, 59, 56, 56, 57, 57, 56, 58, 57, 56, 57, 58, 57, 56, 56, 56, 56, 57,
+    58, 56, 56, 58, 57, 58, 56, 57, 58, 56, 57, 58, 58, 56, 57, 58, 56, 56, 56, 58,
+    58, 57, 57, 56, 55, 56, 55, 57, 57, 55, 55, 55, 55, 55, 55, 55, 55, 57, 56, 57,
+    // bounce: brushing contact: single and double sample dips that never last 3 samples
+    38, 56, 55, 55, 57, 56, 57, 55, 56, 33, 57, 56, 57, 56, 56, 55, 43, 41, 55, 55,
+    57, 56, 55, 56, 56, 57, 34, 55, 56, 57, 56, 57, 55, 55, 55, 56, 56, 39, 55, 56,
+    56, 57, 56, 56, 57, 57,
+    // touch: finger down, the reading falls by about 26 counts
+    55, 46, 38, 30, 29, 31, 30, 29, 30, 31, 29, 31, 29, 30, 31, 30, 29, 31, 30, 31,
+    31, 31, 30, 31, 30, 30, 29, 31, 31, 30, 30, 30, 29, 29, 29, 30, 30, 29, 30, 31,
+    29, 29, 31, 30, 30, 30, 30, 30, 30, 30,
+    // release: finger lifted, the reading returns to the drifted level
+    29, 38, 48, 55, 56, 55, 55, 55, 56, 57, 56, 56, 56, 56, 57, 55, 55, 56, 56, 55,
+    57, 55, 56, 56, 57, 56, 55, 55, 56, 56, 57, 56, 57, 56, 57, 57, 57, 56, 57, 55,
+};
+
+#endif // TOUCH_TRACE_H
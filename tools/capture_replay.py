@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+"""Record, inspect and replay ESP-NOW captures made by TrafficCapture (see include/traffic_capture.h).
+
+Usage:
+    python tools/capture_replay.py dump capture.bin
+    python tools/capture_replay.py record --port COM3 --out capture.bin
+    python tools/capture_replay.py replay capture.bin --port COM3 [--speed 4]
+
+`dump` prints the records of a capture downloaded from /capture/download or
+written by `record`. `record` collects a serial capture (sink "serial") into
+the same file format. `replay` sends the received frames back to a pad, which
+feeds them through its normal receive path (onEspNowReceive, the sequence
+check and SensorManager) as if they had come over the air. --speed scales
+the original timing, 0 sends as fast as the link allows (for benchmarking).
+The pad only takes replayed frames when built with CAPTURE_REPLAY_INPUT 1.
+
+Talking to a port needs pyserial (pip install pyserial).
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+from serial_frame_decoder import cobs_decode, crc16
+
+FILE_MAGIC = b"ENCP"
+FILE_VERSION = 1
+FILE_HEADER = struct.Struct("<4sB3xI")
+RECORD_HEADER = struct.Struct("<BI6sB")
+KIND_RX = 1
+KIND_TX = 2
+TAG_CAPTURE = 0xC1
+TAG_INJECT = 0xC2
+
+# Frame types in include/espnow_message.h, all start with espnow_header
+FRAME_HEADER = struct.Struct("<BBBBI")
+TYPE_TOUCH = 0x01
+TYPE_TELEMETRY = 0x02
+TOUCH_FRAME = struct.Struct("<IHHHBBBB2x")  # After the header
+TELEMETRY_FRAME = struct.Struct("<fBx")  # After the header, followed by touchChannels u16 raw values with FLAG_TOUCH_RAW
+FLAG_TOUCH_RAW = 0x01
+FLAG_TIME_SYNCED = 0x02
+# struct_time_beacon
+TIME_BEACON = struct.Struct("<IIQ")
+BEACON_MAGIC = 0x434E5953
+GESTURES = {0: "none", 1: "tap", 2: "double", 3: "long", 4: "hold"}
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_index = 0
+    code = 1
+    for byte in data:
+        if byte == 0:
+            out[code_index] = code
+            code_index = len(out)
+            out.append(0)
+            code = 1
+            continue
+        out.append(byte)
+        code += 1
+        if code == 0xFF:
+            out[code_index] = code
+            code_index = len(out)
+            out.append(0)
+            code = 1
+    out[code_index] = code
+    out.append(0)
+    return bytes(out)
+
+
+def read_capture(path):
+    """Returns (start_ms, [(kind, timestamp_us, mac, payload)])."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < FILE_HEADER.size:
+        raise ValueError("file too short")
+    magic, version, start_ms = FILE_HEADER.unpack_from(data)
+    if magic != FILE_MAGIC or version != FILE_VERSION:
+        raise ValueError("not a version %d capture" % FILE_VERSION)
+
+    records = []
+    offset = FILE_HEADER.size
+    while offset + RECORD_HEADER.size <= len(data):
+        kind, timestamp, mac, length = RECORD_HEADER.unpack_from(data, offset)
+        offset += RECORD_HEADER.size
+        if offset + length > len(data):
+            print("# truncated record at end of file", file=sys.stderr)
+            break
+        records.append((kind, timestamp, mac, data[offset:offset + length]))
+        offset += length
+    return start_ms, records
+
+
+def describe(payload):
+    if len(payload) == TIME_BEACON.size:
+        magic, sequence, previous_tx = TIME_BEACON.unpack(payload)
+        if magic == BEACON_MAGIC:
+            return "beacon seq=%d previous_tx=%d us" % (sequence, previous_tx)
+    if len(payload) < FRAME_HEADER.size or payload[0] not in (TYPE_TOUCH, TYPE_TELEMETRY):
+        return "%d bytes: %s" % (len(payload), payload.hex())
+    frame_type, client_id, flags, boot, sequence = FRAME_HEADER.unpack_from(payload)
+    body = FRAME_HEADER.size
+
+    if frame_type == TYPE_TOUCH:
+        if len(payload) != body + TOUCH_FRAME.size:
+            return "touch, %d bytes: %s" % (len(payload), payload.hex())
+        (touch_changed, touch_mask, gesture_age, sync_error, touch, gesture, gesture_count,
+         channels) = TOUCH_FRAME.unpack_from(payload, body)
+        text = "touch id=%d boot=%02x seq=%d touch=%d gesture=%s#%d (%d ms ago) channels=%s" % (
+            client_id, boot, sequence, touch, GESTURES.get(gesture, gesture), gesture_count, gesture_age,
+            "".join(str((touch_mask >> i) & 1) for i in range(channels)))
+        if flags & FLAG_TIME_SYNCED:
+            text += " changed=%d us (sync error %d us)" % (touch_changed, sync_error)
+        return text
+
+    if len(payload) < body + TELEMETRY_FRAME.size:
+        return "telemetry, %d bytes: %s" % (len(payload), payload.hex())
+    battery, channels = TELEMETRY_FRAME.unpack_from(payload, body)
+    text = "telemetry id=%d boot=%02x seq=%d battery=%.1f%%" % (client_id, boot, sequence, battery)
+    raw_offset = body + TELEMETRY_FRAME.size
+    if flags & FLAG_TOUCH_RAW and len(payload) >= raw_offset + 2 * channels:
+        raw = struct.unpack_from("<%dH" % channels, payload, raw_offset)
+        text += " raw=" + ",".join(str(v) for v in raw)
+    return text
+
+
+def format_mac(mac):
+    return ":".join("%02X" % b for b in mac)
+
+
+def dump(args):
+    start_ms, records = read_capture(args.file)
+    print("# capture started at %d ms, %d records" % (start_ms, len(records)))
+    for kind, timestamp, mac, payload in records:
+        direction = "RX" if kind == KIND_RX else "TX" if kind == KIND_TX else "?%d" % kind
+        print("%12.6f %s %s %s" % (timestamp / 1e6, direction, format_mac(mac), describe(payload)))
+
+
+def record(args):
+    import serial  # pyserial
+    port = serial.Serial(args.port, args.baud, timeout=1)
+    out = open(args.out, "wb")
+    out.write(FILE_HEADER.pack(FILE_MAGIC, FILE_VERSION, 0))
+
+    buffer = bytearray()
+    count = 0
+    try:
+        while True:
+            buffer += port.read(port.in_waiting or 1)
+            while True:
+                end = buffer.find(b"\x00")
+                if end < 0:
+                    break
+                packet = bytes(buffer[:end])
+                del buffer[:end + 1]
+                try:
+                    payload = cobs_decode(packet) if packet else b""
+                except ValueError:
+                    continue
+                # Log text and bridge frames share the line, keep only capture records
+                if len(payload) < 1 + RECORD_HEADER.size + 2 or payload[0] != TAG_CAPTURE:
+                    continue
+                body, crc = payload[:-2], struct.unpack("<H", payload[-2:])[0]
+                if crc16(body) != crc:
+                    continue
+                out.write(body[1:])
+                count += 1
+                if count % 100 == 0:
+                    out.flush()
+                    print("\r%d records" % count, end="", file=sys.stderr)
+    except KeyboardInterrupt:
+        pass
+    out.close()
+    print("\n%d records written to %s" % (count, args.out), file=sys.stderr)
+
+
+def replay(args):
+    import serial  # pyserial
+    _, records = read_capture(args.file)
+    frames = [r for r in records if r[0] == KIND_RX or args.include_tx]
+    if not frames:
+        print("nothing to replay", file=sys.stderr)
+        return
+
+    port = serial.Serial(args.port, args.baud, timeout=0)
+    first_timestamp = frames[0][1]
+    started = time.monotonic()
+    sent_bytes = 0
+
+    for kind, timestamp, mac, payload in frames:
+        if args.speed > 0:
+            due = started + (timestamp - first_timestamp) / 1e6 / args.speed
+            delay = due - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+        body = bytes([TAG_INJECT]) + RECORD_HEADER.pack(kind, timestamp, mac, len(payload)) + payload
+        frame = cobs_encode(body + struct.pack("<H", crc16(body)))
+        port.write(frame)
+        sent_bytes += len(frame)
+        if args.verbose:
+            print("%12.6f %s %s" % (timestamp / 1e6, format_mac(mac), describe(payload)))
+
+    port.flush()
+    elapsed = time.monotonic() - started
+    span = (frames[-1][1] - first_timestamp) / 1e6
+    print("replayed %d frames (%d bytes) spanning %.2f s in %.2f s, %.0f frames/s"
+          % (len(frames), sent_bytes, span, elapsed, len(frames) / elapsed if elapsed > 0 else 0),
+          file=sys.stderr)
+    print("compare with the injected/rejected counters at GET /capture", file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    p = commands.add_parser("dump", help="print the records of a capture file")
+    p.add_argument("file")
+    p.set_defaults(run=dump)
+
+    p = commands.add_parser("record", help="collect a serial capture into a file (Ctrl+C to stop)")
+    p.add_argument("--port", required=True)
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--out", required=True)
+    p.set_defaults(run=record)
+
+    p = commands.add_parser("replay", help="send captured frames back to a pad")
+    p.add_argument("file")
+    p.add_argument("--port", required=True)
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--speed", type=float, default=1.0, help="timing scale, 0 = as fast as possible")
+    p.add_argument("--include-tx", action="store_true", help="also replay frames the pad sent itself")
+    p.add_argument("--verbose", action="store_true")
+    p.set_defaults(run=replay)
+
+    args = parser.parse_args()
+    args.run(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Decode the binary sensor frames streamed by SerialBridge (see include/serial_frame.h).
+
+Usage:
+    python tools/serial_frame_decoder.py --port COM3 [--baud 921600]
+    python tools/serial_frame_decoder.py --file capture.bin
+
+Reading from a port needs pyserial (pip install pyserial).
+"""
+
+import argparse
+import struct
+import sys
+
+FRAME_VERSION = 1
+HEADER = struct.Struct("<BBHI")
+SLOT = struct.Struct("<BBH")
+FLAG_TOUCH = 0x01
+FLAG_PRESENT = 0x02
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0:
+            raise ValueError("zero byte inside COBS block")
+        block = data[i + 1:i + code]
+        if len(block) != code - 1:
+            raise ValueError("truncated COBS block")
+        out += block
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def parse_frame(payload):
+    """Returns (sequence, timestamp_ms, [(client_id, touch, battery_percent)]) or raises ValueError."""
+    if len(payload) < HEADER.size + 2:
+        raise ValueError("frame too short")
+    body, crc = payload[:-2], struct.unpack("<H", payload[-2:])[0]
+    if crc16(body) != crc:
+        raise ValueError("CRC mismatch")
+
+    version, count, sequence, timestamp = HEADER.unpack_from(body)
+    if version != FRAME_VERSION:
+        raise ValueError("unsupported version %d" % version)
+    if len(body) != HEADER.size + count * SLOT.size:
+        raise ValueError("slot count does not match length")
+
+    slots = []
+    for n in range(count):
+        client_id, flags, battery = SLOT.unpack_from(body, HEADER.size + n * SLOT.size)
+        if flags & FLAG_PRESENT:
+            slots.append((client_id, bool(flags & FLAG_TOUCH), battery / 10.0))
+        else:
+            slots.append(None)
+    return sequence, timestamp, slots
+
+
+def iter_frames(read_chunk):
+    """Splits the byte stream on 0x00 and yields decoded frames, skipping garbage.
+
+    read_chunk returns bytes (possibly empty on a timeout) or None at end of stream.
+    """
+    buffer = bytearray()
+    while True:
+        chunk = read_chunk()
+        if chunk is None:
+            return
+        buffer += chunk
+        while True:
+            end = buffer.find(b"\x00")
+            if end < 0:
+                break
+            packet = bytes(buffer[:end])
+            del buffer[:end + 1]
+            if not packet:
+                continue
+            try:
+                yield parse_frame(cobs_decode(packet))
+            except ValueError:
+                # Log text or a partial frame between delimiters
+                continue
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port of the bridge")
+    source.add_argument("--file", help="raw capture of the serial stream")
+    parser.add_argument("--baud", type=int, default=921600)
+    args = parser.parse_args()
+
+    if args.port:
+        import serial  # pyserial
+        stream = serial.Serial(args.port, args.baud, timeout=1)
+        read_chunk = lambda: stream.read(stream.in_waiting or 1)
+    else:
+        stream = open(args.file, "rb")
+        read_chunk = lambda: stream.read(4096) or None
+
+    last_sequence = None
+    for sequence, timestamp, slots in iter_frames(read_chunk):
+        if last_sequence is not None and (sequence - last_sequence) & 0xFFFF != 1:
+            print("# lost %d frame(s)" % (((sequence - last_sequence) & 0xFFFF) - 1), file=sys.stderr)
+        last_sequence = sequence
+        values = " ".join("-" if s is None else "%d:%d/%.1f%%" % (s[0], s[1], s[2]) for s in slots)
+        print("%5d %10d %s" % (sequence, timestamp, values))
+
+
+if __name__ == "__main__":
+    main()